@@ -0,0 +1,433 @@
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "Culling/softwareOcclusion.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace BlitzenEngine;
+
+#define TEST_NEAR_PLANE         0.1f
+#define TEST_FAR_PLANE          10000.f
+
+//How many frames the timing averages over
+#define TEST_TIMED_FRAMES       200
+
+struct TestMesh
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> adjacency;
+};
+
+static uint32_t g_failedChecks = 0;
+
+static void Check(bool bPassed, const char* name)
+{
+    std::cout << (bPassed ? "PASSED: " : "FAILED: ") << name << '\n';
+    if(!bPassed)
+    {
+        ++g_failedChecks;
+    }
+}
+
+//Reversed depth like the renderer, the near and far planes are swapped and y points down the screen
+static glm::mat4 TestProjection(float aspect)
+{
+    glm::mat4 projection = glm::perspective(glm::radians(70.f), aspect, TEST_FAR_PLANE, TEST_NEAR_PLANE);
+    projection[1][1] *= -1;
+    return projection;
+}
+
+static void BuildAdjacency(TestMesh& mesh)
+{
+    mesh.adjacency.resize(mesh.indices.size());
+    BuildOccluderAdjacency(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), mesh.adjacency.data());
+}
+
+//A square from -1 to 1 on x and y, made of two triangles that share its diagonal and face +z
+static TestMesh Quad()
+{
+    TestMesh mesh;
+    mesh.vertices = {{-1.f, -1.f, 0.f}, {1.f, -1.f, 0.f}, {1.f, 1.f, 0.f}, {-1.f, 1.f, 0.f}};
+    mesh.indices = {0, 1, 2, 0, 2, 3};
+    BuildAdjacency(mesh);
+    return mesh;
+}
+
+//A cube from -1 to 1 with every face split into n by n quads, the vertices are shared so the mesh is closed
+static TestMesh Cube(uint32_t n)
+{
+    TestMesh mesh;
+    auto VertexIndex = [&](const glm::vec3& position)
+    {
+        auto found = std::find(mesh.vertices.begin(), mesh.vertices.end(), position);
+        if(found != mesh.vertices.end())
+        {
+            return static_cast<uint32_t>(found - mesh.vertices.begin());
+        }
+        mesh.vertices.push_back(position);
+        return static_cast<uint32_t>(mesh.vertices.size() - 1);
+    };
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        for(int side = -1; side <= 1; side += 2)
+        {
+            for(uint32_t a = 0; a < n; ++a)
+            {
+                for(uint32_t b = 0; b < n; ++b)
+                {
+                    auto Corner = [&](uint32_t u, uint32_t v)
+                    {
+                        glm::vec3 position;
+                        position[axis] = static_cast<float>(side);
+                        position[(axis + 1) % 3] = -1.f + 2.f * u / n;
+                        position[(axis + 2) % 3] = -1.f + 2.f * v / n;
+                        return VertexIndex(position);
+                    };
+                    uint32_t q0 = Corner(a, b);
+                    uint32_t q1 = Corner(a + 1, b);
+                    uint32_t q2 = Corner(a + 1, b + 1);
+                    uint32_t q3 = Corner(a, b + 1);
+
+                    //Counter clockwise seen from outside of the cube
+                    if(side > 0)
+                    {
+                        mesh.indices.insert(mesh.indices.end(), {q0, q1, q2, q0, q2, q3});
+                    }
+                    else
+                    {
+                        mesh.indices.insert(mesh.indices.end(), {q0, q2, q1, q0, q3, q2});
+                    }
+                }
+            }
+        }
+    }
+
+    BuildAdjacency(mesh);
+    return mesh;
+}
+
+static void AddOccluder(SoftwareOcclusionRasterizer& rasterizer, const glm::mat4& matrix, const TestMesh& mesh)
+{
+    rasterizer.AddOccluder(matrix, mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(),
+    mesh.adjacency.data(), mesh.indices.size(), 0.f);
+}
+
+//Takes a point in world space to the pixel it lands on, with the depth that the rasterizer would give it in z
+static glm::vec3 ToScreen(const glm::mat4& viewProjection, const glm::vec3& position, uint32_t width, uint32_t height)
+{
+    glm::vec4 clip = viewProjection * glm::vec4(position, 1.f);
+    return glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * width, (clip.y / clip.w * 0.5f + 0.5f) * height,
+    clip.z / clip.w);
+}
+
+/*-----------------------------------------------------------------------------------------------------
+A face on quad has to cover every pixel inside of it, with no crack along the diagonal that its two
+triangles share, and none of the pixels can be nearer than the quad itself
+------------------------------------------------------------------------------------------------------*/
+static void TestQuadCoverage()
+{
+    SoftwareOcclusionRasterizer rasterizer;
+    uint32_t width = rasterizer.GetWidth();
+    uint32_t height = rasterizer.GetHeight();
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    glm::mat4 projection = TestProjection(static_cast<float>(width) / height);
+
+    //Rotated so that the diagonal does not line up with the pixels
+    glm::mat4 matrix = glm::rotate(glm::mat4(1.f), 0.3f, glm::vec3(0.f, 0.f, 1.f)) *
+    glm::scale(glm::mat4(1.f), glm::vec3(1.5f));
+
+    TestMesh quad = Quad();
+    rasterizer.BeginFrame(view, projection);
+    AddOccluder(rasterizer, matrix, quad);
+    rasterizer.Rasterize();
+
+    glm::mat4 viewProjection = projection * view;
+    glm::vec2 corners[4];
+    float quadDepth = 0.f;
+    for(int c = 0; c < 4; ++c)
+    {
+        glm::vec3 screen = ToScreen(viewProjection, glm::vec3(matrix * glm::vec4(quad.vertices[c], 1.f)), width, height);
+        corners[c] = glm::vec2(screen);
+        quadDepth = screen.z;
+    }
+
+    //How far inside of the quad's edges a pixel's center is, the pixels along the edges may be left out
+    auto EdgeDistance = [&](float x, float y)
+    {
+        float distance = 1e9f;
+        for(int c = 0; c < 4; ++c)
+        {
+            glm::vec2 edge = glm::normalize(corners[(c + 1) % 4] - corners[c]);
+            glm::vec2 toPixel = glm::vec2(x, y) - corners[c];
+            distance = std::min(distance, std::abs(edge.x * toPixel.y - edge.y * toPixel.x));
+        }
+        return distance;
+    };
+    auto IsInside = [&](float x, float y)
+    {
+        float sign = 0.f;
+        for(int c = 0; c < 4; ++c)
+        {
+            glm::vec2 edge = corners[(c + 1) % 4] - corners[c];
+            glm::vec2 toPixel = glm::vec2(x, y) - corners[c];
+            float cross = edge.x * toPixel.y - edge.y * toPixel.x;
+            if(sign * cross < 0.f)
+            {
+                return false;
+            }
+            sign = cross;
+        }
+        return true;
+    };
+
+    const float* pDepths = rasterizer.GetDepths();
+    size_t holes = 0;
+    size_t nearer = 0;
+    for(uint32_t y = 0; y < height; ++y)
+    {
+        for(uint32_t x = 0; x < width; ++x)
+        {
+            float depth = pDepths[y * width + x];
+            float centerX = x + 0.5f;
+            float centerY = y + 0.5f;
+            if(IsInside(centerX, centerY) && EdgeDistance(centerX, centerY) > 2.f && depth == 0.f)
+            {
+                ++holes;
+            }
+            if(depth > quadDepth * 1.0001f)
+            {
+                ++nearer;
+            }
+        }
+    }
+    Check(!holes, "a quad of two triangles covers every pixel inside of it");
+    Check(!nearer, "a quad of two triangles writes no depth nearer than itself");
+}
+
+//A box behind a wall is occluded and the same box in front of it is not
+static void TestBoxOcclusion()
+{
+    SoftwareOcclusionRasterizer rasterizer;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    glm::mat4 projection = TestProjection(static_cast<float>(rasterizer.GetWidth()) / rasterizer.GetHeight());
+
+    TestMesh quad = Quad();
+    rasterizer.BeginFrame(view, projection);
+    AddOccluder(rasterizer, glm::scale(glm::mat4(1.f), glm::vec3(3.f)), quad);
+    rasterizer.Rasterize();
+
+    OcclusionBox boxes[2];
+    boxes[0] = {glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -3.f)), glm::vec3(-0.5f), glm::vec3(0.5f)};
+    boxes[1] = {glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, 2.f)), glm::vec3(-0.5f), glm::vec3(0.5f)};
+    uint8_t visibility[2];
+    uint32_t occludedCount = rasterizer.CullBoxes(boxes, 2, visibility);
+
+    Check(!visibility[0], "a box behind an occluder is occluded");
+    Check(visibility[1], "a box in front of an occluder is visible");
+    Check(occludedCount == 1, "CullBoxes counts the occluded boxes");
+}
+
+/*-----------------------------------------------------------------------------------------------------
+A floor that goes from behind the camera into the distance has to be clipped at the near plane. It
+still covers the bottom of the screen and no pixel is nearer than the floor anywhere inside of it
+------------------------------------------------------------------------------------------------------*/
+static void TestNearPlaneClipping()
+{
+    SoftwareOcclusionRasterizer rasterizer;
+    uint32_t width = rasterizer.GetWidth();
+    uint32_t height = rasterizer.GetHeight();
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    glm::mat4 projection = TestProjection(static_cast<float>(width) / height);
+
+    //The quad is turned to face up and stretched from z = 15 to z = -25, one unit under the camera
+    glm::mat4 matrix = glm::translate(glm::mat4(1.f), glm::vec3(0.f, -1.f, -5.f)) *
+    glm::scale(glm::mat4(1.f), glm::vec3(20.f, 1.f, 20.f)) *
+    glm::rotate(glm::mat4(1.f), glm::radians(-90.f), glm::vec3(1.f, 0.f, 0.f));
+
+    TestMesh quad = Quad();
+    rasterizer.BeginFrame(view, projection);
+    AddOccluder(rasterizer, matrix, quad);
+    rasterizer.Rasterize();
+
+    //The floor's depth under a point of the screen, from the ray that goes through it
+    glm::mat4 viewProjection = projection * view;
+    glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    auto FloorDepth = [&](float x, float y)
+    {
+        glm::vec2 ndc(x / width * 2.f - 1.f, y / height * 2.f - 1.f);
+        glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, 1.f, 1.f);
+        glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 0.f, 1.f);
+        glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+        if(direction.y >= 0.f)
+        {
+            return 0.f;
+        }
+        glm::vec3 hit = origin + direction * ((-1.f - origin.y) / direction.y);
+        return ToScreen(viewProjection, hit, width, height).z;
+    };
+
+    const float* pDepths = rasterizer.GetDepths();
+    size_t nearer = 0;
+    for(uint32_t y = 0; y < height; ++y)
+    {
+        for(uint32_t x = 0; x < width; ++x)
+        {
+            //The depth is linear over the pixel, so the farthest that the floor gets is at one of its corners
+            float farthest = std::min({FloorDepth(x, y), FloorDepth(x + 1.f, y), FloorDepth(x, y + 1.f),
+            FloorDepth(x + 1.f, y + 1.f)});
+            if(pDepths[y * width + x] > farthest * 1.0001f + 1e-7f)
+            {
+                ++nearer;
+            }
+        }
+    }
+    Check(rasterizer.GetTriangleCount() > 0, "an occluder that crosses the near plane is clipped and drawn");
+    Check(pDepths[(height - 2) * width + width / 2] > 0.f, "a clipped occluder covers the screen up to the near plane");
+    Check(!nearer, "a clipped occluder writes no depth nearer than itself");
+}
+
+//A few dozen cubes scattered in front of the camera, used to compare the fill paths and to time the rasterizer
+struct TestScene
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    TestMesh cube;
+    std::vector<glm::mat4> occluders;
+    std::vector<OcclusionBox> boxes;
+};
+
+static TestScene BuildScene(float aspect)
+{
+    TestScene scene;
+    scene.view = glm::lookAt(glm::vec3(0.f, 2.f, 10.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    scene.projection = TestProjection(aspect);
+    scene.cube = Cube(4);
+
+    //A fixed sequence, so that every run draws the same frame
+    uint32_t seed = 3;
+    auto Random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24) * 2.f - 1.f;
+    };
+
+    for(int i = 0; i < 40; ++i)
+    {
+        glm::vec3 position(Random() * 12.f, Random() * 4.f, Random() * 15.f - 5.f);
+        glm::vec3 axis = glm::normalize(glm::vec3(Random(), Random(), Random()) + glm::vec3(0.01f));
+        glm::vec3 scale(1.f + Random() * 0.5f, 1.f + Random() * 0.5f, 1.f + Random() * 0.5f);
+        scene.occluders.push_back(glm::translate(glm::mat4(1.f), position) *
+        glm::rotate(glm::mat4(1.f), Random() * 3.f, axis) * glm::scale(glm::mat4(1.f), scale));
+    }
+    for(int i = 0; i < 2000; ++i)
+    {
+        glm::vec3 position(Random() * 14.f, Random() * 5.f, Random() * 20.f - 12.f);
+        float size = 0.05f + 0.3f * (Random() + 1.f);
+        scene.boxes.push_back({glm::translate(glm::mat4(1.f), position), glm::vec3(-size), glm::vec3(size)});
+    }
+    return scene;
+}
+
+static void DrawScene(SoftwareOcclusionRasterizer& rasterizer, const TestScene& scene)
+{
+    rasterizer.BeginFrame(scene.view, scene.projection);
+    for(const glm::mat4& matrix : scene.occluders)
+    {
+        AddOccluder(rasterizer, matrix, scene.cube);
+    }
+    rasterizer.Rasterize();
+}
+
+//The scalar fill is the only one on CPUs without SSE, so it has to give the exact same depth buffer
+static void TestScalarFill()
+{
+    SoftwareOcclusionRasterizer rasterizer;
+    size_t pixelCount = static_cast<size_t>(rasterizer.GetWidth()) * rasterizer.GetHeight();
+    TestScene scene = BuildScene(static_cast<float>(rasterizer.GetWidth()) / rasterizer.GetHeight());
+
+    DrawScene(rasterizer, scene);
+    std::vector<float> depths(rasterizer.GetDepths(), rasterizer.GetDepths() + pixelCount);
+
+    rasterizer.SetScalarFill(true);
+    DrawScene(rasterizer, scene);
+    Check(!std::memcmp(depths.data(), rasterizer.GetDepths(), pixelCount * sizeof(float)),
+    "the SSE and scalar fills give the same depth buffer");
+}
+
+//Every edge of a closed mesh has exactly one neighbor, which shares the edge the other way around
+static void TestClosedMeshAdjacency()
+{
+    TestMesh cube = Cube(3);
+    size_t brokenEdges = 0;
+    for(size_t edge = 0; edge < cube.indices.size(); ++edge)
+    {
+        uint32_t neighbor = cube.adjacency[edge];
+        if(neighbor == BLITZEN_OCCLUDER_NO_NEIGHBOR || neighbor == edge / 3)
+        {
+            ++brokenEdges;
+            continue;
+        }
+
+        uint32_t first = cube.indices[edge];
+        uint32_t second = cube.indices[edge - edge % 3 + (edge + 1) % 3];
+        bool bShared = false;
+        for(size_t e = 0; e < 3; ++e)
+        {
+            size_t neighborEdge = neighbor * 3 + e;
+            if(cube.indices[neighborEdge] == second && cube.indices[neighbor * 3 + (e + 1) % 3] == first)
+            {
+                bShared = cube.adjacency[neighborEdge] == edge / 3;
+            }
+        }
+        if(!bShared)
+        {
+            ++brokenEdges;
+        }
+    }
+    Check(!brokenEdges, "BuildOccluderAdjacency finds both triangles of every edge of a closed mesh");
+}
+
+//Times a whole frame of the rasterizer at its default size, from adding the occluders to culling the boxes
+static void TimeRasterizer()
+{
+    SoftwareOcclusionRasterizer rasterizer(256, 128);
+    TestScene scene = BuildScene(2.f);
+    std::vector<uint8_t> visibility(scene.boxes.size());
+
+    //The first frame allocates the buffers and wakes up the workers
+    DrawScene(rasterizer, scene);
+    rasterizer.CullBoxes(scene.boxes.data(), scene.boxes.size(), visibility.data());
+
+    uint32_t occludedCount = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for(int frame = 0; frame < TEST_TIMED_FRAMES; ++frame)
+    {
+        DrawScene(rasterizer, scene);
+        occludedCount = rasterizer.CullBoxes(scene.boxes.data(), scene.boxes.size(), visibility.data());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Rasterize + CullBoxes at " << rasterizer.GetWidth() << "x" << rasterizer.GetHeight() << ": "
+    << std::chrono::duration<double, std::milli>(end - start).count() / TEST_TIMED_FRAMES << " ms per frame, "
+    << rasterizer.GetTriangleCount() << " triangles, " << occludedCount << " of " << scene.boxes.size()
+    << " boxes occluded\n";
+}
+
+int main()
+{
+    TestQuadCoverage();
+    TestBoxOcclusion();
+    TestNearPlaneClipping();
+    TestScalarFill();
+    TestClosedMeshAdjacency();
+    TimeRasterizer();
+
+    std::cout << g_failedChecks << " checks failed\n";
+    return g_failedChecks ? 1 : 0;
+}
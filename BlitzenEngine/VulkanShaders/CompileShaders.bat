@@ -1,3 +1,6 @@
 call glslc.exe OpaqueGeometryShader.vert -o OpaqueGeometryShader.vert.spv
+call glslc.exe OpaqueGeometryShaderCompact.vert -o OpaqueGeometryShaderCompact.vert.spv
 call glslc.exe OpaqueGeometryShader.frag -o OpaqueGeometryShader.frag.spv
+call glslc.exe DrawCulling.comp -o DrawCulling.comp.spv
+call glslc.exe DepthPyramid.comp -o DepthPyramid.comp.spv
 PAUSE
\ No newline at end of file
@@ -25,19 +25,16 @@ layout (location = 0) out vec3 outNormal;
 layout (location = 1) out vec3 outColor;
 layout (location = 2) out vec2 outUvMap;
 
-//The push constants have access to the vertex buffer's address and the model matrix
-layout(push_constant) uniform constants
-{
-    mat4 matrix;
-}PushConstants;
-
 void main()
 {
     Vertex currentVertex = sceneData.vertexBuffer.vertices[gl_VertexIndex];
 
-    gl_Position = sceneData.projection * sceneData.view * PushConstants.matrix * vec4(currentVertex.pos, 1.0);
+    //gl_InstanceIndex counts from the draw's first instance, so it is the place of this instance's object
+    ObjectData objectData = sceneData.objectBuffer.objects[sceneData.instanceBuffer.instanceObjects[gl_InstanceIndex]];
+    gl_Position = sceneData.viewProjection * (objectData.modelMatrix * vec4(currentVertex.pos, 1.0));
 
     //Send the necessary data to the fragment shader
+    outNormal = normalize(objectData.normalMatrix * currentVertex.normal);
     outColor = currentVertex.color.xyz;
     outUvMap.x = currentVertex.uv_x;
     outUvMap.y = currentVertex.uv_y;
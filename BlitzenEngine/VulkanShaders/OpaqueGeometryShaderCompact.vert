@@ -0,0 +1,53 @@
+#version 460
+
+#extension GL_EXT_buffer_reference : require
+#extension GL_GOOGLE_include_directive : require
+
+//Mirrors CompactVulkanVertex, every attribute is packed in 32 bit words and decoded below
+struct Vertex
+{
+    uint positionXY;
+    uint positionZ;
+    uint normal;
+    uint uvMap;
+    uint color;
+};
+
+
+//This is where the vertex buffer will be passed, using an SSBO
+layout(buffer_reference, std430) readonly buffer VertexBuffer
+{ 
+	Vertex vertices[];
+};
+
+#include "inputStructures.glsl"
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec2 outUvMap;
+
+//Reverses the octahedral encoding of the normal, the folded lower hemisphere is unfolded first
+vec3 DecodeOctahedralNormal(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+void main()
+{
+    Vertex currentVertex = sceneData.vertexBuffer.vertices[gl_VertexIndex];
+
+    vec3 position = vec3(unpackUnorm2x16(currentVertex.positionXY), unpackUnorm2x16(currentVertex.positionZ).x);
+    //gl_InstanceIndex counts from the draw's first instance, so it is the place of this instance's object.
+    //The model matrix also holds the mesh's dequantization, which takes the unorm positions back to the mesh's bounds
+    ObjectData objectData = sceneData.objectBuffer.objects[sceneData.instanceBuffer.instanceObjects[gl_InstanceIndex]];
+    gl_Position = sceneData.viewProjection * (objectData.modelMatrix * vec4(position, 1.0));
+
+    //Send the necessary data to the fragment shader
+    outNormal = normalize(objectData.normalMatrix * DecodeOctahedralNormal(unpackSnorm2x16(currentVertex.normal)));
+    outColor = unpackUnorm4x8(currentVertex.color).xyz;
+    outUvMap = unpackHalf2x16(currentVertex.uvMap);
+}
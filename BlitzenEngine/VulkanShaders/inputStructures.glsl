@@ -1,11 +1,38 @@
+//Mirrors GPUObjectData, the model matrix holds the mesh's dequantization while the normal matrix does not
+struct ObjectData
+{
+	mat4 modelMatrix;
+	mat3 normalMatrix;
+	uint materialIndex;
+	uint surfaceIndex;
+	uint drawBucket;
+	float lodScale;
+	vec4 boundingSphere;
+};
+
+//The data of every render object of the frame
+layout(buffer_reference, std430) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+//The object of every instance that the frame draws, a draw's first instance is the place of its first object
+layout(buffer_reference, std430) readonly buffer InstanceBuffer
+{
+	uint instanceObjects[];
+};
+
 layout(set = 0, binding = 0) uniform SceneData
 {
 	mat4 view;
 	mat4 projection;
+	mat4 viewProjection;
 	vec4 ambientColor;
 	vec4 sunlightDirection;
 	vec4 sunlightColor;
 	VertexBuffer vertexBuffer;
+	ObjectBuffer objectBuffer;
+	InstanceBuffer instanceBuffer;
 }sceneData;
 
 layout(set = 1, binding = 0) uniform MaterialData
@@ -1,121 +1,1095 @@
 #include "assetLoading.h"
+#include "Core/jobSystem.h"
+#include "Culling/softwareOcclusion.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include "glm/gtc/packing.hpp"
 
 namespace BlitzenEngine
 {
-    void LoadMeshAsset(std::filesystem::path filepath, std::vector<BlitzenRendering::VulkanVertex>& vertices,
-		    std::vector<uint32_t>& indices, BlitzenRendering::VulkanRenderer* pVulkan)
-    {
-        std::cout << "Loading GLTF: " << filepath << '\n';
+    //When this is true, the color of each vertex is replaced by its normal, which makes the geometry easy to inspect
+    constexpr bool OverrideColors = true;
 
-        //Load the file on to a data buffer
-        fastgltf::GltfDataBuffer data;
-        data.loadFromFile(filepath);
-        
-        //Specify flags for the parser's loading function
-        fastgltf::Options gltfOptions = fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
+    //The attribute streams of a primitive, each one is decoded by a separate job
+    enum class PrimitiveStream : uint8_t
+    {
+        PS_Indices,
+        PS_Positions,
+        PS_Normals,
+        PS_Uvs,
+        PS_Colors,
 
-        //Declare the parser and an object to hold the asset that it will load
-        fastgltf::Asset gltf;
-        fastgltf::Parser parser{};
+        PS_Count
+    };
 
-        fastgltf::Expected load = parser.loadBinaryGLTF(&data, filepath.parent_path(), gltfOptions);
-        if (load) 
+    /*---------------------------------------------------------------------------------------------------
+    The streams write their attributes through these, so that the same decoder can fill both vertex 
+    formats. The compact versions quantize the attribute the way that the compact vertex shader decodes it
+    -----------------------------------------------------------------------------------------------------*/
+    static inline void SetVertexPosition(BlitzenRendering::VulkanVertex& vertex, const glm::vec3& position, 
+    const PrimitiveLoadInfo&)
+    {
+        vertex.position = position;
+    }
+    static inline void SetVertexPosition(BlitzenRendering::CompactVulkanVertex& vertex, const glm::vec3& position, 
+    const PrimitiveLoadInfo& info)
+    {
+        glm::vec3 normalized = glm::clamp((position - info.quantizationOffset) * info.quantizationScale, 0.f, 1.f);
+        for(int axis = 0; axis < 3; ++axis)
         {
-            //If the parser succeeds move the loaded memory to the asset object
-            gltf = std::move(load.get());
+            vertex.position[axis] = static_cast<uint16_t>(normalized[axis] * 65535.f + 0.5f);
         }
-        else 
+        vertex.padding = 0;
+    }
+
+    static inline void SetVertexNormal(BlitzenRendering::VulkanVertex& vertex, const glm::vec3& normal)
+    {
+        vertex.normal = normal;
+    }
+    static inline void SetVertexNormal(BlitzenRendering::CompactVulkanVertex& vertex, const glm::vec3& normal)
+    {
+        //Project the normal on the octahedron and fold the lower hemisphere over the upper one
+        float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+        glm::vec3 projected = length > 0.f ? normal / length : glm::vec3(0.f, 0.f, 1.f);
+        glm::vec2 encoded(projected.x, projected.y);
+        if(projected.z < 0.f)
         {
-            std::cout << "Loading GLTF : " << filepath << " -> Process failed\n";
+            encoded.x = (1.f - glm::abs(projected.y)) * (projected.x >= 0.f ? 1.f : -1.f);
+            encoded.y = (1.f - glm::abs(projected.x)) * (projected.y >= 0.f ? 1.f : -1.f);
         }
+        vertex.normal = glm::packSnorm2x16(encoded);
+    }
 
-        //Start iterating through all the meshes that were load from gltf
-        for(size_t i = 0; i < gltf.meshes.size(); ++i)
-        {
-            //Add a new mesh to the vulkan mesh assets array and save its name
-            pVulkan->m_assets.push_back(BlitzenRendering::VulkanMeshAsset());
-            pVulkan->m_assets[i].meshName = gltf.meshes[i].name;
-            for (auto& primitive : gltf.meshes[i].primitives)
-            {
-                //Create a new surface to represent the current primitive in the mesh list
-                BlitzenRendering::GeoSurface newSurface;
-                newSurface.firstIndex = indices.size();
-                newSurface.indexCount = gltf.accessors[primitive.indicesAccessor.value()].count;
-                newSurface.vertexBufferOffset = vertices.size();
-                pVulkan->m_assets[i].geoSurfaces.push_back(newSurface);
+    static inline void SetVertexUv(BlitzenRendering::VulkanVertex& vertex, const glm::vec2& uv)
+    {
+        vertex.uv_x = uv.x;
+        vertex.uv_y = uv.y;
+    }
+    static inline void SetVertexUv(BlitzenRendering::CompactVulkanVertex& vertex, const glm::vec2& uv)
+    {
+        vertex.uv = glm::packHalf2x16(uv);
+    }
 
-                size_t initialVertex = vertices.size();
+    static inline void SetVertexColor(BlitzenRendering::VulkanVertex& vertex, const glm::vec4& color)
+    {
+        vertex.color = color;
+    }
+    static inline void SetVertexColor(BlitzenRendering::CompactVulkanVertex& vertex, const glm::vec4& color)
+    {
+        vertex.color = glm::packUnorm4x8(color);
+    }
 
-                /* Load indices */
-                fastgltf::Accessor& indexaccessor = gltf.accessors[primitive.indicesAccessor.value()];
-                indices.reserve(indices.size() + indexaccessor.count);
+    /*---------------------------------------------------------------------------------------------------
+    Decodes one attribute stream of a primitive into its range of the vertex or index array.
+    Every stream only writes its own members of the vertices, so the streams of the same primitive 
+    can be decoded at the same time. Streams missing from the primitive write their default values
+    -----------------------------------------------------------------------------------------------------*/
+    template<typename Vertex>
+    static void DecodePrimitiveStream(const fastgltf::Asset& gltf, const PrimitiveLoadInfo& info, 
+    PrimitiveStream stream, Vertex* pVertices, uint32_t* pIndices32, uint16_t* pIndices16)
+    {
+        const fastgltf::Primitive& primitive = *(info.pPrimitive);
+        Vertex* pPrimitiveVertices = pVertices + info.vertexOffset;
 
-                fastgltf::iterateAccessor<std::uint32_t>(gltf, indexaccessor,
-                    [&](std::uint32_t idx) 
+        switch(stream)
+        {
+            case PrimitiveStream::PS_Indices:
+            {
+                //The indices stay local to the primitive, its vertex offset is applied by the draw call
+                const fastgltf::Accessor& indices = gltf.accessors[primitive.indicesAccessor.value()];
+                if(info.indexType == VK_INDEX_TYPE_UINT16)
+                {
+                    fastgltf::copyFromAccessor<std::uint16_t>(gltf, indices, pIndices16 + info.indexOffset);
+                }
+                else
+                {
+                    fastgltf::copyFromAccessor<std::uint32_t>(gltf, indices, pIndices32 + info.indexOffset);
+                }
+                break;
+            }
+            case PrimitiveStream::PS_Positions:
+            {
+                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[primitive.findAttribute("POSITION")->second],
+                    [&](glm::vec3 v, size_t index) 
                     {
-                        indices.push_back(idx + initialVertex);
-                    });
-
-                /* Load vertex positions */
-                fastgltf::Accessor& posAccessor = gltf.accessors[primitive.findAttribute("POSITION")->second];
-                vertices.resize(vertices.size() + posAccessor.count);
-
-                fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
-                    [&](glm::vec3 v, size_t index) {
-                        BlitzenRendering::VulkanVertex newVertex;
-                        newVertex.position = v;
-                        newVertex.normal = { 1, 0, 0 };
-                        newVertex.color = glm::vec4{ 1.f };
-                        newVertex.uv_x = 0;
-                        newVertex.uv_y = 0;
-                        vertices[initialVertex + index] = newVertex;
+                        SetVertexPosition(pPrimitiveVertices[index], v, info);
                     });
+                break;
+            }
+            case PrimitiveStream::PS_Normals:
+            {
+                //The color stream is skipped when the colors are overridden, since they come from the normals
+                for(size_t i = 0; i < info.vertexCount; ++i)
+                {
+                    SetVertexNormal(pPrimitiveVertices[i], glm::vec3(1, 0, 0));
+                    if(OverrideColors)
+                    {
+                        SetVertexColor(pPrimitiveVertices[i], glm::vec4(1, 0, 0, 1));
+                    }
+                }
 
-                /* Load normals */
                 auto normals = primitive.findAttribute("NORMAL");
                 if (normals != primitive.attributes.end()) 
                 {
-                
                     fastgltf::iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[(*normals).second],
                         [&](glm::vec3 v, size_t index) 
                         {
-                            vertices[initialVertex + index].normal = v;
+                            SetVertexNormal(pPrimitiveVertices[index], v);
+                            if(OverrideColors)
+                            {
+                                SetVertexColor(pPrimitiveVertices[index], glm::vec4(v, 1.f));
+                            }
                         });
                 }
+                break;
+            }
+            case PrimitiveStream::PS_Uvs:
+            {
+                for(size_t i = 0; i < info.vertexCount; ++i)
+                {
+                    SetVertexUv(pPrimitiveVertices[i], glm::vec2(0.f));
+                }
 
-                /* Load uv maps */
                 auto uv = primitive.findAttribute("TEXCOORD_0");
-                if (uv != primitive.attributes.end()) {
-                
+                if (uv != primitive.attributes.end()) 
+                {
                     fastgltf::iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[(*uv).second],
                         [&](glm::vec2 v, size_t index) 
                         {
-                            vertices[initialVertex + index].uv_x = v.x;
-                            vertices[initialVertex + index].uv_y = v.y;
+                            SetVertexUv(pPrimitiveVertices[index], v);
                         });
                 }
+                break;
+            }
+            case PrimitiveStream::PS_Colors:
+            {
+                if(OverrideColors)
+                {
+                    break;
+                }
+
+                for(size_t i = 0; i < info.vertexCount; ++i)
+                {
+                    SetVertexColor(pPrimitiveVertices[i], glm::vec4{ 1.f });
+                }
 
-                /* Load vertex colors */
                 auto colors = primitive.findAttribute("COLOR_0");
                 if (colors != primitive.attributes.end())
                 {
-                
                     fastgltf::iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[(*colors).second],
                         [&](glm::vec4 v, size_t index) 
                         {
-                            vertices[initialVertex + index].color = v;
+                            SetVertexColor(pPrimitiveVertices[index], v);
                         });
                 }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    /*---------------------------------------------------------------------------------------------------
+    Gets the bounds of a primitive's positions. The accessor's min and max are required by the glTF spec
+    for positions, but if an exporter left them out the positions are read to find them
+    -----------------------------------------------------------------------------------------------------*/
+    static void GetPositionBounds(const fastgltf::Asset& gltf, const fastgltf::Accessor& positions, 
+    glm::vec3& boundsMin, glm::vec3& boundsMax)
+    {
+        auto pMin = std::get_if<FASTGLTF_STD_PMR_NS::vector<double>>(&positions.min);
+        auto pMax = std::get_if<FASTGLTF_STD_PMR_NS::vector<double>>(&positions.max);
+        if(pMin && pMax && pMin->size() >= 3 && pMax->size() >= 3)
+        {
+            boundsMin = glm::vec3((*pMin)[0], (*pMin)[1], (*pMin)[2]);
+            boundsMax = glm::vec3((*pMax)[0], (*pMax)[1], (*pMax)[2]);
+            return;
+        }
+
+        boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        fastgltf::iterateAccessor<glm::vec3>(gltf, positions, [&](glm::vec3 v)
+        {
+            boundsMin = glm::min(boundsMin, v);
+            boundsMax = glm::max(boundsMax, v);
+        });
+    }
+
+    //Mixes the import options into the hash of the source, so that changing them recooks the mesh
+    static uint64_t HashImportOptions(uint64_t sourceHash, const MeshImportOptions& options)
+    {
+        constexpr uint64_t fnvPrime = 1099511628211ull;
+        uint64_t hash = (sourceHash ^ static_cast<uint64_t>(options.bCompactVertices)) * fnvPrime;
+        hash = (hash ^ static_cast<uint64_t>(options.b16BitIndices)) * fnvPrime;
+        hash = (hash ^ static_cast<uint64_t>(options.bOptimizeVertexCache)) * fnvPrime;
+        hash = (hash ^ static_cast<uint64_t>(options.bOptimizeOverdraw)) * fnvPrime;
+        hash = (hash ^ static_cast<uint64_t>(options.bWeldVertices)) * fnvPrime;
+
+        uint32_t floatBits;
+        memcpy(&floatBits, &options.overdrawThreshold, sizeof(uint32_t));
+        hash = (hash ^ floatBits) * fnvPrime;
+        memcpy(&floatBits, &options.weldEpsilon, sizeof(uint32_t));
+        hash = (hash ^ floatBits) * fnvPrime;
+
+        hash = (hash ^ options.lodCount) * fnvPrime;
+        memcpy(&floatBits, &options.lodReduction, sizeof(uint32_t));
+        hash = (hash ^ floatBits) * fnvPrime;
+        memcpy(&floatBits, &options.lodErrorLimit, sizeof(uint32_t));
+        hash = (hash ^ floatBits) * fnvPrime;
+        hash = (hash ^ static_cast<uint64_t>(options.bBuildMeshlets)) * fnvPrime;
+
+        hash = (hash ^ static_cast<uint64_t>(options.bBuildOccluders)) * fnvPrime;
+        hash = (hash ^ options.occluderTriangleLimit) * fnvPrime;
+        memcpy(&floatBits, &options.occluderErrorLimit, sizeof(uint32_t));
+        hash = (hash ^ floatBits) * fnvPrime;
+        return hash;
+    }
+
+    /*---------------------------------------------------------------------------------------------------
+    Gives every primitive its range of the vertex and index arrays with a prefix sum over their sizes,
+    starting from the import's first offsets, and points the primitive's surface at it. Primitives with 
+    up to 65536 vertices get 16 bit indices if the options allow it. The surfaces get the levels of detail 
+    and meshlets of the processed geometry if there is any, otherwise only the full detail level
+    -----------------------------------------------------------------------------------------------------*/
+    static void LayoutPrimitives(GltfMeshImport& import, BlitzenRendering::VulkanRenderer* pVulkan, 
+    const std::vector<PrimitiveGeometry>* pGeometry = nullptr)
+    {
+        size_t vertexCount = import.firstVertex;
+        size_t index32Count = import.firstIndex32;
+        size_t index16Count = import.firstIndex16;
+        uint32_t meshletCount = 0;
+        for(size_t p = 0; p < import.primitives.size(); ++p)
+        {
+            PrimitiveLoadInfo& info = import.primitives[p];
+            bool b16BitIndices = import.options.b16BitIndices && info.vertexCount <= 65536;
+            info.indexType = b16BitIndices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+            info.vertexOffset = vertexCount;
+            info.indexOffset = b16BitIndices ? index16Count : index32Count;
+
+            BlitzenRendering::GeoSurface& surface = 
+            pVulkan->m_assets[import.firstAsset + info.meshIndex].geoSurfaces[info.surfaceIndex];
+            surface.lodCount = 1;
+            surface.lods[0] = {0, static_cast<uint32_t>(info.indexCount), 0.f};
+            if(pGeometry && !(*pGeometry)[p].lods.empty())
+            {
+                const std::vector<BlitzenRendering::VulkanMeshLod>& lods = (*pGeometry)[p].lods;
+                surface.lodCount = static_cast<uint32_t>(lods.size());
+                std::copy(lods.begin(), lods.end(), surface.lods);
+            }
+            for(uint32_t lod = 0; lod < surface.lodCount; ++lod)
+            {
+                surface.lods[lod].firstIndex += static_cast<uint32_t>(info.indexOffset);
+            }
+            surface.firstMeshlet = meshletCount;
+            surface.meshletCount = pGeometry ? static_cast<uint32_t>((*pGeometry)[p].meshlets.size()) : 0;
+            meshletCount += surface.meshletCount;
+            surface.vertexBufferOffset = static_cast<uint32_t>(info.vertexOffset);
+            surface.indexType = info.indexType;
+
+            vertexCount += info.vertexCount;
+            (b16BitIndices ? index16Count : index32Count) += info.indexCount;
+        }
+
+        import.vertexCount = vertexCount;
+        import.index32Count = index32Count;
+        import.index16Count = index16Count;
+    }
+
+    bool MappedGltfDataBuffer::FromMapping(const MappedFile& file)
+    {
+        //The glb header (magic, version, length) is followed by the JSON chunk's length and type
+        constexpr size_t glbHeaderSize = 3 * sizeof(uint32_t);
+        constexpr size_t glbChunkHeaderSize = 2 * sizeof(uint32_t);
+        if(file.GetSize() < glbHeaderSize + glbChunkHeaderSize)
+        {
+            return false;
+        }
+
+        uint32_t jsonChunkLength;
+        memcpy(&jsonChunkLength, file.GetData() + glbHeaderSize, sizeof(uint32_t));
+        size_t jsonChunkEnd = glbHeaderSize + glbChunkHeaderSize + static_cast<size_t>(jsonChunkLength);
+
+        /*---------------------------------------------------------------------------------------------------
+        The JSON parser reads a few bytes past the end of the JSON chunk. In a glb these normally belong to 
+        the BIN chunk, but reading past the end of the mapping would fault, so small files are copied instead
+        ----------------------------------------------------------------------------------------------------*/
+        if(jsonChunkEnd > file.GetSize() || file.GetSize() - jsonChunkEnd < fastgltf::getGltfBufferPadding())
+        {
+            return copyBytes(file.GetData(), file.GetSize());
+        }
+
+        //The parser only reads from the buffer, so the read only mapping can be used directly
+        bufferPointer = reinterpret_cast<std::byte*>(const_cast<uint8_t*>(file.GetData()));
+        dataSize = file.GetSize();
+        allocatedSize = file.GetSize() + fastgltf::getGltfBufferPadding();
+        return true;
+    }
+
+    //Adds a node and its descendants to the hierarchy in depth first order, so that every node is appended
+    static void ImportSceneNode(const GltfMeshImport& import, size_t gltfNode, BlitzenEngine::TransformHandle parent, 
+    std::vector<uint8_t>& visited, BlitzenEngine::TransformHierarchy& hierarchy)
+    {
+        //A node can only have one parent, a malformed file that reaches it twice would loop forever
+        if(gltfNode >= import.gltf.nodes.size() || visited[gltfNode])
+        {
+            return;
+        }
+        visited[gltfNode] = 1;
+
+        const fastgltf::Node& node = import.gltf.nodes[gltfNode];
+        uint32_t meshAsset = BLITZEN_SCENE_NODE_NONE;
+        if(node.meshIndex.has_value() && node.meshIndex.value() < import.gltf.meshes.size())
+        {
+            meshAsset = static_cast<uint32_t>(import.firstAsset + node.meshIndex.value());
+        }
+        BlitzenEngine::TransformHandle handle = hierarchy.CreateNode(parent, InternAssetName(node.name), meshAsset);
+
+        //The parser decomposes matrices, so every node comes with its TRS
+        if(const fastgltf::Node::TRS* pTRS = std::get_if<fastgltf::Node::TRS>(&node.transform))
+        {
+            //glTF stores the quaternion as xyzw, glm's constructor takes w first
+            hierarchy.SetLocalTransform(handle, glm::vec3(pTRS->translation[0], pTRS->translation[1], pTRS->translation[2]), 
+            glm::quat(pTRS->rotation[3], pTRS->rotation[0], pTRS->rotation[1], pTRS->rotation[2]), 
+            glm::vec3(pTRS->scale[0], pTRS->scale[1], pTRS->scale[2]));
+        }
+
+        for(size_t child : node.children)
+        {
+            ImportSceneNode(import, child, handle, visited, hierarchy);
+        }
+    }
+
+    /*---------------------------------------------------------------------------------------------------
+    Adds the node hierarchy of the glb's default scene to the renderer's scene hierarchy, or of its first 
+    scene if it has no default. Without any scenes, every node that is not the child of another is a root
+    ----------------------------------------------------------------------------------------------------*/
+    static void ImportSceneNodes(GltfMeshImport& import, BlitzenRendering::VulkanRenderer* pVulkan)
+    {
+        const fastgltf::Asset& gltf = import.gltf;
+        BlitzenEngine::TransformHierarchy& hierarchy = pVulkan->m_sceneHierarchy;
+        import.firstNode = hierarchy.GetNodeCount();
+
+        std::vector<size_t> roots;
+        if(!gltf.scenes.empty())
+        {
+            size_t scene = gltf.defaultScene.has_value() && gltf.defaultScene.value() < gltf.scenes.size() ? 
+            gltf.defaultScene.value() : 0;
+            roots.assign(gltf.scenes[scene].nodeIndices.begin(), gltf.scenes[scene].nodeIndices.end());
+        }
+        else
+        {
+            std::vector<uint8_t> isChild(gltf.nodes.size(), 0);
+            for(const fastgltf::Node& node : gltf.nodes)
+            {
+                for(size_t child : node.children)
+                {
+                    if(child < isChild.size())
+                    {
+                        isChild[child] = 1;
+                    }
+                }
+            }
+            for(size_t i = 0; i < gltf.nodes.size(); ++i)
+            {
+                if(!isChild[i])
+                {
+                    roots.push_back(i);
+                }
+            }
+        }
+
+        std::vector<uint8_t> visited(gltf.nodes.size(), 0);
+        hierarchy.Reserve(hierarchy.GetNodeCount() + gltf.nodes.size());
+        for(size_t root : roots)
+        {
+            ImportSceneNode(import, root, BlitzenEngine::TransformHandle(), visited, hierarchy);
+        }
+        import.nodeCount = hierarchy.GetNodeCount() - import.firstNode;
+
+        hierarchy.UpdateWorldTransforms();
+    }
+
+    bool ParseMeshAsset(const std::filesystem::path& filepath, GltfMeshImport& import, 
+    BlitzenRendering::VulkanRenderer* pVulkan, const MeshImportOptions& options, 
+    size_t firstVertex /* =0 */, size_t firstIndex32 /* =0 */, size_t firstIndex16 /* =0 */)
+    {
+        std::cout << "Loading GLTF: " << filepath << '\n';
+
+        import.options = options;
+        import.vertexFormat = options.bCompactVertices ? BlitzenRendering::VulkanVertexFormat::VVF_Compact : 
+        BlitzenRendering::VulkanVertexFormat::VVF_Full;
+
+        //Map the file, the data buffer reads from the mapping instead of loading the file on to the heap
+        if(!import.source.IsOpen() && !import.source.Open(filepath))
+        {
+            std::cout << "Loading GLTF : " << filepath << " -> File could not be opened\n";
+            return false;
+        }
+        if(!import.data.FromMapping(import.source))
+        {
+            std::cout << "Loading GLTF : " << filepath << " -> Not a valid glb\n";
+            return false;
+        }
+        
+        /*-------------------------------------------------------------------------------------------
+        Specify flags for the parser's loading function. The glb buffers are not loaded, so that the 
+        parser leaves the BIN chunk in the mapping and the buffers only hold a view into it
+        --------------------------------------------------------------------------------------------*/
+        fastgltf::Options gltfOptions = fastgltf::Options::LoadExternalBuffers | 
+        fastgltf::Options::DecomposeNodeMatrices;
+
+        //Declare the parser, the asset that it will load is held by the import
+        fastgltf::Asset& gltf = import.gltf;
+        fastgltf::Parser parser{};
+
+        fastgltf::Expected load = parser.loadBinaryGLTF(&import.data, filepath.parent_path(), gltfOptions);
+        if (load) 
+        {
+            //If the parser succeeds move the loaded memory to the asset object
+            gltf = std::move(load.get());
+        }
+        else 
+        {
+            std::cout << "Loading GLTF : " << filepath << " -> Process failed\n";
+            return false;
+        }
+
+        /*---------------------------------------------------------------------------------------------
+        The first phase walks the primitives of every mesh and only reads their accessor counts.
+        A prefix sum over them gives each primitive its own range of the vertex and index arrays,
+        so that the arrays can be allocated once and all primitives can be decoded independently
+        ----------------------------------------------------------------------------------------------*/
+        std::vector<PrimitiveLoadInfo>& primitiveInfos = import.primitives;
+        import.firstAsset = pVulkan->m_assets.size();
+        import.firstVertex = firstVertex;
+        import.firstIndex32 = firstIndex32;
+        import.firstIndex16 = firstIndex16;
+        for(size_t i = 0; i < gltf.meshes.size(); ++i)
+        {
+            //Add a new mesh to the vulkan mesh assets array and save its name
+            pVulkan->m_assets.push_back(BlitzenRendering::VulkanMeshAsset());
+            BlitzenRendering::VulkanMeshAsset& asset = pVulkan->m_assets.back();
+            asset.meshName = gltf.meshes[i].name;
+
+            /*-----------------------------------------------------------------------------------------
+            Compact vertices store their positions relative to the bounds of their mesh. The bounds 
+            are the union of every primitive's bounds, so that all surfaces share the mesh's matrix.
+            Each primitive's own bounds give its surface a bounding sphere
+            ------------------------------------------------------------------------------------------*/
+            size_t firstPrimitive = primitiveInfos.size();
+            glm::vec3 meshMin(std::numeric_limits<float>::max());
+            glm::vec3 meshMax(-std::numeric_limits<float>::max());
+
+            for (auto& primitive : gltf.meshes[i].primitives)
+            {
+                //Primitives without indices or positions have nothing that the renderer can draw
+                auto positions = primitive.findAttribute("POSITION");
+                if(!primitive.indicesAccessor.has_value() || positions == primitive.attributes.end())
+                {
+                    continue;
+                }
+
+                PrimitiveLoadInfo info;
+                info.pPrimitive = &primitive;
+                info.meshIndex = i;
+                info.surfaceIndex = asset.geoSurfaces.size();
+                info.quantizationOffset = glm::vec3(0.f);
+                info.quantizationScale = glm::vec3(1.f);
+                info.vertexCount = gltf.accessors[positions->second].count;
+                info.indexCount = gltf.accessors[primitive.indicesAccessor.value()].count;
+                GetPositionBounds(gltf, gltf.accessors[positions->second], info.boundsMin, info.boundsMax);
+                primitiveInfos.push_back(info);
+                meshMin = glm::min(meshMin, info.boundsMin);
+                meshMax = glm::max(meshMax, info.boundsMax);
+
+                //Create a new surface to represent the current primitive in the mesh list, its ranges are laid out below
+                asset.geoSurfaces.push_back(BlitzenRendering::GeoSurface());
+                asset.geoSurfaces.back().boundsMin = info.boundsMin;
+                asset.geoSurfaces.back().boundsMax = info.boundsMax;
+                asset.geoSurfaces.back().boundingSphere = glm::vec4((info.boundsMin + info.boundsMax) * 0.5f, 
+                glm::length(info.boundsMax - info.boundsMin) * 0.5f);
+            }
+
+            if(options.bCompactVertices && primitiveInfos.size() > firstPrimitive)
+            {
+                //A flat axis still needs a scale that can be inverted
+                glm::vec3 extent = meshMax - meshMin;
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    extent[axis] = extent[axis] > 0.f ? extent[axis] : 1.f;
+                }
+
+                for(size_t p = firstPrimitive; p < primitiveInfos.size(); ++p)
+                {
+                    primitiveInfos[p].quantizationOffset = meshMin;
+                    primitiveInfos[p].quantizationScale = 1.f / extent;
+                }
+                asset.vertexDequantization = glm::translate(meshMin) * glm::scale(extent);
+            }
+        }
+
+        LayoutPrimitives(import, pVulkan);
+        ImportSceneNodes(import, pVulkan);
+
+        std::cout << "Loading GLTF: " << filepath << " -> " << gltf.meshes.size() << " meshes, " << import.nodeCount 
+        << " nodes, " 
+        << primitiveInfos.size() << " primitives, " << import.index16Count - firstIndex16 << " 16 bit and " 
+        << import.index32Count - firstIndex32 << " 32 bit indices\n";
+        return true;
+    }
+
+    void DecodeMeshAsset(const GltfMeshImport& import, void* pVertexData, uint32_t* pIndices32, uint16_t* pIndices16)
+    {
+        //The second phase decodes every attribute stream of every primitive as a separate job
+        constexpr size_t streamCount = static_cast<size_t>(PrimitiveStream::PS_Count);
+        GetJobSystem().ParallelFor(import.primitives.size() * streamCount, [&](size_t job)
+        {
+            const PrimitiveLoadInfo& info = import.primitives[job / streamCount];
+            PrimitiveStream stream = static_cast<PrimitiveStream>(job % streamCount);
+            if(import.vertexFormat == BlitzenRendering::VulkanVertexFormat::VVF_Compact)
+            {
+                DecodePrimitiveStream(import.gltf, info, stream, 
+                reinterpret_cast<BlitzenRendering::CompactVulkanVertex*>(pVertexData), pIndices32, pIndices16);
+            }
+            else
+            {
+                DecodePrimitiveStream(import.gltf, info, stream, 
+                reinterpret_cast<BlitzenRendering::VulkanVertex*>(pVertexData), pIndices32, pIndices16);
+            }
+        });
+    }
+
+    bool RequiresMeshProcessing(const MeshImportOptions& options)
+    {
+        return options.bWeldVertices || options.bOptimizeVertexCache || options.bOptimizeOverdraw || 
+        options.lodCount > 1 || options.bBuildMeshlets || options.bBuildOccluders;
+    }
+
+    //Decodes every stream of a primitive the same way as for the final arrays, only with the primitive at the start of its own
+    static void DecodePrimitive(const GltfMeshImport& import, size_t primitive, PrimitiveGeometry& geometry)
+    {
+        PrimitiveLoadInfo info = import.primitives[primitive];
+        info.vertexOffset = 0;
+        info.indexOffset = 0;
+        info.indexType = VK_INDEX_TYPE_UINT32;
+        geometry.vertices.resize(info.vertexCount);
+        geometry.indices.resize(info.indexCount);
+        for(size_t stream = 0; stream < static_cast<size_t>(PrimitiveStream::PS_Count); ++stream)
+        {
+            DecodePrimitiveStream(import.gltf, info, static_cast<PrimitiveStream>(stream), geometry.vertices.data(), 
+            geometry.indices.data(), nullptr);
+        }
+    }
+
+    //Merges the bit identical vertices of a primitive, after snapping the positions to the epsilon's grid if it is above 0
+    static void WeldPrimitive(PrimitiveGeometry& geometry, float epsilon)
+    {
+        if(epsilon > 0.f)
+        {
+            for(BlitzenRendering::VulkanVertex& vertex : geometry.vertices)
+            {
+                //Adding 0 turns the negative zeros that rounding gives into positive ones, which would not merge
+                vertex.position = glm::round(vertex.position / epsilon) * epsilon + 0.f;
+            }
+        }
+
+        std::vector<uint32_t> remap;
+        size_t uniqueCount = GenerateVertexRemap(geometry.vertices.data(), sizeof(BlitzenRendering::VulkanVertex), 
+        geometry.vertices.size(), remap);
+        if(uniqueCount == geometry.vertices.size())
+        {
+            return;
+        }
+
+        RemapIndices(geometry.indices.data(), geometry.indices.size(), remap);
+        RemapVertices(geometry.vertices.data(), sizeof(BlitzenRendering::VulkanVertex), geometry.vertices.size(), remap);
+        geometry.vertices.resize(uniqueCount);
+        //The primitive is held until every other one is processed, so the merged vertices should not keep their memory
+        geometry.vertices.shrink_to_fit();
+    }
+
+    /*---------------------------------------------------------------------------------------------------
+    Simplifies the full detail indices of a primitive into its coarser levels of detail, which are added
+    after them. Every level starts from the full detail indices with a smaller target, so that the error
+    is always measured against the original surface. Stops early once a level would not remove enough 
+    triangles, which is also what happens when the error limit holds the simplifier back
+    -----------------------------------------------------------------------------------------------------*/
+    static void GeneratePrimitiveLods(PrimitiveGeometry& geometry, const PrimitiveLoadInfo& info, 
+    const MeshImportOptions& options)
+    {
+        uint32_t fullIndexCount = static_cast<uint32_t>(geometry.indices.size());
+        geometry.lods.assign(1, {0, fullIndexCount, 0.f});
+        if(fullIndexCount == 0 || geometry.vertices.empty())
+        {
+            return;
+        }
+
+        uint32_t lodCount = std::min(options.lodCount, static_cast<uint32_t>(BLITZEN_MAX_MESH_LODS));
+        float errorLimit = options.lodErrorLimit * glm::length(info.boundsMax - info.boundsMin) * 0.5f;
+        std::vector<uint32_t> lodIndices(fullIndexCount);
+        float targetRatio = 1.f;
+        while(geometry.lods.size() < lodCount)
+        {
+            targetRatio *= options.lodReduction;
+            size_t targetIndexCount = static_cast<size_t>(fullIndexCount * targetRatio) / 3 * 3;
+
+            float error;
+            size_t indexCount = SimplifyMesh(lodIndices.data(), geometry.indices.data(), fullIndexCount, 
+            &geometry.vertices[0].position.x, sizeof(BlitzenRendering::VulkanVertex), geometry.vertices.size(), 
+            targetIndexCount, errorLimit, error);
+
+            //A level that keeps most of the previous one's triangles is not worth its indices
+            BlitzenRendering::VulkanMeshLod previous = geometry.lods.back();
+            if(indexCount == 0 || indexCount > previous.indexCount * 9 / 10)
+            {
+                break;
+            }
+
+            if(options.bOptimizeVertexCache)
+            {
+                OptimizeVertexCache(lodIndices.data(), indexCount, geometry.vertices.size());
+            }
+
+            geometry.lods.push_back({static_cast<uint32_t>(geometry.indices.size()), static_cast<uint32_t>(indexCount), 
+            std::max(error, previous.error)});
+            geometry.indices.insert(geometry.indices.end(), lodIndices.begin(), lodIndices.begin() + indexCount);
+        }
+    }
+
+    //Splits the full detail level of a primitive into meshlets and gives each one its bounds
+    static void BuildPrimitiveMeshlets(PrimitiveGeometry& geometry, size_t fullIndexCount)
+    {
+        if(fullIndexCount == 0 || geometry.vertices.empty())
+        {
+            return;
+        }
+
+        std::vector<MeshletRange> ranges;
+        BuildMeshlets(geometry.indices.data(), fullIndexCount, geometry.vertices.size(), ranges, 
+        geometry.meshletVertices, geometry.meshletTriangles);
+
+        geometry.meshlets.resize(ranges.size());
+        for(size_t m = 0; m < ranges.size(); ++m)
+        {
+            MeshletBounds bounds = ComputeMeshletBounds(ranges[m], geometry.meshletVertices.data(), 
+            geometry.meshletTriangles.data(), &geometry.vertices[0].position.x, sizeof(BlitzenRendering::VulkanVertex));
+
+            BlitzenRendering::VulkanMeshlet& meshlet = geometry.meshlets[m];
+            meshlet.boundingSphere = glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius);
+            meshlet.coneApex = glm::vec3(bounds.coneApex[0], bounds.coneApex[1], bounds.coneApex[2]);
+            meshlet.coneCutoff = bounds.coneCutoff;
+            meshlet.coneAxis = glm::vec3(bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2]);
+            meshlet.vertexOffset = ranges[m].vertexOffset;
+            meshlet.triangleOffset = ranges[m].triangleOffset;
+            meshlet.vertexCount = ranges[m].vertexCount;
+            meshlet.triangleCount = ranges[m].triangleCount;
+            meshlet.padding = 0;
+        }
+    }
+
+    /*---------------------------------------------------------------------------------------------------
+    Simplifies the full detail level of a primitive into its occluder, which keeps only the positions that
+    its triangles use with the ones that are equal merged, so that the triangles around a seam still know
+    each other as neighbors. Primitives that do not fit in the triangle limit within the error limit get none
+    -----------------------------------------------------------------------------------------------------*/
+    static void BuildPrimitiveOccluder(PrimitiveGeometry& geometry, const PrimitiveLoadInfo& info, 
+    size_t fullIndexCount, const MeshImportOptions& options)
+    {
+        geometry.occluderError = 0.f;
+        if(fullIndexCount == 0 || geometry.vertices.empty())
+        {
+            return;
+        }
+
+        size_t targetIndexCount = static_cast<size_t>(options.occluderTriangleLimit) * 3;
+        std::vector<uint32_t> indices(geometry.indices.begin(), geometry.indices.begin() + fullIndexCount);
+        if(fullIndexCount > targetIndexCount)
+        {
+            float errorLimit = options.occluderErrorLimit * glm::length(info.boundsMax - info.boundsMin) * 0.5f;
+            size_t indexCount = SimplifyMesh(indices.data(), geometry.indices.data(), fullIndexCount, 
+            &geometry.vertices[0].position.x, sizeof(BlitzenRendering::VulkanVertex), geometry.vertices.size(), 
+            targetIndexCount, errorLimit, geometry.occluderError);
+            if(indexCount > targetIndexCount)
+            {
+                return;
+            }
+            indices.resize(indexCount);
+        }
+        if(indices.empty())
+        {
+            return;
+        }
+
+        //Gather the used positions in the order that the triangles reference them, then merge the equal ones
+        std::vector<uint32_t> usedPlaces(geometry.vertices.size(), std::numeric_limits<uint32_t>::max());
+        for(uint32_t& index : indices)
+        {
+            if(usedPlaces[index] == std::numeric_limits<uint32_t>::max())
+            {
+                usedPlaces[index] = static_cast<uint32_t>(geometry.occluderVertices.size());
+                geometry.occluderVertices.push_back(geometry.vertices[index].position);
+            }
+            index = usedPlaces[index];
+        }
+
+        std::vector<uint32_t> remap;
+        size_t uniqueCount = GenerateVertexRemap(geometry.occluderVertices.data(), sizeof(glm::vec3), 
+        geometry.occluderVertices.size(), remap);
+        RemapIndices(indices.data(), indices.size(), remap);
+        RemapVertices(geometry.occluderVertices.data(), sizeof(glm::vec3), geometry.occluderVertices.size(), remap);
+        geometry.occluderVertices.resize(uniqueCount);
+
+        geometry.occluderIndices = std::move(indices);
+        geometry.occluderAdjacency.resize(geometry.occluderIndices.size());
+        BuildOccluderAdjacency(geometry.occluderIndices.data(), geometry.occluderIndices.size(), uniqueCount, 
+        geometry.occluderAdjacency.data());
+    }
+
+    void ProcessMeshAsset(GltfMeshImport& import, std::vector<PrimitiveGeometry>& geometry, 
+    BlitzenRendering::VulkanRenderer* pVulkan)
+    {
+        const MeshImportOptions& options = import.options;
+
+        //The vertex cache statistics before are taken after welding, which is what lets the cache have any hits
+        std::vector<size_t> decodedVertexCounts(import.primitives.size());
+        std::vector<VertexCacheStatistics> statisticsBefore(import.primitives.size());
+        std::vector<VertexCacheStatistics> statisticsAfter(import.primitives.size());
+        geometry.resize(import.primitives.size());
+        GetJobSystem().ParallelFor(import.primitives.size(), [&](size_t p)
+        {
+            DecodePrimitive(import, p, geometry[p]);
+
+            std::vector<BlitzenRendering::VulkanVertex>& vertices = geometry[p].vertices;
+            std::vector<uint32_t>& indices = geometry[p].indices;
+            decodedVertexCounts[p] = vertices.size();
+
+            if(options.bWeldVertices)
+            {
+                WeldPrimitive(geometry[p], options.weldEpsilon);
+            }
+
+            statisticsBefore[p] = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+            if(options.bOptimizeVertexCache)
+            {
+                OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+            }
+
+            if(options.bOptimizeOverdraw && !vertices.empty())
+            {
+                OptimizeOverdraw(indices.data(), indices.size(), &vertices[0].position.x, 
+                sizeof(BlitzenRendering::VulkanVertex), vertices.size(), options.overdrawThreshold);
+            }
+
+            size_t fullIndexCount = indices.size();
+            if(options.lodCount > 1)
+            {
+                GeneratePrimitiveLods(geometry[p], import.primitives[p], options);
+            }
+
+            //The fetch order follows the full detail level first, every level of detail indexes the same vertices
+            if(options.bOptimizeVertexCache)
+            {
+                std::vector<uint32_t> remap;
+                OptimizeVertexFetch(indices.data(), indices.size(), vertices.size(), remap);
+                RemapVertices(vertices.data(), sizeof(BlitzenRendering::VulkanVertex), vertices.size(), remap);
+            }
+
+            statisticsAfter[p] = AnalyzeVertexCache(indices.data(), fullIndexCount, vertices.size());
+
+            if(options.bBuildMeshlets)
+            {
+                BuildPrimitiveMeshlets(geometry[p], fullIndexCount);
+            }
+
+            if(options.bBuildOccluders)
+            {
+                BuildPrimitiveOccluder(geometry[p], import.primitives[p], fullIndexCount, options);
+            }
+        });
+
+        //Welding and simplification changed the sizes of the primitives, so their ranges and index types are laid out again
+        for(size_t p = 0; p < import.primitives.size(); ++p)
+        {
+            import.primitives[p].vertexCount = geometry[p].vertices.size();
+            import.primitives[p].indexCount = geometry[p].indices.size();
+        }
+        LayoutPrimitives(import, pVulkan, &geometry);
+
+        //The occluders stay on the CPU, every surface's occluder is appended to its asset's arrays
+        for(size_t p = 0; p < import.primitives.size(); ++p)
+        {
+            BlitzenRendering::VulkanMeshAsset& asset = pVulkan->m_assets[import.firstAsset + import.primitives[p].meshIndex];
+            BlitzenRendering::GeoSurface& surface = asset.geoSurfaces[import.primitives[p].surfaceIndex];
+            surface.firstOccluderVertex = static_cast<uint32_t>(asset.occluderVertices.size());
+            surface.occluderVertexCount = static_cast<uint32_t>(geometry[p].occluderVertices.size());
+            surface.firstOccluderIndex = static_cast<uint32_t>(asset.occluderIndices.size());
+            surface.occluderIndexCount = static_cast<uint32_t>(geometry[p].occluderIndices.size());
+            surface.occluderError = geometry[p].occluderError;
+            asset.occluderVertices.insert(asset.occluderVertices.end(), geometry[p].occluderVertices.begin(), 
+            geometry[p].occluderVertices.end());
+            asset.occluderIndices.insert(asset.occluderIndices.end(), geometry[p].occluderIndices.begin(), 
+            geometry[p].occluderIndices.end());
+            asset.occluderAdjacency.insert(asset.occluderAdjacency.end(), geometry[p].occluderAdjacency.begin(), 
+            geometry[p].occluderAdjacency.end());
+        }
+
+        //The statistics are reported per mesh asset, adding up the primitives of each mesh
+        size_t vertexStride = BlitzenRendering::GetVertexStride(import.vertexFormat);
+        std::vector<size_t> meshDecodedVertices(import.gltf.meshes.size(), 0);
+        std::vector<size_t> meshWeldedVertices(import.gltf.meshes.size(), 0);
+        std::vector<VertexCacheStatistics> meshBefore(import.gltf.meshes.size());
+        std::vector<VertexCacheStatistics> meshAfter(import.gltf.meshes.size());
+        std::vector<std::vector<size_t>> meshLodTriangles(import.gltf.meshes.size());
+        std::vector<std::vector<float>> meshLodErrors(import.gltf.meshes.size());
+        std::vector<size_t> meshMeshlets(import.gltf.meshes.size(), 0);
+        std::vector<size_t> meshMeshletVertices(import.gltf.meshes.size(), 0);
+        std::vector<size_t> meshOccluderTriangles(import.gltf.meshes.size(), 0);
+        std::vector<float> meshOccluderErrors(import.gltf.meshes.size(), 0.f);
+        for(size_t p = 0; p < import.primitives.size(); ++p)
+        {
+            size_t mesh = import.primitives[p].meshIndex;
+            meshDecodedVertices[mesh] += decodedVertexCounts[p];
+            meshWeldedVertices[mesh] += import.primitives[p].vertexCount;
+            meshBefore[mesh].Accumulate(statisticsBefore[p]);
+            meshAfter[mesh].Accumulate(statisticsAfter[p]);
+            meshMeshlets[mesh] += geometry[p].meshlets.size();
+            meshMeshletVertices[mesh] += geometry[p].meshletVertices.size();
+            meshOccluderTriangles[mesh] += geometry[p].occluderIndices.size() / 3;
+            meshOccluderErrors[mesh] = std::max(meshOccluderErrors[mesh], geometry[p].occluderError);
+
+            for(size_t lod = 1; lod < geometry[p].lods.size(); ++lod)
+            {
+                if(meshLodTriangles[mesh].size() < lod)
+                {
+                    meshLodTriangles[mesh].push_back(0);
+                    meshLodErrors[mesh].push_back(0.f);
+                }
+                meshLodTriangles[mesh][lod - 1] += geometry[p].lods[lod].indexCount / 3;
+                meshLodErrors[mesh][lod - 1] = std::max(meshLodErrors[mesh][lod - 1], geometry[p].lods[lod].error);
+            }
+        }
+
+        size_t totalDecodedVertices = 0;
+        size_t totalWeldedVertices = 0;
+        for(size_t m = 0; m < meshBefore.size(); ++m)
+        {
+            if(meshBefore[m].triangleCount == 0)
+            {
+                continue;
             }
-            constexpr bool OverrideColors = true;
-            if (OverrideColors) 
+            const std::string& meshName = pVulkan->m_assets[import.firstAsset + m].meshName;
+            totalDecodedVertices += meshDecodedVertices[m];
+            totalWeldedVertices += meshWeldedVertices[m];
+
+            if(options.bWeldVertices)
             {
-                for (BlitzenRendering::VulkanVertex& vtx : vertices) 
+                std::cout << "Welding mesh: " << meshName << " -> " << meshDecodedVertices[m] << " to " 
+                << meshWeldedVertices[m] << " vertices, " 
+                << (meshDecodedVertices[m] - meshWeldedVertices[m]) * vertexStride << " bytes saved\n";
+            }
+
+            std::cout << "Optimizing mesh: " << meshName 
+            << " -> ACMR " << meshBefore[m].GetACMR() << " to " << meshAfter[m].GetACMR() 
+            << ", ATVR " << meshBefore[m].GetATVR() << " to " << meshAfter[m].GetATVR() << '\n';
+
+            if(!meshLodTriangles[m].empty())
+            {
+                std::cout << "Simplifying mesh: " << meshName << " -> " << meshAfter[m].triangleCount << " triangles";
+                for(size_t lod = 0; lod < meshLodTriangles[m].size(); ++lod)
                 {
-                    vtx.color = glm::vec4(vtx.normal, 1.f);
+                    std::cout << ", LOD " << lod + 1 << ": " << meshLodTriangles[m][lod] << " triangles, error " 
+                    << meshLodErrors[m][lod];
                 }
+                std::cout << '\n';
+            }
+
+            //Each meshlet vertex is transformed once per meshlet, so their count against the vertices is the meshlets' ATVR
+            if(meshMeshlets[m])
+            {
+                std::cout << "Clustering mesh: " << meshName << " -> " << meshMeshlets[m] << " meshlets, " 
+                << float(meshMeshletVertices[m]) / float(meshMeshlets[m]) << " vertices and " 
+                << float(meshAfter[m].triangleCount) / float(meshMeshlets[m]) << " triangles on average, ATVR " 
+                << float(meshMeshletVertices[m]) / float(meshWeldedVertices[m]) << '\n';
             }
 
+            if(options.bBuildOccluders)
+            {
+                std::cout << "Occluding mesh: " << meshName << " -> " << meshOccluderTriangles[m] 
+                << " occluder triangles, error " << meshOccluderErrors[m] << '\n';
+            }
+        }
+
+        if(options.bWeldVertices)
+        {
+            std::cout << "Welding GLTF: " << totalDecodedVertices << " to " << totalWeldedVertices << " vertices, " 
+            << (totalDecodedVertices - totalWeldedVertices) * vertexStride << " bytes saved\n";
         }
     }
+
+    //Writes the vertices of a processed primitive to its range of the vertex array in the given format
+    template<typename Vertex>
+    static void PackPrimitiveVertices(const PrimitiveLoadInfo& info, const PrimitiveGeometry& geometry, Vertex* pVertices)
+    {
+        Vertex* pPrimitiveVertices = pVertices + info.vertexOffset;
+        for(size_t v = 0; v < geometry.vertices.size(); ++v)
+        {
+            const BlitzenRendering::VulkanVertex& vertex = geometry.vertices[v];
+            SetVertexPosition(pPrimitiveVertices[v], vertex.position, info);
+            SetVertexNormal(pPrimitiveVertices[v], vertex.normal);
+            SetVertexUv(pPrimitiveVertices[v], glm::vec2(vertex.uv_x, vertex.uv_y));
+            SetVertexColor(pPrimitiveVertices[v], vertex.color);
+        }
+    }
+
+    void PackMeshAsset(const GltfMeshImport& import, const std::vector<PrimitiveGeometry>& geometry, 
+    void* pVertexData, uint32_t* pIndices32, uint16_t* pIndices16)
+    {
+        GetJobSystem().ParallelFor(import.primitives.size(), [&](size_t p)
+        {
+            const PrimitiveLoadInfo& info = import.primitives[p];
+            if(import.vertexFormat == BlitzenRendering::VulkanVertexFormat::VVF_Compact)
+            {
+                PackPrimitiveVertices(info, geometry[p], 
+                reinterpret_cast<BlitzenRendering::CompactVulkanVertex*>(pVertexData));
+            }
+            else
+            {
+                PackPrimitiveVertices(info, geometry[p], reinterpret_cast<BlitzenRendering::VulkanVertex*>(pVertexData));
+            }
+
+            const std::vector<uint32_t>& indices = geometry[p].indices;
+            if(info.indexType == VK_INDEX_TYPE_UINT16)
+            {
+                std::copy(indices.begin(), indices.end(), pIndices16 + info.indexOffset);
+            }
+            else
+            {
+                std::copy(indices.begin(), indices.end(), pIndices32 + info.indexOffset);
+            }
+        });
+    }
+
+    void PackMeshletTables(const std::vector<PrimitiveGeometry>& geometry, 
+    std::vector<BlitzenRendering::VulkanMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, 
+    std::vector<uint8_t>& meshletTriangles)
+    {
+        //Every primitive's triangle table ends on 4 bytes, so the offsets stay aligned after they are moved
+        for(const PrimitiveGeometry& primitive : geometry)
+        {
+            uint32_t vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+            uint32_t triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+            for(BlitzenRendering::VulkanMeshlet meshlet : primitive.meshlets)
+            {
+                meshlet.vertexOffset += vertexOffset;
+                meshlet.triangleOffset += triangleOffset;
+                meshlets.push_back(meshlet);
+            }
+            meshletVertices.insert(meshletVertices.end(), primitive.meshletVertices.begin(), primitive.meshletVertices.end());
+            meshletTriangles.insert(meshletTriangles.end(), primitive.meshletTriangles.begin(), 
+            primitive.meshletTriangles.end());
+        }
+    }
+
+    void LoadMeshAsset(std::filesystem::path filepath, std::vector<BlitzenRendering::VulkanVertex>& vertices,
+		    std::vector<uint32_t>& indices, BlitzenRendering::VulkanRenderer* pVulkan)
+    {
+        //The vectors hold full vertices and 32 bit indices, so the geometry is not quantized. There is nowhere to put meshlets
+        MeshImportOptions options;
+        options.bCompactVertices = false;
+        options.b16BitIndices = false;
+        options.bBuildMeshlets = false;
+
+        GltfMeshImport import;
+        if(!ParseMeshAsset(filepath, import, pVulkan, options, vertices.size(), indices.size()))
+        {
+            return;
+        }
+
+        if(!RequiresMeshProcessing(options))
+        {
+            vertices.resize(import.vertexCount);
+            indices.resize(import.index32Count);
+            DecodeMeshAsset(import, vertices.data(), indices.data(), nullptr);
+            return;
+        }
+
+        std::vector<PrimitiveGeometry> geometry;
+        ProcessMeshAsset(import, geometry, pVulkan);
+        vertices.resize(import.vertexCount);
+        indices.resize(import.index32Count);
+        PackMeshAsset(import, geometry, vertices.data(), indices.data(), nullptr);
+    }
+
+    void LoadCachedMeshAsset(std::filesystem::path filepath, BlitzenRendering::VulkanRenderer* pVulkan, 
+    const MeshImportOptions& options /* =MeshImportOptions() */)
+    {
+        /*-------------------------------------------------------------------------------------------------
+        The hash of the source decides if the cooked file can be used. The source stays mapped, 
+        so that if it needs to be imported again the parser reads from the same mapping
+        --------------------------------------------------------------------------------------------------*/
+        GltfMeshImport import;
+        uint64_t sourceHash = 0;
+        if(import.source.Open(filepath))
+        {
+            sourceHash = HashFileContents(import.source.GetData(), import.source.GetSize());
+        }
+        sourceHash = HashImportOptions(sourceHash, options);
+
+        std::filesystem::path cookedPath = GetCookedMeshPath(filepath);
+        if(LoadCookedMesh(cookedPath, sourceHash, pVulkan))
+        {
+            std::cout << "Loading cooked mesh: " << cookedPath << '\n';
+            return;
+        }
+
+        if(!ParseMeshAsset(filepath, import, pVulkan, options))
+        {
+            return;
+        }
+
+        /*-------------------------------------------------------------------------------------------------
+        Welding, simplification and the index types that follow from them decide the size of the geometry, 
+        so processing happens on the CPU before the staging buffer is mapped. The welded primitives are held
+        in full vertices on top of the staging buffer, but only while the mesh is cooked, cooked meshes are 
+        read straight into the staging buffer. Without processing the size is known after parsing and the 
+        primitives are decoded straight into the staging buffer
+        --------------------------------------------------------------------------------------------------*/
+        bool bProcess = RequiresMeshProcessing(options);
+        std::vector<PrimitiveGeometry> geometry;
+        std::vector<BlitzenRendering::VulkanMeshlet> meshlets;
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint8_t> meshletTriangles;
+        if(bProcess)
+        {
+            ProcessMeshAsset(import, geometry, pVulkan);
+            PackMeshletTables(geometry, meshlets, meshletVertices, meshletTriangles);
+        }
+
+        BlitzenRendering::MeshBufferStaging staging;
+        pVulkan->BeginMeshBufferUpload(staging, import.vertexFormat, import.vertexCount, import.index32Count, 
+        import.index16Count);
+        if(bProcess)
+        {
+            PackMeshAsset(import, geometry, staging.pVertexData, staging.pIndices32, staging.pIndices16);
+            //Everything else that processing made is in the assets and the meshlet tables by now
+            geometry.clear();
+        }
+        else
+        {
+            DecodeMeshAsset(import, staging.pVertexData, staging.pIndices32, staging.pIndices16);
+        }
+
+        //The cooked file is written from the staging memory as well
+        WriteCookedMesh(cookedPath, sourceHash, staging.vertexFormat, staging.pVertexData, staging.vertexCount, 
+        staging.pIndices32, staging.index32Count, staging.pIndices16, staging.index16Count, meshlets.data(), 
+        meshlets.size(), meshletVertices.data(), meshletVertices.size(), meshletTriangles.data(), 
+        meshletTriangles.size(), pVulkan->m_assets, pVulkan->m_sceneHierarchy);
+
+        pVulkan->EndMeshBufferUpload(staging);
+        pVulkan->LoadMeshletBuffers(meshlets.data(), meshlets.size(), meshletVertices.data(), meshletVertices.size(), 
+        meshletTriangles.data(), meshletTriangles.size());
+    }
 }
@@ -2,9 +2,190 @@
 #include "fastgltf/tools.hpp"
 #include "fastgltf/glm_element_traits.hpp"
 #include "BlitzenVulkan/vulkanRenderer.h"
+#include "meshCache.h"
+#include "mappedFile.h"
+#include "meshOptimizer.h"
 
 namespace BlitzenEngine
 {
+	//Decides how the geometry of an imported glb is processed before it reaches the renderer
+	struct MeshImportOptions
+	{
+		//Merge the vertices of a primitive that are bit identical, rewriting its indices
+		bool bWeldVertices = true;
+		//When above 0, positions are first snapped to a grid of this size, so that vertices closer than it can merge
+		float weldEpsilon = 0.f;
+
+		//Decode the vertices to CompactVulkanVertex instead of VulkanVertex
+		bool bCompactVertices = true;
+
+		//Primitives with up to 65536 vertices get 16 bit indices instead of 32 bit
+		bool b16BitIndices = true;
+
+		//Reorder the triangles for the post transform cache and the vertices for fetch locality
+		bool bOptimizeVertexCache = true;
+
+		//Sort clusters of triangles by how likely they are to occlude the rest, after the cache optimization
+		bool bOptimizeOverdraw = true;
+		//How much worse than the cache optimized ACMR the overdraw clusters are allowed to get
+		float overdrawThreshold = 1.05f;
+
+		//Levels of detail of every surface, counting the full detail one, up to BLITZEN_MAX_MESH_LODS. 1 turns simplification off
+		uint32_t lodCount = 4;
+		//The triangle count of each level as a fraction of the previous one
+		float lodReduction = 0.5f;
+		//Simplification stops early once its error reaches this fraction of the surface's bounding radius
+		float lodErrorLimit = 0.1f;
+
+		//Split the full detail level of every surface into meshlets with bounds for cluster culling
+		bool bBuildMeshlets = true;
+
+		//Simplify every surface into an occluder for the software occlusion culling
+		bool bBuildOccluders = true;
+		//Surfaces that cannot be simplified to this many triangles get no occluder, since it would cost too much to draw
+		uint32_t occluderTriangleLimit = 256;
+		//The occluder's simplification may not move it further than this fraction of the surface's bounding radius
+		float occluderErrorLimit = 0.05f;
+	};
+
+	//Where a primitive's data goes in the vertex and index arrays, found before any of its data is decoded
+	struct PrimitiveLoadInfo
+	{
+		const fastgltf::Primitive* pPrimitive;
+		//The glTF mesh that the primitive belongs to, its asset is the import's first asset plus this
+		size_t meshIndex;
+		//The primitive's surface in its mesh asset
+		size_t surfaceIndex;
+
+		size_t vertexOffset;
+		size_t vertexCount;
+
+		//The indices are local to the primitive, the offset is in the array of the primitive's index type
+		size_t indexOffset;
+		size_t indexCount;
+		VkIndexType indexType;
+
+		//The bounds of the primitive's positions, in the mesh's space
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+
+		//Takes positions to the [0, 1] range of their mesh's bounds when the vertices are compact
+		glm::vec3 quantizationOffset;
+		glm::vec3 quantizationScale;
+	};
+
+	/*----------------------------------------------------------------------------------------------------
+	A glTF data buffer that reads a glb in place from its read only file mapping. The JSON chunk is parsed
+	straight from the mapping and the BIN chunk is referenced by the asset's buffers instead of copied
+	-----------------------------------------------------------------------------------------------------*/
+	class MappedGltfDataBuffer : public fastgltf::GltfDataBuffer
+	{
+	public:
+		/*------------------------------------------------------------------------------------------------
+		Points the buffer at the mapping, which has to outlive both this and the parsed asset.
+		If the JSON chunk is not followed by enough bytes for the parser's padding, it falls back to a copy
+		-------------------------------------------------------------------------------------------------*/
+		bool FromMapping(const MappedFile& file);
+	};
+
+	//A parsed glTF along with the layout of its geometry. The primitive infos point into the asset, so it should not be moved
+	struct GltfMeshImport
+	{
+		//The source file and the data buffer reading from it, the asset's buffers point into the mapping
+		MappedFile source;
+		MappedGltfDataBuffer data;
+
+		fastgltf::Asset gltf;
+		std::vector<PrimitiveLoadInfo> primitives;
+
+		MeshImportOptions options;
+		//The place of the glb's first mesh in the renderer's assets
+		size_t firstAsset = 0;
+		//The place of the glb's first scene node in the renderer's scene hierarchy, and how many of them it added
+		size_t firstNode = 0;
+		size_t nodeCount = 0;
+		BlitzenRendering::VulkanVertexFormat vertexFormat = BlitzenRendering::VulkanVertexFormat::VVF_Full;
+
+		//Where the glb's geometry starts in the vertex and index arrays
+		size_t firstVertex = 0;
+		size_t firstIndex32 = 0;
+		size_t firstIndex16 = 0;
+
+		//The size that the vertex and index arrays need to hold every primitive
+		size_t vertexCount = 0;
+		size_t index32Count = 0;
+		size_t index16Count = 0;
+	};
+
+	/*---------------------------------------------------------------------------------------------------
+	Parses the glb, adds its meshes to the renderer's assets and the node hierarchy of its scene to the
+	renderer's scene hierarchy, and gives every primitive its range of the vertex and index arrays, starting 
+	from the given offsets. No geometry is decoded yet.
+	The file is mapped into the import's source, unless the caller has already mapped it there
+	----------------------------------------------------------------------------------------------------*/
+	bool ParseMeshAsset(const std::filesystem::path& filepath, GltfMeshImport& import, 
+	BlitzenRendering::VulkanRenderer* pVulkan, const MeshImportOptions& options, 
+	size_t firstVertex = 0, size_t firstIndex32 = 0, size_t firstIndex16 = 0);
+
+	/*---------------------------------------------------------------------------------------------------
+	The geometry of a single primitive while it is processed, always full vertices with indices local to
+	the primitive. The indices of every level of detail are stored one after the other, the lods point 
+	into them. While it is empty, every index belongs to the full detail level. 
+	The meshlets' offsets are local to the primitive's meshlet tables as well
+	----------------------------------------------------------------------------------------------------*/
+	struct PrimitiveGeometry
+	{
+		std::vector<BlitzenRendering::VulkanVertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<BlitzenRendering::VulkanMeshLod> lods;
+
+		std::vector<BlitzenRendering::VulkanMeshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint8_t> meshletTriangles;
+
+		//The occluder only has positions, which it shares between its triangles, and the neighbors of every triangle
+		std::vector<glm::vec3> occluderVertices;
+		std::vector<uint32_t> occluderIndices;
+		std::vector<uint32_t> occluderAdjacency;
+		float occluderError = 0.f;
+	};
+
+	//True if the options enable any stage that needs the geometry decoded to PrimitiveGeometry first
+	bool RequiresMeshProcessing(const MeshImportOptions& options);
+
+	/*---------------------------------------------------------------------------------------------------
+	Decodes the geometry of every primitive in parallel, the arrays must be big enough for the import's 
+	sizes. The vertex array holds elements of the import's vertex format
+	----------------------------------------------------------------------------------------------------*/
+	void DecodeMeshAsset(const GltfMeshImport& import, void* pVertexData, uint32_t* pIndices32, uint16_t* pIndices16);
+
+	/*---------------------------------------------------------------------------------------------------
+	Decodes every primitive to its own PrimitiveGeometry and runs the processing stages that the import's
+	options enable on it. Each primitive is decoded and processed by the same parallel job, so the decoded
+	primitives are never all held at once, only the welded ones. Since welding and simplification change 
+	the size of the primitives, their ranges, index types and surfaces are laid out again afterwards, along
+	with the import's sizes. Logs the welding, vertex cache, level of detail and occluder statistics of 
+	every mesh asset
+	----------------------------------------------------------------------------------------------------*/
+	void ProcessMeshAsset(GltfMeshImport& import, std::vector<PrimitiveGeometry>& geometry, 
+	BlitzenRendering::VulkanRenderer* pVulkan);
+
+	//Writes processed geometry to the arrays in the import's vertex format, at the ranges that processing laid out
+	void PackMeshAsset(const GltfMeshImport& import, const std::vector<PrimitiveGeometry>& geometry, 
+	void* pVertexData, uint32_t* pIndices32, uint16_t* pIndices16);
+
+	//Appends the meshlets of every processed primitive to the tables that the renderer's meshlet buffers are loaded with
+	void PackMeshletTables(const std::vector<PrimitiveGeometry>& geometry, 
+	std::vector<BlitzenRendering::VulkanMeshlet>& meshlets, std::vector<uint32_t>& meshletVertices, 
+	std::vector<uint8_t>& meshletTriangles);
+
 	void LoadMeshAsset(std::filesystem::path filepath, std::vector<BlitzenRendering::VulkanVertex>& vertices,
 		       	std::vector<uint32_t>&	indices,BlitzenRendering::VulkanRenderer* pVulkan);
+
+	/*----------------------------------------------------------------------------------------------
+	Loads the mesh asset from its cooked file if it is up to date with the source glb and loads the
+	renderer's mesh buffers with it. Otherwise the glb is parsed and cooked for the next startup
+	-----------------------------------------------------------------------------------------------*/
+	void LoadCachedMeshAsset(std::filesystem::path filepath, BlitzenRendering::VulkanRenderer* pVulkan, 
+	const MeshImportOptions& options = MeshImportOptions());
 }
@@ -0,0 +1,114 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace BlitzenEngine
+{
+    bool MappedFile::Open(const std::filesystem::path& filepath)
+    {
+        //A mapped file object only holds one mapping at a time
+        Close();
+
+    #ifdef _WIN32
+        HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize{};
+        //Empty files can not be mapped, so they are treated as missing
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mapping)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(!pView)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+        m_pData = reinterpret_cast<const uint8_t*>(pView);
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+    #else
+        int file = open(filepath.c_str(), O_RDONLY);
+        if(file < 0)
+        {
+            return false;
+        }
+
+        struct stat fileStats{};
+        //Empty files can not be mapped, so they are treated as missing
+        if(fstat(file, &fileStats) != 0 || fileStats.st_size == 0)
+        {
+            close(file);
+            return false;
+        }
+
+        void* pView = mmap(nullptr, static_cast<size_t>(fileStats.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        //The mapping keeps its own reference to the file, so the descriptor is not needed anymore
+        close(file);
+        if(pView == MAP_FAILED)
+        {
+            return false;
+        }
+
+        //Asset files are read front to back by the loaders
+        madvise(pView, static_cast<size_t>(fileStats.st_size), MADV_SEQUENTIAL);
+
+        m_pData = reinterpret_cast<const uint8_t*>(pView);
+        m_size = static_cast<size_t>(fileStats.st_size);
+    #endif
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if(!m_pData)
+        {
+            return;
+        }
+
+    #ifdef _WIN32
+        UnmapViewOfFile(m_pData);
+        CloseHandle(reinterpret_cast<HANDLE>(m_mappingHandle));
+        CloseHandle(reinterpret_cast<HANDLE>(m_fileHandle));
+    #else
+        munmap(const_cast<uint8_t*>(m_pData), m_size);
+    #endif
+
+        m_pData = nullptr;
+        m_size = 0;
+        m_fileHandle = nullptr;
+        m_mappingHandle = nullptr;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+}
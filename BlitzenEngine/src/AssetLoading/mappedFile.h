@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+namespace BlitzenEngine
+{
+    /*--------------------------------------------------------------------------------------------
+    Read only memory mapping of a file. Asset files are accessed through this so that the loaders
+    can read them in place, without first copying the whole file to a heap allocation
+    ---------------------------------------------------------------------------------------------*/
+    class MappedFile
+    {
+    public:
+        //Maps the whole file, returns false if the file does not exist or could not be mapped
+        bool Open(const std::filesystem::path& filepath);
+
+        //Unmaps the file, the pointer returned by GetData should not be used after this
+        void Close();
+
+        inline const uint8_t* GetData() const {return m_pData;}
+        inline size_t GetSize() const {return m_size;}
+        inline bool IsOpen() const {return m_pData != nullptr;}
+
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile& file) = delete;
+        MappedFile& operator = (const MappedFile& file) = delete;
+
+    private:
+
+        const uint8_t* m_pData = nullptr;
+        size_t m_size = 0;
+
+        //Platform handles, the file mapping object is only used on Windows
+        void* m_fileHandle = nullptr;
+        void* m_mappingHandle = nullptr;
+    };
+}
@@ -0,0 +1,475 @@
+#include "meshCache.h"
+#include "mappedFile.h"
+#include "Culling/softwareOcclusion.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace BlitzenEngine
+{
+    uint64_t HashFileContents(const uint8_t* pData, size_t size)
+    {
+        /*--------------------------------------------------------------------------------------------
+        FNV-1a applied to 8 bytes at a time, so that hashing a large source file on every startup
+        stays much cheaper than parsing it. The size is mixed in so that truncated files never match
+        ----------------------------------------------------------------------------------------------*/
+        constexpr uint64_t fnvOffsetBasis = 14695981039346656037ull;
+        constexpr uint64_t fnvPrime = 1099511628211ull;
+
+        uint64_t hash = fnvOffsetBasis ^ static_cast<uint64_t>(size);
+        size_t wordCount = size / sizeof(uint64_t);
+        for(size_t i = 0; i < wordCount; ++i)
+        {
+            uint64_t word;
+            memcpy(&word, pData + i * sizeof(uint64_t), sizeof(uint64_t));
+            hash = (hash ^ word) * fnvPrime;
+        }
+
+        for(size_t i = wordCount * sizeof(uint64_t); i < size; ++i)
+        {
+            hash = (hash ^ pData[i]) * fnvPrime;
+        }
+
+        return hash;
+    }
+
+    std::filesystem::path GetCookedMeshPath(const std::filesystem::path& sourcePath)
+    {
+        std::filesystem::path cookedPath = sourcePath;
+        cookedPath.replace_extension(BLITZEN_COOKED_MESH_EXTENSION);
+        return cookedPath;
+    }
+
+    //Writes a section at the next aligned offset of the file and saves its place in the header
+    static void WriteCookedMeshSection(std::ofstream& file, CookedMeshHeader& header, CookedMeshSection section,
+    const void* pData, size_t size)
+    {
+        uint64_t offset = static_cast<uint64_t>(file.tellp());
+        uint64_t alignedOffset = (offset + BLITZEN_COOKED_MESH_ALIGNMENT - 1) &
+        ~static_cast<uint64_t>(BLITZEN_COOKED_MESH_ALIGNMENT - 1);
+
+        const char padding[BLITZEN_COOKED_MESH_ALIGNMENT] = {};
+        file.write(padding, static_cast<std::streamsize>(alignedOffset - offset));
+        if(size)
+        {
+            file.write(reinterpret_cast<const char*>(pData), static_cast<std::streamsize>(size));
+        }
+
+        header.sections[static_cast<size_t>(section)].offset = alignedOffset;
+        header.sections[static_cast<size_t>(section)].size = size;
+    }
+
+    bool WriteCookedMesh(const std::filesystem::path& cookedPath, uint64_t sourceHash,
+    BlitzenRendering::VulkanVertexFormat vertexFormat, const void* pVertexData, size_t vertexCount, 
+    const uint32_t* pIndices32, size_t index32Count, const uint16_t* pIndices16, size_t index16Count, 
+    const BlitzenRendering::VulkanMeshlet* pMeshlets, size_t meshletCount, const uint32_t* pMeshletVertices, 
+    size_t meshletVertexCount, const uint8_t* pMeshletTriangles, size_t meshletTriangleSize, 
+    const std::vector<BlitzenRendering::VulkanMeshAsset>& assets, 
+    const BlitzenEngine::TransformHierarchy& hierarchy)
+    {
+        //Flatten the asset tables, mesh names are packed one after the other in a single section
+        std::vector<CookedMesh> meshes(assets.size());
+        std::vector<CookedSurface> surfaces;
+        std::vector<char> names;
+        std::vector<glm::vec3> occluderVertices;
+        std::vector<uint32_t> occluderIndices;
+        std::vector<uint32_t> occluderAdjacency;
+        for(size_t i = 0; i < assets.size(); ++i)
+        {
+            meshes[i].firstSurface = static_cast<uint32_t>(surfaces.size());
+            meshes[i].surfaceCount = static_cast<uint32_t>(assets[i].geoSurfaces.size());
+            meshes[i].nameOffset = static_cast<uint32_t>(names.size());
+            meshes[i].nameLength = static_cast<uint32_t>(assets[i].meshName.size());
+            names.insert(names.end(), assets[i].meshName.begin(), assets[i].meshName.end());
+
+            //The dequantization matrix only ever holds a scale followed by a translation
+            const glm::mat4& dequantization = assets[i].vertexDequantization;
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                meshes[i].dequantizationOffset[axis] = dequantization[3][axis];
+                meshes[i].dequantizationScale[axis] = dequantization[axis][axis];
+            }
+
+            meshes[i].firstOccluderVertex = static_cast<uint32_t>(occluderVertices.size());
+            meshes[i].occluderVertexCount = static_cast<uint32_t>(assets[i].occluderVertices.size());
+            meshes[i].firstOccluderIndex = static_cast<uint32_t>(occluderIndices.size());
+            meshes[i].occluderIndexCount = static_cast<uint32_t>(assets[i].occluderIndices.size());
+            occluderVertices.insert(occluderVertices.end(), assets[i].occluderVertices.begin(), 
+            assets[i].occluderVertices.end());
+            occluderIndices.insert(occluderIndices.end(), assets[i].occluderIndices.begin(), 
+            assets[i].occluderIndices.end());
+            occluderAdjacency.insert(occluderAdjacency.end(), assets[i].occluderAdjacency.begin(), 
+            assets[i].occluderAdjacency.end());
+
+            for(const BlitzenRendering::GeoSurface& surface : assets[i].geoSurfaces)
+            {
+                CookedSurface cookedSurface{};
+                cookedSurface.lodCount = surface.lodCount;
+                for(uint32_t lod = 0; lod < surface.lodCount; ++lod)
+                {
+                    cookedSurface.lods[lod].firstIndex = surface.lods[lod].firstIndex;
+                    cookedSurface.lods[lod].indexCount = surface.lods[lod].indexCount;
+                    cookedSurface.lods[lod].error = surface.lods[lod].error;
+                }
+                for(int component = 0; component < 3; ++component)
+                {
+                    cookedSurface.boundsMin[component] = surface.boundsMin[component];
+                    cookedSurface.boundsMax[component] = surface.boundsMax[component];
+                }
+                for(int component = 0; component < 4; ++component)
+                {
+                    cookedSurface.boundingSphere[component] = surface.boundingSphere[component];
+                }
+                cookedSurface.vertexBufferOffset = surface.vertexBufferOffset;
+                cookedSurface.indexType = static_cast<uint32_t>(surface.indexType);
+                cookedSurface.firstMeshlet = surface.firstMeshlet;
+                cookedSurface.meshletCount = surface.meshletCount;
+                cookedSurface.firstOccluderVertex = surface.firstOccluderVertex;
+                cookedSurface.occluderVertexCount = surface.occluderVertexCount;
+                cookedSurface.firstOccluderIndex = surface.firstOccluderIndex;
+                cookedSurface.occluderIndexCount = surface.occluderIndexCount;
+                cookedSurface.occluderError = surface.occluderError;
+                surfaces.push_back(cookedSurface);
+            }
+        }
+
+        std::vector<CookedNode> cookedNodes(hierarchy.GetNodeCount());
+        for(size_t i = 0; i < cookedNodes.size(); ++i)
+        {
+            CookedNode& cookedNode = cookedNodes[i];
+            const std::string& name = GetAssetName(hierarchy.GetNames()[i]);
+            const glm::vec3& translation = hierarchy.GetTranslations()[i];
+            const glm::quat& rotation = hierarchy.GetRotations()[i];
+            const glm::vec3& scale = hierarchy.GetScales()[i];
+            cookedNode.parent = hierarchy.GetParents()[i];
+            cookedNode.subtreeSize = hierarchy.GetSubtreeSizes()[i];
+            cookedNode.meshAsset = hierarchy.GetMeshAssets()[i];
+            cookedNode.nameOffset = static_cast<uint32_t>(names.size());
+            cookedNode.nameLength = static_cast<uint32_t>(name.size());
+            names.insert(names.end(), name.begin(), name.end());
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                cookedNode.translation[axis] = translation[axis];
+                cookedNode.scale[axis] = scale[axis];
+            }
+            cookedNode.rotation[0] = rotation.x;
+            cookedNode.rotation[1] = rotation.y;
+            cookedNode.rotation[2] = rotation.z;
+            cookedNode.rotation[3] = rotation.w;
+        }
+
+        //The file is written under a temporary name and only replaces the old one when it is complete
+        std::filesystem::path temporaryPath = cookedPath;
+        temporaryPath += ".tmp";
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+        {
+            std::cout << "Cooking mesh: " << cookedPath << " -> Could not create file\n";
+            return false;
+        }
+
+        //The header is written last, a placeholder holds its place until the section offsets are known
+        CookedMeshHeader header{};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CookedMeshHeader));
+
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Meshes, meshes.data(),
+        meshes.size() * sizeof(CookedMesh));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Surfaces, surfaces.data(),
+        surfaces.size() * sizeof(CookedSurface));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Names, names.data(), names.size());
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Vertices, pVertexData,
+        vertexCount * BlitzenRendering::GetVertexStride(vertexFormat));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Indices32, pIndices32,
+        index32Count * sizeof(uint32_t));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Indices16, pIndices16,
+        index16Count * sizeof(uint16_t));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Meshlets, pMeshlets,
+        meshletCount * sizeof(BlitzenRendering::VulkanMeshlet));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_MeshletVertices, pMeshletVertices,
+        meshletVertexCount * sizeof(uint32_t));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_MeshletTriangles, pMeshletTriangles,
+        meshletTriangleSize);
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_Nodes, cookedNodes.data(),
+        cookedNodes.size() * sizeof(CookedNode));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_OccluderVertices, occluderVertices.data(),
+        occluderVertices.size() * sizeof(glm::vec3));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_OccluderIndices, occluderIndices.data(),
+        occluderIndices.size() * sizeof(uint32_t));
+        WriteCookedMeshSection(file, header, CookedMeshSection::CMS_OccluderAdjacency, occluderAdjacency.data(),
+        occluderAdjacency.size() * sizeof(uint32_t));
+
+        header.magic = BLITZEN_COOKED_MESH_MAGIC;
+        header.version = BLITZEN_COOKED_MESH_VERSION;
+        header.sourceHash = sourceHash;
+        header.vertexFormat = static_cast<uint32_t>(vertexFormat);
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CookedMeshHeader));
+        file.close();
+
+        if(file.fail())
+        {
+            std::cout << "Cooking mesh: " << cookedPath << " -> Write failed\n";
+            std::filesystem::remove(temporaryPath);
+            return false;
+        }
+
+        std::error_code renameError;
+        std::filesystem::rename(temporaryPath, cookedPath, renameError);
+        if(renameError)
+        {
+            std::cout << "Cooking mesh: " << cookedPath << " -> " << renameError.message() << '\n';
+            std::filesystem::remove(temporaryPath);
+            return false;
+        }
+
+        return true;
+    }
+
+    //Returns a pointer to a section of the mapped file, or nullptr if the section does not fit in the file
+    static const uint8_t* GetCookedMeshSection(const MappedFile& file, const CookedMeshHeader& header,
+    CookedMeshSection section, size_t elementSize, size_t& elementCount)
+    {
+        const CookedMeshSectionEntry& entry = header.sections[static_cast<size_t>(section)];
+        if(entry.offset > file.GetSize() || entry.size > file.GetSize() - entry.offset || entry.size % elementSize)
+        {
+            return nullptr;
+        }
+
+        elementCount = static_cast<size_t>(entry.size / elementSize);
+        return file.GetData() + entry.offset;
+    }
+
+    bool LoadCookedMesh(const std::filesystem::path& cookedPath, uint64_t sourceHash,
+    BlitzenRendering::VulkanRenderer* pVulkan)
+    {
+        MappedFile file;
+        if(!file.Open(cookedPath) || file.GetSize() < sizeof(CookedMeshHeader))
+        {
+            return false;
+        }
+
+        CookedMeshHeader header;
+        memcpy(&header, file.GetData(), sizeof(CookedMeshHeader));
+        if(header.magic != BLITZEN_COOKED_MESH_MAGIC || header.version != BLITZEN_COOKED_MESH_VERSION)
+        {
+            std::cout << "Loading cooked mesh: " << cookedPath << " -> Unknown format, recooking\n";
+            return false;
+        }
+        if(header.sourceHash != sourceHash)
+        {
+            std::cout << "Loading cooked mesh: " << cookedPath << " -> Source changed, recooking\n";
+            return false;
+        }
+        if(header.vertexFormat > static_cast<uint32_t>(BlitzenRendering::VulkanVertexFormat::VVF_Compact))
+        {
+            std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+            return false;
+        }
+        BlitzenRendering::VulkanVertexFormat vertexFormat = 
+        static_cast<BlitzenRendering::VulkanVertexFormat>(header.vertexFormat);
+
+        size_t meshCount, surfaceCount, nameSize, vertexCount, index32Count, index16Count;
+        size_t meshletCount, meshletVertexCount, meshletTriangleSize, nodeCount;
+        size_t occluderVertexCount, occluderIndexCount, occluderAdjacencyCount;
+        const CookedMesh* pMeshes = reinterpret_cast<const CookedMesh*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_Meshes, sizeof(CookedMesh), meshCount));
+        const CookedSurface* pSurfaces = reinterpret_cast<const CookedSurface*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_Surfaces, sizeof(CookedSurface), surfaceCount));
+        const char* pNames = reinterpret_cast<const char*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_Names, 1, nameSize));
+        const uint8_t* pVertexData = GetCookedMeshSection(file, header, CookedMeshSection::CMS_Vertices, 
+        BlitzenRendering::GetVertexStride(vertexFormat), vertexCount);
+        const uint32_t* pIndices32 = reinterpret_cast<const uint32_t*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_Indices32, sizeof(uint32_t), index32Count));
+        const uint16_t* pIndices16 = reinterpret_cast<const uint16_t*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_Indices16, sizeof(uint16_t), index16Count));
+        const BlitzenRendering::VulkanMeshlet* pMeshlets = reinterpret_cast<const BlitzenRendering::VulkanMeshlet*>(
+        GetCookedMeshSection(file, header, CookedMeshSection::CMS_Meshlets, sizeof(BlitzenRendering::VulkanMeshlet), 
+        meshletCount));
+        const uint32_t* pMeshletVertices = reinterpret_cast<const uint32_t*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_MeshletVertices, sizeof(uint32_t), meshletVertexCount));
+        const uint8_t* pMeshletTriangles = GetCookedMeshSection(file, header, CookedMeshSection::CMS_MeshletTriangles, 
+        1, meshletTriangleSize);
+        const CookedNode* pNodes = reinterpret_cast<const CookedNode*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_Nodes, sizeof(CookedNode), nodeCount));
+        const glm::vec3* pOccluderVertices = reinterpret_cast<const glm::vec3*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_OccluderVertices, sizeof(glm::vec3), occluderVertexCount));
+        const uint32_t* pOccluderIndices = reinterpret_cast<const uint32_t*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_OccluderIndices, sizeof(uint32_t), occluderIndexCount));
+        const uint32_t* pOccluderAdjacency = reinterpret_cast<const uint32_t*>(GetCookedMeshSection(file, header,
+        CookedMeshSection::CMS_OccluderAdjacency, sizeof(uint32_t), occluderAdjacencyCount));
+        if(!pMeshes || !pSurfaces || !pNames || !pVertexData || !pIndices32 || !pIndices16 || !pMeshlets || 
+        !pMeshletVertices || !pMeshletTriangles || !pNodes || !pOccluderVertices || !pOccluderIndices || 
+        !pOccluderAdjacency || occluderAdjacencyCount != occluderIndexCount)
+        {
+            std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+            return false;
+        }
+
+        //Validate every table before anything is given to the renderer
+        for(size_t i = 0; i < meshCount; ++i)
+        {
+            if(pMeshes[i].firstSurface > surfaceCount || pMeshes[i].surfaceCount > surfaceCount - pMeshes[i].firstSurface ||
+            pMeshes[i].nameOffset > nameSize || pMeshes[i].nameLength > nameSize - pMeshes[i].nameOffset ||
+            pMeshes[i].firstOccluderVertex > occluderVertexCount || 
+            pMeshes[i].occluderVertexCount > occluderVertexCount - pMeshes[i].firstOccluderVertex ||
+            pMeshes[i].firstOccluderIndex > occluderIndexCount || 
+            pMeshes[i].occluderIndexCount > occluderIndexCount - pMeshes[i].firstOccluderIndex)
+            {
+                std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+                return false;
+            }
+
+            //The occluder of every surface has to stay inside of its mesh's ranges and only point at its own data
+            for(size_t s = 0; s < pMeshes[i].surfaceCount; ++s)
+            {
+                const CookedSurface& surface = pSurfaces[pMeshes[i].firstSurface + s];
+                bool bValid = surface.firstOccluderVertex <= pMeshes[i].occluderVertexCount && 
+                surface.occluderVertexCount <= pMeshes[i].occluderVertexCount - surface.firstOccluderVertex && 
+                surface.firstOccluderIndex <= pMeshes[i].occluderIndexCount && 
+                surface.occluderIndexCount <= pMeshes[i].occluderIndexCount - surface.firstOccluderIndex && 
+                surface.occluderIndexCount % 3 == 0;
+                size_t firstIndex = pMeshes[i].firstOccluderIndex + static_cast<size_t>(surface.firstOccluderIndex);
+                uint32_t triangleCount = surface.occluderIndexCount / 3;
+                for(size_t index = 0; bValid && index < surface.occluderIndexCount; ++index)
+                {
+                    uint32_t neighbor = pOccluderAdjacency[firstIndex + index];
+                    bValid = pOccluderIndices[firstIndex + index] < surface.occluderVertexCount && 
+                    (neighbor < triangleCount || neighbor == BLITZEN_OCCLUDER_NO_NEIGHBOR);
+                }
+                if(!bValid)
+                {
+                    std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+                    return false;
+                }
+            }
+        }
+        for(size_t i = 0; i < surfaceCount; ++i)
+        {
+            bool b16BitIndices = pSurfaces[i].indexType == VK_INDEX_TYPE_UINT16;
+            size_t indexCount = b16BitIndices ? index16Count : index32Count;
+            bool bValid = (b16BitIndices || pSurfaces[i].indexType == VK_INDEX_TYPE_UINT32) && 
+            pSurfaces[i].lodCount > 0 && pSurfaces[i].lodCount <= BLITZEN_MAX_MESH_LODS && 
+            pSurfaces[i].vertexBufferOffset <= vertexCount && pSurfaces[i].firstMeshlet <= meshletCount && 
+            pSurfaces[i].meshletCount <= meshletCount - pSurfaces[i].firstMeshlet;
+            for(uint32_t lod = 0; bValid && lod < pSurfaces[i].lodCount; ++lod)
+            {
+                const CookedMeshLod& cookedLod = pSurfaces[i].lods[lod];
+                bValid = cookedLod.firstIndex <= indexCount && cookedLod.indexCount <= indexCount - cookedLod.firstIndex;
+            }
+            if(!bValid)
+            {
+                std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+                return false;
+            }
+        }
+
+        for(size_t i = 0; i < meshletCount; ++i)
+        {
+            const BlitzenRendering::VulkanMeshlet& meshlet = pMeshlets[i];
+            if(meshlet.vertexOffset > meshletVertexCount || meshlet.vertexCount > meshletVertexCount - meshlet.vertexOffset ||
+            meshlet.triangleOffset > meshletTriangleSize || 
+            meshlet.triangleCount * 3ull > meshletTriangleSize - meshlet.triangleOffset)
+            {
+                std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+                return false;
+            }
+        }
+
+        //Parents come before their children and every subtree ends inside the one of its parent
+        for(size_t i = 0; i < nodeCount; ++i)
+        {
+            const CookedNode& node = pNodes[i];
+            bool bValid = node.nameOffset <= nameSize && node.nameLength <= nameSize - node.nameOffset && 
+            node.subtreeSize > 0 && node.subtreeSize <= nodeCount - i && 
+            (node.meshAsset == BLITZEN_SCENE_NODE_NONE || node.meshAsset < meshCount);
+            if(bValid && node.parent != BLITZEN_SCENE_NODE_NONE)
+            {
+                bValid = node.parent < i && i + node.subtreeSize <= node.parent + pNodes[node.parent].subtreeSize;
+            }
+            if(!bValid)
+            {
+                std::cout << "Loading cooked mesh: " << cookedPath << " -> File is corrupted, recooking\n";
+                return false;
+            }
+        }
+
+        //Mesh indices in the file start from 0, they are moved past the assets that the renderer already holds
+        uint32_t firstAsset = static_cast<uint32_t>(pVulkan->m_assets.size());
+        for(size_t i = 0; i < meshCount; ++i)
+        {
+            pVulkan->m_assets.push_back(BlitzenRendering::VulkanMeshAsset());
+            BlitzenRendering::VulkanMeshAsset& asset = pVulkan->m_assets.back();
+            asset.meshName.assign(pNames + pMeshes[i].nameOffset, pMeshes[i].nameLength);
+            asset.vertexDequantization = glm::translate(glm::vec3(pMeshes[i].dequantizationOffset[0], 
+            pMeshes[i].dequantizationOffset[1], pMeshes[i].dequantizationOffset[2])) * 
+            glm::scale(glm::vec3(pMeshes[i].dequantizationScale[0], pMeshes[i].dequantizationScale[1], 
+            pMeshes[i].dequantizationScale[2]));
+            asset.occluderVertices.assign(pOccluderVertices + pMeshes[i].firstOccluderVertex, 
+            pOccluderVertices + pMeshes[i].firstOccluderVertex + pMeshes[i].occluderVertexCount);
+            asset.occluderIndices.assign(pOccluderIndices + pMeshes[i].firstOccluderIndex, 
+            pOccluderIndices + pMeshes[i].firstOccluderIndex + pMeshes[i].occluderIndexCount);
+            asset.occluderAdjacency.assign(pOccluderAdjacency + pMeshes[i].firstOccluderIndex, 
+            pOccluderAdjacency + pMeshes[i].firstOccluderIndex + pMeshes[i].occluderIndexCount);
+
+            asset.geoSurfaces.resize(pMeshes[i].surfaceCount);
+            for(size_t s = 0; s < pMeshes[i].surfaceCount; ++s)
+            {
+                const CookedSurface& cookedSurface = pSurfaces[pMeshes[i].firstSurface + s];
+                BlitzenRendering::GeoSurface& surface = asset.geoSurfaces[s];
+                surface.lodCount = cookedSurface.lodCount;
+                for(uint32_t lod = 0; lod < cookedSurface.lodCount; ++lod)
+                {
+                    surface.lods[lod].firstIndex = cookedSurface.lods[lod].firstIndex;
+                    surface.lods[lod].indexCount = cookedSurface.lods[lod].indexCount;
+                    surface.lods[lod].error = cookedSurface.lods[lod].error;
+                }
+                surface.boundsMin = glm::vec3(cookedSurface.boundsMin[0], cookedSurface.boundsMin[1], 
+                cookedSurface.boundsMin[2]);
+                surface.boundsMax = glm::vec3(cookedSurface.boundsMax[0], cookedSurface.boundsMax[1], 
+                cookedSurface.boundsMax[2]);
+                surface.boundingSphere = glm::vec4(cookedSurface.boundingSphere[0], cookedSurface.boundingSphere[1], 
+                cookedSurface.boundingSphere[2], cookedSurface.boundingSphere[3]);
+                surface.vertexBufferOffset = cookedSurface.vertexBufferOffset;
+                surface.indexType = static_cast<VkIndexType>(cookedSurface.indexType);
+                surface.firstMeshlet = cookedSurface.firstMeshlet;
+                surface.meshletCount = cookedSurface.meshletCount;
+                surface.firstOccluderVertex = cookedSurface.firstOccluderVertex;
+                surface.occluderVertexCount = cookedSurface.occluderVertexCount;
+                surface.firstOccluderIndex = cookedSurface.firstOccluderIndex;
+                surface.occluderIndexCount = cookedSurface.occluderIndexCount;
+                surface.occluderError = cookedSurface.occluderError;
+                surface.pMaterial = nullptr;
+            }
+        }
+
+        //The nodes are in depth first order, so every one of them is appended to the hierarchy
+        BlitzenEngine::TransformHierarchy& hierarchy = pVulkan->m_sceneHierarchy;
+        hierarchy.Reserve(hierarchy.GetNodeCount() + nodeCount);
+        std::vector<BlitzenEngine::TransformHandle> nodeHandles(nodeCount);
+        for(size_t i = 0; i < nodeCount; ++i)
+        {
+            const CookedNode& cookedNode = pNodes[i];
+            BlitzenEngine::TransformHandle parent = cookedNode.parent == BLITZEN_SCENE_NODE_NONE ? 
+            BlitzenEngine::TransformHandle() : nodeHandles[cookedNode.parent];
+            uint32_t meshAsset = cookedNode.meshAsset == BLITZEN_SCENE_NODE_NONE ? BLITZEN_SCENE_NODE_NONE : 
+            firstAsset + cookedNode.meshAsset;
+            nodeHandles[i] = hierarchy.CreateNode(parent, InternAssetName(std::string_view(pNames + 
+            cookedNode.nameOffset, cookedNode.nameLength)), meshAsset);
+            hierarchy.SetLocalTransform(nodeHandles[i], 
+            glm::vec3(cookedNode.translation[0], cookedNode.translation[1], cookedNode.translation[2]), 
+            glm::quat(cookedNode.rotation[3], cookedNode.rotation[0], cookedNode.rotation[1], cookedNode.rotation[2]), 
+            glm::vec3(cookedNode.scale[0], cookedNode.scale[1], cookedNode.scale[2]));
+        }
+        hierarchy.UpdateWorldTransforms();
+
+        //The geometry is uploaded straight from the mapping
+        pVulkan->LoadMeshBuffers(pVertexData, vertexFormat, vertexCount, pIndices32, index32Count, 
+        pIndices16, index16Count);
+        pVulkan->LoadMeshletBuffers(pMeshlets, meshletCount, pMeshletVertices, meshletVertexCount, 
+        pMeshletTriangles, meshletTriangleSize);
+
+        return true;
+    }
+}
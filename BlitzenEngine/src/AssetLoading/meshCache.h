@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+#include "BlitzenVulkan/vulkanRenderer.h"
+
+namespace BlitzenEngine
+{
+    //Cooked meshes are saved next to their source file with this extension
+    #define BLITZEN_COOKED_MESH_EXTENSION ".blitzmesh"
+
+    //Written at the start of every cooked mesh file ('BMSH'), the version changes whenever the layout does
+    #define BLITZEN_COOKED_MESH_MAGIC           0x48534D42
+    #define BLITZEN_COOKED_MESH_VERSION         8
+
+    //Every section of the file starts at an offset that is a multiple of this
+    #define BLITZEN_COOKED_MESH_ALIGNMENT       16
+
+    //The blobs and tables stored in a cooked mesh file, in the order that they are written
+    enum class CookedMeshSection : uint32_t
+    {
+        CMS_Meshes,
+        CMS_Surfaces,
+        CMS_Names,
+        CMS_Vertices,
+        CMS_Indices32,
+        CMS_Indices16,
+        CMS_Meshlets,
+        CMS_MeshletVertices,
+        CMS_MeshletTriangles,
+        CMS_Nodes,
+        CMS_OccluderVertices,
+        CMS_OccluderIndices,
+        CMS_OccluderAdjacency,
+
+        CMS_Count
+    };
+
+    struct CookedMeshSectionEntry
+    {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct CookedMeshHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+
+        //Hash of the source file's bytes and the import options, if either changes the cooked file is rebuilt
+        uint64_t sourceHash;
+
+        //A BlitzenRendering::VulkanVertexFormat, tells the size and layout of the vertices section
+        uint32_t vertexFormat;
+        uint32_t padding;
+
+        CookedMeshSectionEntry sections[static_cast<size_t>(CookedMeshSection::CMS_Count)];
+    };
+
+    //Mirrors VulkanMeshAsset, the name is stored as a range in the names section
+    struct CookedMesh
+    {
+        uint32_t firstSurface;
+        uint32_t surfaceCount;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+
+        //The translation and scale of the mesh's dequantization matrix
+        float dequantizationOffset[3];
+        float dequantizationScale[3];
+
+        //The mesh's ranges of the occluder sections, the adjacency has one entry for every index
+        uint32_t firstOccluderVertex;
+        uint32_t occluderVertexCount;
+        uint32_t firstOccluderIndex;
+        uint32_t occluderIndexCount;
+    };
+
+    //Mirrors VulkanMeshLod
+    struct CookedMeshLod
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error;
+    };
+
+    //Mirrors GeoSurface without the material, which is assigned by the renderer after loading
+    struct CookedSurface
+    {
+        CookedMeshLod lods[BLITZEN_MAX_MESH_LODS];
+        uint32_t lodCount;
+
+        uint32_t vertexBufferOffset;
+        //A VkIndexType, tells which of the index sections the lods point into
+        uint32_t indexType;
+
+        float boundsMin[3];
+        float boundsMax[3];
+        float boundingSphere[4];
+
+        uint32_t firstMeshlet;
+        uint32_t meshletCount;
+
+        //Local to the mesh's occluder ranges
+        uint32_t firstOccluderVertex;
+        uint32_t occluderVertexCount;
+        uint32_t firstOccluderIndex;
+        uint32_t occluderIndexCount;
+        float occluderError;
+    };
+
+    //A node of the scene hierarchy without its matrices, which are composed again after loading. The name is in the names section
+    struct CookedNode
+    {
+        uint32_t parent;
+        uint32_t subtreeSize;
+        uint32_t meshAsset;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+
+        float translation[3];
+        //xyzw
+        float rotation[4];
+        float scale[3];
+    };
+
+    //Hashes the contents of a file, used to find out if a cooked file is out of date
+    uint64_t HashFileContents(const uint8_t* pData, size_t size);
+
+    //Returns the path of the cooked file that caches the source asset at the given path
+    std::filesystem::path GetCookedMeshPath(const std::filesystem::path& sourcePath);
+
+    //Writes the final vertex, index and meshlet blobs along with the asset tables, occluders and scene hierarchy of the loaded meshes
+    bool WriteCookedMesh(const std::filesystem::path& cookedPath, uint64_t sourceHash,
+    BlitzenRendering::VulkanVertexFormat vertexFormat, const void* pVertexData, size_t vertexCount, 
+    const uint32_t* pIndices32, size_t index32Count, const uint16_t* pIndices16, size_t index16Count, 
+    const BlitzenRendering::VulkanMeshlet* pMeshlets, size_t meshletCount, const uint32_t* pMeshletVertices, 
+    size_t meshletVertexCount, const uint8_t* pMeshletTriangles, size_t meshletTriangleSize, 
+    const std::vector<BlitzenRendering::VulkanMeshAsset>& assets, 
+    const BlitzenEngine::TransformHierarchy& hierarchy);
+
+    /*-----------------------------------------------------------------------------------------------------
+    Maps a cooked mesh file and, if it was cooked from a source with the given hash, adds its assets to
+    the renderer along with its scene hierarchy and gives the mapped geometry and meshlets straight to the renderer's mesh buffers.
+    Returns false if the file is missing, invalid or out of date, in which case nothing is loaded
+    ------------------------------------------------------------------------------------------------------*/
+    bool LoadCookedMesh(const std::filesystem::path& cookedPath, uint64_t sourceHash,
+    BlitzenRendering::VulkanRenderer* pVulkan);
+}
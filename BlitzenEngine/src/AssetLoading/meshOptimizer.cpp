@@ -0,0 +1,829 @@
+#include "meshOptimizer.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+#include "glm/glm.hpp"
+
+namespace BlitzenEngine
+{
+    VertexCacheStatistics AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+    {
+        VertexCacheStatistics statistics;
+        statistics.triangleCount = indexCount / 3;
+
+        //Every vertex remembers the miss that put it in the cache, it is still there for the next cache size misses
+        std::vector<size_t> cacheTimestamps(vertexCount, 0);
+        size_t missCount = 0;
+        for(size_t i = 0; i < indexCount; ++i)
+        {
+            uint32_t vertex = pIndices[i];
+            if(cacheTimestamps[vertex] == 0)
+            {
+                ++statistics.referencedVertices;
+            }
+            if(cacheTimestamps[vertex] == 0 || missCount - cacheTimestamps[vertex] >= BLITZEN_VERTEX_CACHE_SIZE)
+            {
+                cacheTimestamps[vertex] = ++missCount;
+            }
+        }
+        statistics.transformedVertices = missCount;
+
+        return statistics;
+    }
+
+    //Returns the next fanning vertex from the dead end stack or, if that is empty, the next live vertex in input order
+    static int64_t SkipDeadEnd(const std::vector<uint32_t>& liveTriangles, std::vector<uint32_t>& deadEnds,
+    size_t& inputCursor)
+    {
+        while(!deadEnds.empty())
+        {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if(liveTriangles[vertex] > 0)
+            {
+                return vertex;
+            }
+        }
+
+        for(; inputCursor < liveTriangles.size(); ++inputCursor)
+        {
+            if(liveTriangles[inputCursor] > 0)
+            {
+                return static_cast<int64_t>(inputCursor);
+            }
+        }
+
+        return -1;
+    }
+
+    void OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+    {
+        size_t triangleCount = indexCount / 3;
+        if(triangleCount == 0 || vertexCount == 0)
+        {
+            return;
+        }
+
+        //Build the vertex to triangle adjacency, the offsets come from a prefix sum over the triangle counts
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for(size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            ++liveTriangles[pIndices[i]];
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for(size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(size_t t = 0; t < triangleCount; ++t)
+        {
+            for(size_t c = 0; c < 3; ++c)
+            {
+                adjacency[adjacencyFill[pIndices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        const size_t cacheSize = BLITZEN_VERTEX_CACHE_SIZE;
+        std::vector<size_t> cacheTimestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+
+        int64_t fanningVertex = 0;
+        size_t timestamp = cacheSize + 1;
+        size_t inputCursor = 1;
+        while(fanningVertex >= 0)
+        {
+            //Emit every triangle that is still live around the fanning vertex
+            candidates.clear();
+            for(uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; ++a)
+            {
+                uint32_t triangle = adjacency[a];
+                if(emitted[triangle])
+                {
+                    continue;
+                }
+
+                for(size_t c = 0; c < 3; ++c)
+                {
+                    uint32_t vertex = pIndices[triangle * 3 + c];
+                    output.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    --liveTriangles[vertex];
+                    if(timestamp - cacheTimestamps[vertex] > cacheSize)
+                    {
+                        cacheTimestamps[vertex] = timestamp++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+
+            /*------------------------------------------------------------------------------------------------
+            The next fanning vertex is the candidate that will still be in the cache after all of its live
+            triangles are emitted, preferring the one that entered the cache first. If none is left, the
+            search falls back to the dead end stack and finally to the input order
+            -------------------------------------------------------------------------------------------------*/
+            int64_t nextVertex = -1;
+            int64_t bestPriority = -1;
+            for(uint32_t vertex : candidates)
+            {
+                if(liveTriangles[vertex] == 0)
+                {
+                    continue;
+                }
+
+                int64_t priority = 0;
+                size_t age = timestamp - cacheTimestamps[vertex];
+                if(age + 2 * liveTriangles[vertex] <= cacheSize)
+                {
+                    priority = static_cast<int64_t>(age);
+                }
+                if(priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    nextVertex = vertex;
+                }
+            }
+
+            fanningVertex = nextVertex >= 0 ? nextVertex : SkipDeadEnd(liveTriangles, deadEnds, inputCursor);
+        }
+
+        memcpy(pIndices, output.data(), output.size() * sizeof(uint32_t));
+    }
+
+    //Feeds a triangle to a simulated FIFO cache and returns how many of its vertices missed
+    static uint32_t SimulateTriangle(const uint32_t* pTriangle, std::vector<size_t>& cacheTimestamps, size_t& missCount)
+    {
+        uint32_t misses = 0;
+        for(size_t c = 0; c < 3; ++c)
+        {
+            size_t& timestamp = cacheTimestamps[pTriangle[c]];
+            if(timestamp == 0 || missCount - timestamp >= BLITZEN_VERTEX_CACHE_SIZE)
+            {
+                timestamp = ++missCount;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride, 
+    size_t vertexCount, float threshold)
+    {
+        size_t triangleCount = indexCount / 3;
+        if(triangleCount < 2)
+        {
+            return;
+        }
+
+        /*-----------------------------------------------------------------------------------------------
+        Hard boundaries are the triangles where every vertex misses the cache. The cache optimizer starts
+        a new fan there, so moving the list apart at these points costs nothing
+        ------------------------------------------------------------------------------------------------*/
+        std::vector<size_t> cacheTimestamps(vertexCount, 0);
+        size_t missCount = 0;
+        std::vector<uint32_t> hardBoundaries;
+        for(size_t t = 0; t < triangleCount; ++t)
+        {
+            if(SimulateTriangle(pIndices + t * 3, cacheTimestamps, missCount) == 3 || t == 0)
+            {
+                hardBoundaries.push_back(static_cast<uint32_t>(t));
+            }
+        }
+        hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+
+        /*-----------------------------------------------------------------------------------------------
+        Soft boundaries split the hard clusters further. Each one starts with a cold cache, since it can
+        end up anywhere in the list, and ends as soon as its own ACMR is within the threshold of the ACMR
+        of the whole hard cluster. Moving the cache past its size empties it for the simulation
+        ------------------------------------------------------------------------------------------------*/
+        std::vector<uint32_t> clusters;
+        for(size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+        {
+            size_t start = hardBoundaries[h];
+            size_t end = hardBoundaries[h + 1];
+
+            missCount += BLITZEN_VERTEX_CACHE_SIZE;
+            size_t hardMisses = 0;
+            for(size_t t = start; t < end; ++t)
+            {
+                hardMisses += SimulateTriangle(pIndices + t * 3, cacheTimestamps, missCount);
+            }
+            float hardACMR = float(hardMisses) / float(end - start);
+
+            missCount += BLITZEN_VERTEX_CACHE_SIZE;
+            size_t clusterStart = start;
+            size_t clusterMisses = 0;
+            for(size_t t = start; t < end; ++t)
+            {
+                clusterMisses += SimulateTriangle(pIndices + t * 3, cacheTimestamps, missCount);
+                if(float(clusterMisses) / float(t + 1 - clusterStart) <= hardACMR * threshold || t + 1 == end)
+                {
+                    clusters.push_back(static_cast<uint32_t>(clusterStart));
+                    clusterStart = t + 1;
+                    clusterMisses = 0;
+                    missCount += BLITZEN_VERTEX_CACHE_SIZE;
+                }
+            }
+        }
+        size_t clusterCount = clusters.size();
+        clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+        //Area weighted centroid and normal of every cluster, and the centroid of the whole mesh
+        const uint8_t* pPositionBytes = reinterpret_cast<const uint8_t*>(pPositions);
+        auto getPosition = [pPositionBytes, positionStride](uint32_t vertex)
+        {
+            const float* pPosition = reinterpret_cast<const float*>(pPositionBytes + vertex * positionStride);
+            return glm::vec3(pPosition[0], pPosition[1], pPosition[2]);
+        };
+        std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.f));
+        std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.f));
+        glm::vec3 meshCentroid(0.f);
+        float meshArea = 0.f;
+        for(size_t c = 0; c < clusterCount; ++c)
+        {
+            float clusterArea = 0.f;
+            for(size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                glm::vec3 p0 = getPosition(pIndices[t * 3]);
+                glm::vec3 p1 = getPosition(pIndices[t * 3 + 1]);
+                glm::vec3 p2 = getPosition(pIndices[t * 3 + 2]);
+
+                //The cross product's length is twice the area, which is enough to weigh the triangles
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                glm::vec3 centroid = (p0 + p1 + p2) / 3.f;
+
+                clusterCentroids[c] += centroid * area;
+                clusterNormals[c] += normal;
+                clusterArea += area;
+            }
+
+            meshCentroid += clusterCentroids[c];
+            meshArea += clusterArea;
+            clusterCentroids[c] = clusterArea > 0.f ? clusterCentroids[c] / clusterArea : clusterCentroids[c];
+        }
+        meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : meshCentroid;
+
+        //Clusters that are far out and face away from the center occlude the most from any viewpoint outside the mesh
+        std::vector<float> sortKeys(clusterCount);
+        std::vector<uint32_t> clusterOrder(clusterCount);
+        for(size_t c = 0; c < clusterCount; ++c)
+        {
+            float normalLength = glm::length(clusterNormals[c]);
+            glm::vec3 normal = normalLength > 0.f ? clusterNormals[c] / normalLength : glm::vec3(0.f);
+            sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+            clusterOrder[c] = static_cast<uint32_t>(c);
+        }
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b)
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        for(uint32_t c : clusterOrder)
+        {
+            output.insert(output.end(), pIndices + clusters[c] * 3, pIndices + clusters[c + 1] * 3);
+        }
+        memcpy(pIndices, output.data(), output.size() * sizeof(uint32_t));
+    }
+
+    void OptimizeVertexFetch(uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+    {
+        constexpr uint32_t unassigned = UINT32_MAX;
+        remap.assign(vertexCount, unassigned);
+
+        uint32_t nextVertex = 0;
+        for(size_t i = 0; i < indexCount; ++i)
+        {
+            uint32_t& newVertex = remap[pIndices[i]];
+            if(newVertex == unassigned)
+            {
+                newVertex = nextVertex++;
+            }
+            pIndices[i] = newVertex;
+        }
+
+        for(uint32_t& newVertex : remap)
+        {
+            if(newVertex == unassigned)
+            {
+                newVertex = nextVertex++;
+            }
+        }
+    }
+
+    void RemapVertices(void* pVertexData, size_t vertexStride, size_t vertexCount, const std::vector<uint32_t>& remap)
+    {
+        uint8_t* pVertices = reinterpret_cast<uint8_t*>(pVertexData);
+        std::vector<uint8_t> original(pVertices, pVertices + vertexStride * vertexCount);
+        for(size_t v = 0; v < vertexCount; ++v)
+        {
+            memcpy(pVertices + remap[v] * vertexStride, original.data() + v * vertexStride, vertexStride);
+        }
+    }
+
+    //FNV-1a over the bytes of a vertex
+    static uint64_t HashVertex(const uint8_t* pVertex, size_t vertexStride)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(size_t i = 0; i < vertexStride; ++i)
+        {
+            hash = (hash ^ pVertex[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    size_t GenerateVertexRemap(const void* pVertexData, size_t vertexStride, size_t vertexCount, 
+    std::vector<uint32_t>& remap)
+    {
+        const uint8_t* pVertices = reinterpret_cast<const uint8_t*>(pVertexData);
+        remap.assign(vertexCount, 0);
+
+        //Open addressing table of the first vertex seen with each value, kept under half full
+        size_t tableSize = 1;
+        while(tableSize < vertexCount * 2)
+        {
+            tableSize *= 2;
+        }
+        constexpr uint32_t empty = UINT32_MAX;
+        std::vector<uint32_t> table(tableSize, empty);
+
+        uint32_t uniqueCount = 0;
+        for(size_t v = 0; v < vertexCount; ++v)
+        {
+            const uint8_t* pVertex = pVertices + v * vertexStride;
+            size_t slot = HashVertex(pVertex, vertexStride) & (tableSize - 1);
+            while(table[slot] != empty && memcmp(pVertices + table[slot] * vertexStride, pVertex, vertexStride) != 0)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if(table[slot] == empty)
+            {
+                table[slot] = static_cast<uint32_t>(v);
+                remap[v] = uniqueCount++;
+            }
+            else
+            {
+                remap[v] = remap[table[slot]];
+            }
+        }
+        return uniqueCount;
+    }
+
+    void RemapIndices(uint32_t* pIndices, size_t indexCount, const std::vector<uint32_t>& remap)
+    {
+        for(size_t i = 0; i < indexCount; ++i)
+        {
+            pIndices[i] = remap[pIndices[i]];
+        }
+    }
+
+    //The sum of the squared distances to a set of planes, weighted by the area of the triangles they came from
+    struct Quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+        double weight = 0;
+
+        void AddPlane(const glm::dvec3& normal, double distance, double planeWeight)
+        {
+            a2 += normal.x * normal.x * planeWeight;
+            ab += normal.x * normal.y * planeWeight;
+            ac += normal.x * normal.z * planeWeight;
+            ad += normal.x * distance * planeWeight;
+            b2 += normal.y * normal.y * planeWeight;
+            bc += normal.y * normal.z * planeWeight;
+            bd += normal.y * distance * planeWeight;
+            c2 += normal.z * normal.z * planeWeight;
+            cd += normal.z * distance * planeWeight;
+            d2 += distance * distance * planeWeight;
+            weight += planeWeight;
+        }
+
+        void Add(const Quadric& other)
+        {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+        }
+
+        //Mean squared distance of the point to the planes
+        double Evaluate(const glm::dvec3& p) const
+        {
+            double error = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z + d2
+            + 2 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z + ad * p.x + bd * p.y + cd * p.z);
+            return weight > 0 ? glm::abs(error) / weight : 0;
+        }
+    };
+
+    //A candidate edge collapse that moves every vertex at one position on to another position
+    struct EdgeCollapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    size_t SimplifyMesh(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const float* pPositions, 
+    size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError, float& resultError)
+    {
+        resultError = 0.f;
+        std::vector<uint32_t> result(pIndices, pIndices + indexCount);
+
+        /*-----------------------------------------------------------------------------------------------
+        Collapses work on positions rather than vertices, so that vertices split by a seam in their
+        other attributes (the wedges of a position) move together and the seam does not tear open
+        ------------------------------------------------------------------------------------------------*/
+        std::vector<glm::vec3> vertexPositions(vertexCount);
+        for(size_t v = 0; v < vertexCount; ++v)
+        {
+            memcpy(&vertexPositions[v], reinterpret_cast<const uint8_t*>(pPositions) + v * positionStride, 
+            sizeof(glm::vec3));
+        }
+        std::vector<uint32_t> positionOf;
+        size_t positionCount = GenerateVertexRemap(vertexPositions.data(), sizeof(glm::vec3), vertexCount, positionOf);
+        std::vector<glm::dvec3> positions(positionCount);
+        std::vector<uint32_t> firstWedge(positionCount);
+        for(size_t v = vertexCount; v-- > 0;)
+        {
+            positions[positionOf[v]] = glm::dvec3(vertexPositions[v]);
+            firstWedge[positionOf[v]] = static_cast<uint32_t>(v);
+        }
+
+        //Positions on an open border have an edge that only one triangle uses, they stay where they are
+        std::unordered_set<uint64_t> directedEdges;
+        for(size_t i = 0; i < result.size(); i += 3)
+        {
+            for(size_t e = 0; e < 3; ++e)
+            {
+                uint64_t a = positionOf[result[i + e]];
+                uint64_t b = positionOf[result[i + (e + 1) % 3]];
+                directedEdges.insert(a << 32 | b);
+            }
+        }
+        std::vector<uint8_t> locked(positionCount, 0);
+        for(uint64_t edge : directedEdges)
+        {
+            uint64_t reverse = (edge << 32) | (edge >> 32);
+            if(directedEdges.find(reverse) == directedEdges.end())
+            {
+                locked[edge >> 32] = 1;
+                locked[edge & 0xFFFFFFFF] = 1;
+            }
+        }
+
+        std::vector<Quadric> quadrics(positionCount);
+        for(size_t i = 0; i < result.size(); i += 3)
+        {
+            glm::dvec3 p0 = positions[positionOf[result[i]]];
+            glm::dvec3 p1 = positions[positionOf[result[i + 1]]];
+            glm::dvec3 p2 = positions[positionOf[result[i + 2]]];
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(normal);
+            if(area == 0)
+            {
+                continue;
+            }
+            normal /= area;
+            for(size_t c = 0; c < 3; ++c)
+            {
+                quadrics[positionOf[result[i + c]]].AddPlane(normal, -glm::dot(normal, p0), area);
+            }
+        }
+
+        double maxError = 0;
+        double errorLimit = double(targetError) * double(targetError);
+        std::vector<uint32_t> collapseTarget(positionCount);
+        std::vector<uint8_t> touched(positionCount);
+        std::vector<uint32_t> wedgeRemap(vertexCount);
+        std::vector<uint32_t> triangleOffsets(positionCount + 1);
+        std::vector<uint32_t> triangleList;
+        std::vector<EdgeCollapse> collapses;
+        while(result.size() > targetIndexCount)
+        {
+            //The triangles around every position, as offsets into one list
+            std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+            for(uint32_t vertex : result)
+            {
+                ++triangleOffsets[positionOf[vertex] + 1];
+            }
+            for(size_t p = 0; p < positionCount; ++p)
+            {
+                triangleOffsets[p + 1] += triangleOffsets[p];
+            }
+            triangleList.resize(result.size());
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for(size_t i = 0; i < result.size(); ++i)
+            {
+                triangleList[fill[positionOf[result[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            //Every edge gets the cheaper of its two directions, an edge shows up once for each of its two triangles
+            collapses.clear();
+            for(size_t i = 0; i < result.size(); i += 3)
+            {
+                for(size_t e = 0; e < 3; ++e)
+                {
+                    uint32_t a = positionOf[result[i + e]];
+                    uint32_t b = positionOf[result[i + (e + 1) % 3]];
+                    if(a >= b || (locked[a] && locked[b]))
+                    {
+                        continue;
+                    }
+
+                    Quadric combined = quadrics[a];
+                    combined.Add(quadrics[b]);
+                    double errorToB = locked[a] ? std::numeric_limits<double>::max() : combined.Evaluate(positions[b]);
+                    double errorToA = locked[b] ? std::numeric_limits<double>::max() : combined.Evaluate(positions[a]);
+                    collapses.push_back(errorToB <= errorToA ? EdgeCollapse{a, b, errorToB} : EdgeCollapse{b, a, errorToA});
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& x, const EdgeCollapse& y)
+            {
+                return x.error < y.error;
+            });
+
+            /*-------------------------------------------------------------------------------------------
+            The cheapest collapses are applied until enough triangles are gone. A collapse locks every
+            position around the one it moves for the rest of the pass, so that the adjacency stays valid
+            --------------------------------------------------------------------------------------------*/
+            for(size_t p = 0; p < positionCount; ++p)
+            {
+                collapseTarget[p] = static_cast<uint32_t>(p);
+            }
+            std::fill(touched.begin(), touched.end(), 0);
+            size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+            size_t trianglesRemoved = 0;
+            size_t collapseCount = 0;
+            for(const EdgeCollapse& collapse : collapses)
+            {
+                if(collapse.error > errorLimit || trianglesRemoved >= trianglesToRemove)
+                {
+                    break;
+                }
+                if(touched[collapse.from] || touched[collapse.to])
+                {
+                    continue;
+                }
+
+                //Triangles that keep their area after the collapse must not flip over
+                bool bFlips = false;
+                size_t removed = 0;
+                for(uint32_t o = triangleOffsets[collapse.from]; o < triangleOffsets[collapse.from + 1] && !bFlips; ++o)
+                {
+                    const uint32_t* pTriangle = result.data() + triangleList[o] * 3;
+                    glm::dvec3 before[3];
+                    glm::dvec3 after[3];
+                    bool bRemoved = false;
+                    for(size_t c = 0; c < 3; ++c)
+                    {
+                        uint32_t position = positionOf[pTriangle[c]];
+                        bRemoved = bRemoved || position == collapse.to;
+                        before[c] = positions[position];
+                        after[c] = position == collapse.from ? positions[collapse.to] : before[c];
+                    }
+                    if(bRemoved)
+                    {
+                        ++removed;
+                        continue;
+                    }
+
+                    glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    bFlips = glm::dot(normalBefore, normalAfter) <= 
+                    0.2 * glm::length(normalBefore) * glm::length(normalAfter);
+                }
+                if(bFlips)
+                {
+                    continue;
+                }
+
+                collapseTarget[collapse.from] = collapse.to;
+                quadrics[collapse.to].Add(quadrics[collapse.from]);
+                maxError = std::max(maxError, collapse.error);
+                trianglesRemoved += removed;
+                ++collapseCount;
+                for(uint32_t o = triangleOffsets[collapse.from]; o < triangleOffsets[collapse.from + 1]; ++o)
+                {
+                    for(size_t c = 0; c < 3; ++c)
+                    {
+                        touched[positionOf[result[triangleList[o] * 3 + c]]] = 1;
+                    }
+                }
+            }
+            if(collapseCount == 0)
+            {
+                break;
+            }
+
+            /*-------------------------------------------------------------------------------------------
+            A moved vertex becomes the wedge at its new position that it shared an edge with, which keeps
+            the attributes on its side of a seam. If there is none it takes the position's first wedge
+            --------------------------------------------------------------------------------------------*/
+            for(size_t v = 0; v < vertexCount; ++v)
+            {
+                wedgeRemap[v] = collapseTarget[positionOf[v]] == positionOf[v] ? static_cast<uint32_t>(v) : 
+                firstWedge[collapseTarget[positionOf[v]]];
+            }
+            for(size_t i = 0; i < result.size(); i += 3)
+            {
+                for(size_t c = 0; c < 3; ++c)
+                {
+                    uint32_t vertex = result[i + c];
+                    for(size_t other = 1; other < 3; ++other)
+                    {
+                        uint32_t neighbor = result[i + (c + other) % 3];
+                        if(collapseTarget[positionOf[vertex]] == positionOf[neighbor] && 
+                        positionOf[vertex] != positionOf[neighbor])
+                        {
+                            wedgeRemap[vertex] = neighbor;
+                        }
+                    }
+                }
+            }
+
+            //Triangles that lost their area are dropped
+            size_t writeIndex = 0;
+            for(size_t i = 0; i < result.size(); i += 3)
+            {
+                uint32_t a = wedgeRemap[result[i]];
+                uint32_t b = wedgeRemap[result[i + 1]];
+                uint32_t c = wedgeRemap[result[i + 2]];
+                if(positionOf[a] == positionOf[b] || positionOf[b] == positionOf[c] || positionOf[a] == positionOf[c])
+                {
+                    continue;
+                }
+                result[writeIndex++] = a;
+                result[writeIndex++] = b;
+                result[writeIndex++] = c;
+            }
+            result.resize(writeIndex);
+        }
+
+        resultError = static_cast<float>(glm::sqrt(maxError));
+        memcpy(pDestination, result.data(), result.size() * sizeof(uint32_t));
+        return result.size();
+    }
+
+    void BuildMeshlets(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, 
+    std::vector<MeshletRange>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+    {
+        //The place of every vertex in the meshlet that is being filled, or 0xFF if it is not in it
+        constexpr uint8_t notInMeshlet = 0xFF;
+        std::vector<uint8_t> meshletIndex(vertexCount, notInMeshlet);
+
+        MeshletRange meshlet{static_cast<uint32_t>(meshletVertices.size()), 
+        static_cast<uint32_t>(meshletTriangles.size()), 0, 0};
+        auto finishMeshlet = [&]()
+        {
+            for(uint32_t v = 0; v < meshlet.vertexCount; ++v)
+            {
+                meshletIndex[meshletVertices[meshlet.vertexOffset + v]] = notInMeshlet;
+            }
+            meshlets.push_back(meshlet);
+
+            //Every triangle table starts on 4 bytes, so that shaders can read it as 32 bit words
+            meshletTriangles.resize((meshletTriangles.size() + 3) & ~size_t(3), 0);
+            meshlet = {static_cast<uint32_t>(meshletVertices.size()), static_cast<uint32_t>(meshletTriangles.size()), 0, 0};
+        };
+
+        for(size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            uint32_t newVertices = 0;
+            for(size_t c = 0; c < 3; ++c)
+            {
+                newVertices += meshletIndex[pIndices[i + c]] == notInMeshlet;
+            }
+            if(meshlet.vertexCount + newVertices > BLITZEN_MESHLET_MAX_VERTICES || 
+            meshlet.triangleCount + 1 > BLITZEN_MESHLET_MAX_TRIANGLES)
+            {
+                finishMeshlet();
+            }
+
+            for(size_t c = 0; c < 3; ++c)
+            {
+                uint8_t& index = meshletIndex[pIndices[i + c]];
+                if(index == notInMeshlet)
+                {
+                    index = static_cast<uint8_t>(meshlet.vertexCount++);
+                    meshletVertices.push_back(pIndices[i + c]);
+                }
+                meshletTriangles.push_back(index);
+            }
+            ++meshlet.triangleCount;
+        }
+
+        if(meshlet.triangleCount)
+        {
+            finishMeshlet();
+        }
+    }
+
+    MeshletBounds ComputeMeshletBounds(const MeshletRange& meshlet, const uint32_t* pMeshletVertices, 
+    const uint8_t* pMeshletTriangles, const float* pPositions, size_t positionStride)
+    {
+        const uint8_t* pPositionBytes = reinterpret_cast<const uint8_t*>(pPositions);
+        auto getPosition = [&](uint8_t meshletVertex)
+        {
+            const float* pPosition = reinterpret_cast<const float*>(pPositionBytes + 
+            pMeshletVertices[meshlet.vertexOffset + meshletVertex] * positionStride);
+            return glm::vec3(pPosition[0], pPosition[1], pPosition[2]);
+        };
+
+        //The sphere is centered on the bounding box, which is close enough for a few dozen vertices
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+        for(uint32_t v = 0; v < meshlet.vertexCount; ++v)
+        {
+            boundsMin = glm::min(boundsMin, getPosition(static_cast<uint8_t>(v)));
+            boundsMax = glm::max(boundsMax, getPosition(static_cast<uint8_t>(v)));
+        }
+        glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0.f;
+        for(uint32_t v = 0; v < meshlet.vertexCount; ++v)
+        {
+            radius = std::max(radius, glm::length(getPosition(static_cast<uint8_t>(v)) - center));
+        }
+
+        //The cone's axis is the average of the triangle normals and its width is the normal furthest from it
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec3> corners;
+        normals.reserve(meshlet.triangleCount);
+        glm::vec3 normalSum(0.f);
+        for(uint32_t t = 0; t < meshlet.triangleCount; ++t)
+        {
+            const uint8_t* pTriangle = pMeshletTriangles + meshlet.triangleOffset + t * 3;
+            glm::vec3 p0 = getPosition(pTriangle[0]);
+            glm::vec3 normal = glm::cross(getPosition(pTriangle[1]) - p0, getPosition(pTriangle[2]) - p0);
+            float area = glm::length(normal);
+            if(area > 0.f)
+            {
+                normals.push_back(normal / area);
+                corners.push_back(p0);
+                normalSum += normal / area;
+            }
+        }
+
+        MeshletBounds bounds;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            bounds.center[axis] = center[axis];
+            bounds.coneApex[axis] = center[axis];
+            bounds.coneAxis[axis] = 0.f;
+        }
+        bounds.radius = radius;
+        bounds.coneCutoff = 1.f;
+
+        float sumLength = glm::length(normalSum);
+        if(sumLength <= 0.f)
+        {
+            return bounds;
+        }
+        glm::vec3 coneAxis = normalSum / sumLength;
+        float minimumDot = 1.f;
+        for(const glm::vec3& normal : normals)
+        {
+            minimumDot = std::min(minimumDot, glm::dot(coneAxis, normal));
+        }
+
+        //Past about 84 degrees from the axis the cone would hardly ever cull anything
+        if(minimumDot <= 0.1f)
+        {
+            return bounds;
+        }
+
+        //The apex is moved back along the axis until it is behind the plane of every triangle
+        float apexDistance = 0.f;
+        for(size_t t = 0; t < normals.size(); ++t)
+        {
+            float distance = glm::dot(center - corners[t], normals[t]) / glm::dot(coneAxis, normals[t]);
+            apexDistance = std::max(apexDistance, distance);
+        }
+        glm::vec3 coneApex = center - coneAxis * apexDistance;
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            bounds.coneApex[axis] = coneApex[axis];
+            bounds.coneAxis[axis] = coneAxis[axis];
+        }
+        bounds.coneCutoff = glm::sqrt(1.f - minimumDot * minimumDot);
+        return bounds;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace BlitzenEngine
+{
+    //The size of the FIFO post transform cache that the optimizer targets and that the statistics simulate
+    #define BLITZEN_VERTEX_CACHE_SIZE       16
+
+    //The limits of a meshlet, 124 triangles keep the triangle table of a full meshlet at a multiple of 4 bytes
+    #define BLITZEN_MESHLET_MAX_VERTICES    64
+    #define BLITZEN_MESHLET_MAX_TRIANGLES   124
+
+    //How well an index buffer uses the post transform vertex cache
+    struct VertexCacheStatistics
+    {
+        //Vertices that missed the cache, each one is a vertex shader invocation
+        size_t transformedVertices = 0;
+        //Vertices that are referenced by at least one triangle
+        size_t referencedVertices = 0;
+        size_t triangleCount = 0;
+
+        //Average cache miss ratio, transformed vertices per triangle. 0.5 is the best a regular mesh can do
+        inline float GetACMR() const {return triangleCount ? float(transformedVertices) / float(triangleCount) : 0.f;}
+        //Average transform to vertex ratio, transformed vertices per referenced vertex. The best is 1
+        inline float GetATVR() const
+        {return referencedVertices ? float(transformedVertices) / float(referencedVertices) : 0.f;}
+
+        inline void Accumulate(const VertexCacheStatistics& other)
+        {
+            transformedVertices += other.transformedVertices;
+            referencedVertices += other.referencedVertices;
+            triangleCount += other.triangleCount;
+        }
+    };
+
+    //Runs the triangle list through a simulated FIFO cache of BLITZEN_VERTEX_CACHE_SIZE entries
+    VertexCacheStatistics AnalyzeVertexCache(const uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+
+    /*---------------------------------------------------------------------------------------------------
+    Reorders the triangles of the list in place for post transform cache locality, using Tipsify
+    (Sander, Nehab and Barczak, 2007). Triangles are fanned around the vertex that is most likely to still
+    be in the cache, so the result is close to the best ACMR that a cache of the targeted size allows
+    ----------------------------------------------------------------------------------------------------*/
+    void OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+
+    /*---------------------------------------------------------------------------------------------------
+    Reorders the triangles of a cache optimized list to reduce overdraw inside a single draw, based on
+    Sander, Nehab and Barczak, 2007. The list is split into clusters that can be moved without losing much
+    of the cache order, which are then sorted so that the ones facing outwards from the mesh's center, 
+    the most likely to occlude the rest, are drawn first. The threshold is how much worse than the input's 
+    ACMR a cluster is allowed to get, 1.05 keeps most of the gain, higher values give more and smaller clusters. 
+    Positions are three floats at the start of every positionStride bytes
+    ----------------------------------------------------------------------------------------------------*/
+    void OptimizeOverdraw(uint32_t* pIndices, size_t indexCount, const float* pPositions, size_t positionStride, 
+    size_t vertexCount, float threshold);
+
+    /*---------------------------------------------------------------------------------------------------
+    Gives the vertices new places in the order that the indices first reference them, so that the
+    vertex shader reads the vertex buffer mostly front to back. The indices are remapped in place and
+    remap receives the new place of every old vertex. Vertices no triangle uses are moved to the end
+    ----------------------------------------------------------------------------------------------------*/
+    void OptimizeVertexFetch(uint32_t* pIndices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+
+    //Moves every vertex of an array of vertices with the given stride to the place that the remap gives it
+    void RemapVertices(void* pVertexData, size_t vertexStride, size_t vertexCount, const std::vector<uint32_t>& remap);
+
+    /*---------------------------------------------------------------------------------------------------
+    Finds the vertices of an array that are bit identical, by hashing their bytes. Remap receives the new
+    place of every vertex, duplicates share the place of the first one, and unique vertices keep their
+    order. Returns the number of unique vertices
+    ----------------------------------------------------------------------------------------------------*/
+    size_t GenerateVertexRemap(const void* pVertexData, size_t vertexStride, size_t vertexCount, 
+    std::vector<uint32_t>& remap);
+
+    //Replaces every index with the new place of its vertex
+    void RemapIndices(uint32_t* pIndices, size_t indexCount, const std::vector<uint32_t>& remap);
+
+    /*---------------------------------------------------------------------------------------------------
+    Simplifies a triangle list with edge collapses ordered by their quadric error (Garland and Heckbert,
+    1997), until it has at most the target number of indices or the next collapse would be further than 
+    the target error from the surface. Vertices only move on to other vertices, so the result indexes the
+    same vertex array. Vertices that share a position move together and open borders are kept in place.
+    The destination needs room for indexCount indices. Returns the number of indices written, the error 
+    of the result is in the units of the positions
+    ----------------------------------------------------------------------------------------------------*/
+    size_t SimplifyMesh(uint32_t* pDestination, const uint32_t* pIndices, size_t indexCount, const float* pPositions, 
+    size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError, float& resultError);
+
+    //A cluster of triangles, as ranges of the meshlet vertex and triangle tables that BuildMeshlets fills
+    struct MeshletRange
+    {
+        //The meshlet's vertices are indices of the mesh's vertices
+        uint32_t vertexOffset;
+        //Three bytes per triangle, each one the place of a vertex in the meshlet's vertices. Starts at a multiple of 4
+        uint32_t triangleOffset;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    The bounds that culling tests a meshlet with. Every triangle of the meshlet faces away from any 
+    viewer for whom dot(normalize(coneApex - viewer), coneAxis) >= coneCutoff. 
+    Meshlets whose normals spread too far get a cutoff of 1, which never culls
+    ----------------------------------------------------------------------------------------------------*/
+    struct MeshletBounds
+    {
+        float center[3];
+        float radius;
+
+        float coneApex[3];
+        float coneAxis[3];
+        float coneCutoff;
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    Splits a triangle list into meshlets of up to BLITZEN_MESHLET_MAX_VERTICES vertices and 
+    BLITZEN_MESHLET_MAX_TRIANGLES triangles, taking the triangles in order. A cache optimized list keeps 
+    neighboring triangles close, so the meshlets come out compact and with few shared vertices
+    ----------------------------------------------------------------------------------------------------*/
+    void BuildMeshlets(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, 
+    std::vector<MeshletRange>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles);
+
+    //Bounding sphere and normal cone of a meshlet, positions are three floats at the start of every positionStride bytes
+    MeshletBounds ComputeMeshletBounds(const MeshletRange& meshlet, const uint32_t* pMeshletVertices, 
+    const uint8_t* pMeshletTriangles, const float* pPositions, size_t positionStride);
+}
@@ -0,0 +1,171 @@
+#include "drawCulling.h"
+
+#include <algorithm>
+#include <tuple>
+
+namespace BlitzenRendering
+{
+    uint32_t GPUDrawBuckets::GetBucket(const MaterialInstance* pMaterial, VkIndexType indexType)
+    {
+        for(size_t bucket = 0; bucket < m_buckets.size(); ++bucket)
+        {
+            if(m_buckets[bucket].pMaterial == pMaterial && m_buckets[bucket].indexType == indexType)
+            {
+                return static_cast<uint32_t>(bucket);
+            }
+        }
+        m_buckets.push_back({pMaterial, indexType});
+        return static_cast<uint32_t>(m_buckets.size() - 1);
+    }
+
+    void BuildGPUSurfaceTable(const std::vector<VulkanMeshAsset>& assets, std::vector<GPUSurfaceData>& surfaces,
+    std::vector<uint32_t>& assetFirstSurfaces)
+    {
+        surfaces.clear();
+        assetFirstSurfaces.clear();
+        for(const VulkanMeshAsset& asset : assets)
+        {
+            assetFirstSurfaces.push_back(static_cast<uint32_t>(surfaces.size()));
+            for(const GeoSurface& surface : asset.geoSurfaces)
+            {
+                GPUSurfaceData& surfaceData = surfaces.emplace_back();
+                for(uint32_t lod = 0; lod < BLITZEN_MAX_MESH_LODS; ++lod)
+                {
+                    surfaceData.lods[lod] = lod < surface.lodCount ? surface.lods[lod] : VulkanMeshLod{0, 0, 0.f};
+                }
+                surfaceData.lodCount = surface.lodCount;
+                surfaceData.vertexBufferOffset = surface.vertexBufferOffset;
+            }
+        }
+        assetFirstSurfaces.push_back(static_cast<uint32_t>(surfaces.size()));
+    }
+
+    //The normal matrix is the inverse transpose of the mesh matrix, so that scaling does not bend the normals
+    void WriteGPUObjectData(GPUObjectData& objectData, const VulkanRenderObject& object, const glm::mat4& meshMatrix,
+    const glm::vec4& worldSphere, uint32_t surfaceIndex, uint32_t drawBucket)
+    {
+        objectData.modelMatrix = object.transform;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(meshMatrix)));
+        for(int column = 0; column < 3; ++column)
+        {
+            objectData.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.f);
+        }
+        objectData.materialIndex = object.pMaterial->materialIndex;
+        objectData.surfaceIndex = surfaceIndex;
+        objectData.drawBucket = drawBucket;
+
+        //The error of the levels of detail grows with the largest scale of the mesh's matrix, like the sphere's radius
+        objectData.lodScale = 0.f;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            objectData.lodScale = std::max(objectData.lodScale, glm::length(glm::vec3(meshMatrix[axis])));
+        }
+        objectData.boundingSphere = worldSphere;
+    }
+
+    uint32_t SelectGPUSurfaceLod(const GPUSurfaceData& surface, const GPUObjectData& object,
+    const GPUCullingData& cullingData)
+    {
+        if(cullingData.lodErrorScale <= 0.f || surface.lodCount < 2)
+        {
+            return 0;
+        }
+
+        //The view matrix is rigid, so the distance to the camera is the same in world space as in view space
+        float distance = glm::length(glm::vec3(object.boundingSphere) - glm::vec3(cullingData.cameraPosition)) -
+        object.boundingSphere.w;
+        if(distance <= 0.f)
+        {
+            return 0;
+        }
+
+        float pixelsPerError = object.lodScale / distance * cullingData.lodErrorScale;
+        for(uint32_t lod = surface.lodCount - 1; lod > 0; --lod)
+        {
+            if(surface.lods[lod].error * pixelsPerError <= cullingData.lodPixelThreshold)
+            {
+                return lod;
+            }
+        }
+        return 0;
+    }
+
+    void CullDrawsReference(const GPUCullingData& cullingData, const GPUObjectData* pObjects,
+    const GPUSurfaceData* pSurfaces, uint32_t bucketCount, VkDrawIndexedIndirectCommand* pCommands,
+    uint32_t* pInstanceObjects, uint32_t* pDrawCounts)
+    {
+        std::fill(pDrawCounts, pDrawCounts + bucketCount, 0u);
+        for(uint32_t i = 0; i < cullingData.objectCount; ++i)
+        {
+            const GPUObjectData& object = pObjects[i];
+            if(!BlitzenEngine::IsSphereInFrustum(cullingData.frustumPlanes, object.boundingSphere) ||
+            object.drawBucket >= bucketCount)
+            {
+                continue;
+            }
+
+            const GPUSurfaceData& surface = pSurfaces[object.surfaceIndex];
+            const VulkanMeshLod& lod = surface.lods[SelectGPUSurfaceLod(surface, object, cullingData)];
+
+            uint32_t slot = object.drawBucket * cullingData.drawCapacity + pDrawCounts[object.drawBucket]++;
+            pCommands[slot].indexCount = lod.indexCount;
+            pCommands[slot].instanceCount = 1;
+            pCommands[slot].firstIndex = lod.firstIndex;
+            pCommands[slot].vertexOffset = static_cast<int32_t>(surface.vertexBufferOffset);
+            pCommands[slot].firstInstance = slot;
+            pInstanceObjects[slot] = i;
+        }
+    }
+
+    uint32_t CompareCulledDraws(uint32_t bucketCount, uint32_t drawCapacity,
+    const VkDrawIndexedIndirectCommand* pCommands, const uint32_t* pInstanceObjects, const uint32_t* pDrawCounts,
+    const VkDrawIndexedIndirectCommand* pOtherCommands, const uint32_t* pOtherInstanceObjects,
+    const uint32_t* pOtherDrawCounts)
+    {
+        //Every draw is its object and the indices that it draws, each side's draws are sorted so they can be merged
+        using CulledDraw = std::tuple<uint32_t, uint32_t, uint32_t, int32_t>;
+        std::vector<CulledDraw> draws;
+        std::vector<CulledDraw> otherDraws;
+        auto gatherDraws = [drawCapacity](uint32_t bucket, const VkDrawIndexedIndirectCommand* pBucketCommands,
+        const uint32_t* pBucketObjects, uint32_t count, std::vector<CulledDraw>& bucketDraws)
+        {
+            bucketDraws.clear();
+            for(uint32_t draw = 0; draw < std::min(count, drawCapacity); ++draw)
+            {
+                uint32_t slot = bucket * drawCapacity + draw;
+                bucketDraws.emplace_back(pBucketObjects[slot], pBucketCommands[slot].firstIndex,
+                pBucketCommands[slot].indexCount, pBucketCommands[slot].vertexOffset);
+            }
+            std::sort(bucketDraws.begin(), bucketDraws.end());
+        };
+
+        uint32_t mismatchCount = 0;
+        for(uint32_t bucket = 0; bucket < bucketCount; ++bucket)
+        {
+            gatherDraws(bucket, pCommands, pInstanceObjects, pDrawCounts[bucket], draws);
+            gatherDraws(bucket, pOtherCommands, pOtherInstanceObjects, pOtherDrawCounts[bucket], otherDraws);
+
+            size_t draw = 0;
+            size_t otherDraw = 0;
+            while(draw < draws.size() || otherDraw < otherDraws.size())
+            {
+                if(otherDraw == otherDraws.size() || (draw < draws.size() && draws[draw] < otherDraws[otherDraw]))
+                {
+                    ++draw;
+                    ++mismatchCount;
+                }
+                else if(draw == draws.size() || otherDraws[otherDraw] < draws[draw])
+                {
+                    ++otherDraw;
+                    ++mismatchCount;
+                }
+                else
+                {
+                    ++draw;
+                    ++otherDraw;
+                }
+            }
+        }
+        return mismatchCount;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "renderObjectRegistry.h"
+#include "Culling/occlusionCulling.h"
+
+namespace BlitzenRendering
+{
+    //Invocations in a workgroup of the draw culling shader, each one culls a single render object
+    #define BLITZEN_DRAW_CULLING_GROUP_SIZE     64
+    //The depth pyramid shader's workgroups are square, each invocation writes a single texel
+    #define BLITZEN_DEPTH_PYRAMID_GROUP_SIZE    8
+
+    /*------------------------------------------------------------------------------------------------------
+    Without occlusion culling the draws are culled once a frame. With it, the early phase draws the objects
+    that were visible last frame, the depth pyramid is built from what they drew, then the late phase tests
+    every object against it, keeps what it found for the next frame and draws the ones that the early phase 
+    missed. Objects that were hidden by something that moved away show up in the same frame that way
+    --------------------------------------------------------------------------------------------------------*/
+    enum class DrawCullingPhase : uint32_t
+    {
+        DCP_All = 0,
+        DCP_Early = 1,
+        DCP_Late = 2
+    };
+
+    //A material and index buffer pair, everything in between the binds of one indirect draw
+    struct GPUDrawBucket
+    {
+        const MaterialInstance* pMaterial;
+        VkIndexType indexType;
+    };
+
+    /*------------------------------------------------------------------------------------------------------
+    Gives every material and index type pair that the render objects use a bucket id, the first time that it
+    is seen, which it keeps. The draw culling shader writes the draws of each bucket to their own range, so
+    the draws of a bucket are recorded with a single indirect draw after binding its state
+    --------------------------------------------------------------------------------------------------------*/
+    class GPUDrawBuckets
+    {
+    public:
+
+        uint32_t GetBucket(const MaterialInstance* pMaterial, VkIndexType indexType);
+
+        inline const std::vector<GPUDrawBucket>& GetBuckets() const {return m_buckets;}
+
+        //Forgets the ids, for when the materials that they were given to are destroyed
+        inline void Clear() {m_buckets.clear();}
+
+    private:
+
+        //There are only a few of them so they are found with a scan
+        std::vector<GPUDrawBucket> m_buckets;
+    };
+
+    /*------------------------------------------------------------------------------------------------------
+    Flattens the surfaces of every asset to the table that the draw culling shader reads. The first surface
+    of every asset is its place in the table, with the total surface count after the last asset
+    --------------------------------------------------------------------------------------------------------*/
+    void BuildGPUSurfaceTable(const std::vector<VulkanMeshAsset>& assets, std::vector<GPUSurfaceData>& surfaces,
+    std::vector<uint32_t>& assetFirstSurfaces);
+
+    //Writes what the shaders need to know about a render object, the mesh matrix is the one without the dequantization
+    void WriteGPUObjectData(GPUObjectData& objectData, const VulkanRenderObject& object, const glm::mat4& meshMatrix,
+    const glm::vec4& worldSphere, uint32_t surfaceIndex, uint32_t drawBucket);
+
+    //Picks the level of detail of a surface the way that the draw culling shader does, from the world space sphere
+    uint32_t SelectGPUSurfaceLod(const GPUSurfaceData& surface, const GPUObjectData& object,
+    const GPUCullingData& cullingData);
+
+    /*------------------------------------------------------------------------------------------------------
+    Does on the CPU what the draw culling shader does on the GPU, from the same data, for draws culled in a
+    single phase since the depth pyramid is only on the GPU. The commands, instance objects and draw counts
+    are laid out like the shader's buffers, they need room for the bucket count times the culling data's 
+    draw capacity. The draws of a bucket are in object order, while the shader's are in whichever order its
+    invocations reached the bucket's counter
+    --------------------------------------------------------------------------------------------------------*/
+    void CullDrawsReference(const GPUCullingData& cullingData, const GPUObjectData* pObjects,
+    const GPUSurfaceData* pSurfaces, uint32_t bucketCount, VkDrawIndexedIndirectCommand* pCommands,
+    uint32_t* pInstanceObjects, uint32_t* pDrawCounts);
+
+    /*------------------------------------------------------------------------------------------------------
+    Compares two sets of culled draws with the layout above, regardless of the order of the draws within a
+    bucket. Returns how many draws are in only one of the two, or differ in their level of detail
+    --------------------------------------------------------------------------------------------------------*/
+    uint32_t CompareCulledDraws(uint32_t bucketCount, uint32_t drawCapacity,
+    const VkDrawIndexedIndirectCommand* pCommands, const uint32_t* pInstanceObjects, const uint32_t* pDrawCounts,
+    const VkDrawIndexedIndirectCommand* pOtherCommands, const uint32_t* pOtherInstanceObjects,
+    const uint32_t* pOtherDrawCounts);
+}
@@ -0,0 +1,149 @@
+#include "drawSorting.h"
+#include "Core/radixSort.h"
+
+#include <cstring>
+
+namespace BlitzenRendering
+{
+    //The pipeline, descriptor set and index type fields packed together, as they sit under the depth of transparent keys
+    #define BLITZEN_SORT_KEY_STATE_BITS     (BLITZEN_SORT_KEY_PIPELINE_BITS + BLITZEN_SORT_KEY_DESCRIPTOR_SET_BITS + \
+    BLITZEN_SORT_KEY_INDEX_TYPE_BITS)
+    #define BLITZEN_SORT_KEY_PASS_SHIFT     (64 - BLITZEN_SORT_KEY_PASS_BITS)
+
+    void DrawSorter::SortRenderObjects(const RenderObjectRegistry& registry, const std::vector<VulkanMeshAsset>& assets,
+    const DrawContext& drawContext, const uint8_t* pVisibility /* =nullptr */)
+    {
+        const std::vector<VulkanRenderObject>& objects = registry.GetRenderObjects();
+        const BlitzenEngine::BoundingSpheres& spheres = registry.GetObjectSpheres();
+        const std::vector<uint32_t>& objectAssets = registry.GetObjectAssets();
+        const std::vector<uint32_t>& objectSurfaces = registry.GetObjectSurfaces();
+        m_sortKeys.resize(objects.size());
+        m_drawOrder.resize(objects.size());
+        m_scratchKeys.resize(objects.size());
+        m_scratchOrder.resize(objects.size());
+
+        //Assets are only ever added, the surface ids of the ones that were already counted stay the same
+        if(m_assetFirstSurfaces.size() < assets.size() + 1)
+        {
+            if(m_assetFirstSurfaces.empty())
+            {
+                m_assetFirstSurfaces.push_back(0);
+            }
+            for(size_t asset = m_assetFirstSurfaces.size() - 1; asset < assets.size(); ++asset)
+            {
+                m_assetFirstSurfaces.push_back(m_assetFirstSurfaces.back() +
+                static_cast<uint32_t>(assets[asset].geoSurfaces.size()));
+            }
+        }
+
+        //Objects of the same surface come one after the other, so the state of the previous one is often reused
+        const MaterialInstance* pLastMaterial = nullptr;
+        VkIndexType lastIndexType = VK_INDEX_TYPE_MAX_ENUM;
+        uint64_t stateKey = 0;
+        size_t drawCount = 0;
+        for(uint32_t i = 0; i < objects.size(); ++i)
+        {
+            if(pVisibility && !pVisibility[i])
+            {
+                continue;
+            }
+
+            const VulkanRenderObject& object = objects[i];
+            if(object.pMaterial != pLastMaterial || object.indexType != lastIndexType)
+            {
+                pLastMaterial = object.pMaterial;
+                lastIndexType = object.indexType;
+                stateKey = BuildStateKey(pLastMaterial, lastIndexType);
+            }
+
+            //The depth of the bounding sphere's center, the bits of a positive float sort like the float
+            float viewZ = drawContext.viewMatrix[0][2] * spheres.centerX[i] + drawContext.viewMatrix[1][2] *
+            spheres.centerY[i] + drawContext.viewMatrix[2][2] * spheres.centerZ[i] + drawContext.viewMatrix[3][2];
+            float depth = viewZ < 0.f ? -viewZ : 0.f;
+            uint32_t depthBits;
+            memcpy(&depthBits, &depth, sizeof(float));
+
+            uint64_t key = stateKey & (~uint64_t(0) << BLITZEN_SORT_KEY_PASS_SHIFT);
+            uint64_t state = stateKey & ((uint64_t(1) << BLITZEN_SORT_KEY_STATE_BITS) - 1);
+            if(key >> BLITZEN_SORT_KEY_PASS_SHIFT == static_cast<uint64_t>(DrawSortPass::DSP_Transparent))
+            {
+                key |= uint64_t(~depthBits) << BLITZEN_SORT_KEY_STATE_BITS | state;
+            }
+            else
+            {
+                uint64_t surfaceId = (m_assetFirstSurfaces[objectAssets[i]] + objectSurfaces[i]) &
+                ((1 << BLITZEN_SORT_KEY_SURFACE_BITS) - 1);
+                key |= state << (BLITZEN_SORT_KEY_SURFACE_BITS + BLITZEN_SORT_KEY_DEPTH_BITS) |
+                surfaceId << BLITZEN_SORT_KEY_DEPTH_BITS |
+                depthBits >> (BLITZEN_SORT_KEY_TRANSPARENT_DEPTH_BITS - BLITZEN_SORT_KEY_DEPTH_BITS);
+            }
+            m_sortKeys[drawCount] = key;
+            m_drawOrder[drawCount] = i;
+            ++drawCount;
+        }
+        m_sortKeys.resize(drawCount);
+        m_drawOrder.resize(drawCount);
+
+        BlitzenEngine::RadixSortKeys(m_sortKeys.data(), m_drawOrder.data(), m_scratchKeys.data(), m_scratchOrder.data(),
+        drawCount);
+    }
+
+    uint64_t DrawSorter::BuildStateKey(const MaterialInstance* pMaterial, VkIndexType indexType)
+    {
+        DrawSortPass pass = DrawSortPass::DSP_Other;
+        if(pMaterial->pass == MaterialPass::MP_opaqueMaterial)
+        {
+            pass = DrawSortPass::DSP_Opaque;
+        }
+        else if(pMaterial->pass == MaterialPass::MP_transparentMaterial)
+        {
+            pass = DrawSortPass::DSP_Transparent;
+        }
+
+        uint64_t pipeline = GetPipelineId(pMaterial->pPipeline) & ((1 << BLITZEN_SORT_KEY_PIPELINE_BITS) - 1);
+        uint64_t descriptorSet = GetDescriptorSetId(pMaterial->descriptorSet) &
+        ((1 << BLITZEN_SORT_KEY_DESCRIPTOR_SET_BITS) - 1);
+        uint64_t indexBuffer = indexType == VK_INDEX_TYPE_UINT16 ? 0 : indexType == VK_INDEX_TYPE_UINT32 ? 1 : 2;
+
+        return static_cast<uint64_t>(pass) << BLITZEN_SORT_KEY_PASS_SHIFT |
+        pipeline << (BLITZEN_SORT_KEY_DESCRIPTOR_SET_BITS + BLITZEN_SORT_KEY_INDEX_TYPE_BITS) |
+        descriptorSet << BLITZEN_SORT_KEY_INDEX_TYPE_BITS | indexBuffer;
+    }
+
+    uint32_t DrawSorter::GetPipelineId(const MaterialPipeline* pPipeline)
+    {
+        for(uint32_t i = 0; i < m_pipelines.size(); ++i)
+        {
+            if(m_pipelines[i] == pPipeline)
+            {
+                return i;
+            }
+        }
+        m_pipelines.push_back(pPipeline);
+        return static_cast<uint32_t>(m_pipelines.size()) - 1;
+    }
+
+    uint32_t DrawSorter::GetDescriptorSetId(VkDescriptorSet descriptorSet)
+    {
+        for(uint32_t i = 0; i < m_descriptorSets.size(); ++i)
+        {
+            if(m_descriptorSets[i] == descriptorSet)
+            {
+                return i;
+            }
+        }
+        m_descriptorSets.push_back(descriptorSet);
+        return static_cast<uint32_t>(m_descriptorSets.size()) - 1;
+    }
+
+    void DrawSorter::Clear()
+    {
+        m_sortKeys.clear();
+        m_drawOrder.clear();
+        m_scratchKeys.clear();
+        m_scratchOrder.clear();
+        m_pipelines.clear();
+        m_descriptorSets.clear();
+        m_assetFirstSurfaces.clear();
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "renderObjectRegistry.h"
+
+namespace BlitzenRendering
+{
+    /*------------------------------------------------------------------------------------------------------
+    Layout of the 64 bit sort keys, from the most significant bits down. Opaque objects sort by state, then
+    by the surface that they draw and then by depth front to back, so the binds only change at the edges of
+    state groups, the objects of a surface end up next to each other to be drawn as instances, and near
+    objects hide the ones behind them. Their depth only keeps the top 16 bits of the float, which is enough
+    to order them. Transparent objects are drawn after, back to front with the full depth, their state comes
+    below the depth since blending has to follow the depth order. Ids that do not fit in their bits wrap
+    around, the draws then still bind the right state, they only share groups with other states
+    --------------------------------------------------------------------------------------------------------*/
+    #define BLITZEN_SORT_KEY_PASS_BITS              2
+    #define BLITZEN_SORT_KEY_PIPELINE_BITS          12
+    #define BLITZEN_SORT_KEY_DESCRIPTOR_SET_BITS    16
+    #define BLITZEN_SORT_KEY_INDEX_TYPE_BITS        2
+    #define BLITZEN_SORT_KEY_SURFACE_BITS           16
+    #define BLITZEN_SORT_KEY_DEPTH_BITS             16
+    #define BLITZEN_SORT_KEY_TRANSPARENT_DEPTH_BITS 32
+
+    //The passes in the order that they are drawn
+    enum class DrawSortPass : uint8_t
+    {
+        DSP_Opaque,
+        DSP_Transparent,
+        DSP_Other
+    };
+
+    //The binds and draws that DrawGeometry recorded in a frame, along with the binds that it skipped
+    struct DrawStatistics
+    {
+        uint32_t drawCount = 0;
+        uint32_t instanceCount = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t descriptorSetBinds = 0;
+        uint32_t indexBufferBinds = 0;
+        uint32_t skippedBinds = 0;
+
+        inline bool operator == (const DrawStatistics& other) const
+        {
+            return drawCount == other.drawCount && instanceCount == other.instanceCount &&
+            pipelineBinds == other.pipelineBinds && descriptorSetBinds == other.descriptorSetBinds &&
+            indexBufferBinds == other.indexBufferBinds && skippedBinds == other.skippedBinds;
+        }
+        inline bool operator != (const DrawStatistics& other) const {return !(*this == other);}
+    };
+
+    /*------------------------------------------------------------------------------------------------------
+    Orders the render objects of a registry for drawing. Every frame each object gets a sort key from its
+    pass, pipeline, material descriptor set, index buffer, surface and view depth, and the keys are radix
+    sorted. Pipelines and descriptor sets get small ids the first time that they are seen, which they keep.
+    The id of a surface is its place among the surfaces of every asset
+    --------------------------------------------------------------------------------------------------------*/
+    class DrawSorter
+    {
+    public:
+
+        /*-------------------------------------------------------------------------------------------------
+        Builds the key of every render object for the draw context's view and sorts the objects by them.
+        When the visibility is given, the objects that it marks with 0 are left out of the draw order
+        --------------------------------------------------------------------------------------------------*/
+        void SortRenderObjects(const RenderObjectRegistry& registry, const std::vector<VulkanMeshAsset>& assets,
+        const DrawContext& drawContext, const uint8_t* pVisibility = nullptr);
+
+        //Indices of the registry's render objects, in the order that they should be drawn
+        inline const std::vector<uint32_t>& GetDrawOrder() const {return m_drawOrder;}
+        inline const std::vector<uint64_t>& GetSortKeys() const {return m_sortKeys;}
+
+        //Forgets the ids, for when the pipelines, descriptor sets or assets that they were given to are destroyed
+        void Clear();
+
+    private:
+
+        //The pass and the state fields of the key, the same for every object of a material and index type
+        uint64_t BuildStateKey(const MaterialInstance* pMaterial, VkIndexType indexType);
+
+        uint32_t GetPipelineId(const MaterialPipeline* pPipeline);
+        uint32_t GetDescriptorSetId(VkDescriptorSet descriptorSet);
+
+    private:
+
+        std::vector<uint64_t> m_sortKeys;
+        std::vector<uint32_t> m_drawOrder;
+        //The radix sort moves the keys and the objects back and forth between these and the arrays above
+        std::vector<uint64_t> m_scratchKeys;
+        std::vector<uint32_t> m_scratchOrder;
+
+        //The id of each is its place in the array, there are only a few of them so they are found with a scan
+        std::vector<const MaterialPipeline*> m_pipelines;
+        std::vector<VkDescriptorSet> m_descriptorSets;
+        //The id of the first surface of every asset
+        std::vector<uint32_t> m_assetFirstSurfaces;
+    };
+}
@@ -0,0 +1,289 @@
+#include "renderObjectRegistry.h"
+#include "Core/matrixKernels.h"
+
+#include <algorithm>
+
+namespace BlitzenRendering
+{
+    RenderInstanceHandle RenderObjectRegistry::AddMeshInstance(const std::vector<VulkanMeshAsset>& assets,
+    uint32_t meshAsset, const glm::mat4& meshMatrix)
+    {
+        return AddInstance(assets, meshAsset, meshMatrix, BlitzenEngine::TransformHandle(), glm::mat4(1.f));
+    }
+
+    void RenderObjectRegistry::AddSceneNode(const BlitzenEngine::TransformHierarchy& hierarchy,
+    BlitzenEngine::TransformHandle node, const std::vector<VulkanMeshAsset>& assets, const glm::mat4& topMatrix,
+    std::vector<RenderInstanceHandle>* pInstances /* =nullptr */)
+    {
+        uint32_t nodeIndex = hierarchy.GetIndex(node);
+        if(nodeIndex == BLITZEN_SCENE_NODE_NONE)
+        {
+            return;
+        }
+
+        //The subtree is a contiguous range, the top matrix is applied to all of its world transforms with a single batch
+        uint32_t subtreeSize = hierarchy.GetSubtreeSizes()[nodeIndex];
+        std::vector<glm::mat4> meshMatrices(subtreeSize);
+        BlitzenEngine::MultiplyMatrices(meshMatrices.data(), &topMatrix, 0,
+        hierarchy.GetWorldTransforms().data() + nodeIndex, 1, subtreeSize);
+        for(uint32_t i = nodeIndex; i < nodeIndex + subtreeSize; ++i)
+        {
+            uint32_t meshAsset = hierarchy.GetMeshAssets()[i];
+            if(meshAsset >= assets.size())
+            {
+                continue;
+            }
+
+            RenderInstanceHandle instance = AddInstance(assets, meshAsset, meshMatrices[i - nodeIndex],
+            hierarchy.GetHandle(i), topMatrix);
+            if(pInstances)
+            {
+                pInstances->push_back(instance);
+            }
+        }
+    }
+
+    RenderInstanceHandle RenderObjectRegistry::AddInstance(const std::vector<VulkanMeshAsset>& assets,
+    uint32_t meshAsset, const glm::mat4& meshMatrix, BlitzenEngine::TransformHandle node, const glm::mat4& topMatrix)
+    {
+        if(meshAsset >= assets.size())
+        {
+            return RenderInstanceHandle();
+        }
+
+        //Slots of removed instances are reused, their generation was already moved past the old handles
+        RenderInstanceHandle handle;
+        if(!m_freeInstances.empty())
+        {
+            handle.slot = m_freeInstances.back();
+            m_freeInstances.pop_back();
+        }
+        else
+        {
+            handle.slot = static_cast<uint32_t>(m_instances.size());
+            m_instances.push_back(InstanceSlot());
+        }
+        InstanceSlot& instance = m_instances[handle.slot];
+        handle.generation = instance.generation;
+        instance.bAlive = true;
+        instance.meshAsset = meshAsset;
+        instance.vertexDequantization = assets[meshAsset].vertexDequantization;
+        instance.node = node;
+        instance.topMatrix = topMatrix;
+        instance.nextNodeInstance = BLITZEN_SCENE_NODE_NONE;
+        instance.objects.clear();
+
+        //Instances that follow a node are linked to the other instances of that node
+        if(node.slot != BLITZEN_SCENE_NODE_NONE)
+        {
+            if(node.slot >= m_nodeInstances.size())
+            {
+                m_nodeInstances.resize(node.slot + 1, BLITZEN_SCENE_NODE_NONE);
+            }
+            instance.nextNodeInstance = m_nodeInstances[node.slot];
+            m_nodeInstances[node.slot] = handle.slot;
+        }
+
+        const VulkanMeshAsset& asset = assets[meshAsset];
+        for(uint32_t s = 0; s < asset.geoSurfaces.size(); ++s)
+        {
+            const GeoSurface& surface = asset.geoSurfaces[s];
+            uint32_t object = static_cast<uint32_t>(m_objects.size());
+            instance.objects.push_back(object);
+
+            m_objects.push_back(VulkanRenderObject());
+            VulkanRenderObject& newObject = m_objects.back();
+            newObject.firstIndex = surface.lods[0].firstIndex;
+            newObject.indexCount = surface.lods[0].indexCount;
+            newObject.pMaterial = surface.pMaterial;
+            newObject.vertexBufferOffset = surface.vertexBufferOffset;
+            newObject.indexType = surface.indexType;
+            m_objectMeshMatrices.push_back(meshMatrix);
+            m_objectAssets.push_back(meshAsset);
+            m_objectSurfaces.push_back(s);
+            m_objectLocalSpheres.push_back(surface.boundingSphere);
+            m_objectSpheres.PushBack(surface.boundingSphere);
+            m_objectInstances.push_back(handle.slot);
+            m_objectChangedFlags.push_back(0);
+        }
+        WriteInstanceTransform(handle.slot, meshMatrix);
+
+        return handle;
+    }
+
+    void RenderObjectRegistry::RemoveMeshInstance(RenderInstanceHandle handle)
+    {
+        if(!IsValid(handle))
+        {
+            return;
+        }
+
+        InstanceSlot& instance = m_instances[handle.slot];
+        if(instance.node.slot != BLITZEN_SCENE_NODE_NONE)
+        {
+            uint32_t* pLink = &m_nodeInstances[instance.node.slot];
+            while(*pLink != handle.slot)
+            {
+                pLink = &m_instances[*pLink].nextNodeInstance;
+            }
+            *pLink = instance.nextNodeInstance;
+        }
+
+        /*-------------------------------------------------------------------------------------------------
+        Every object is replaced by the last one of the array, starting from the object furthest back, so
+        that an object of this instance that is still to be removed is never the one moved
+        --------------------------------------------------------------------------------------------------*/
+        std::vector<uint32_t>& objects = instance.objects;
+        std::sort(objects.begin(), objects.end());
+        for(size_t i = objects.size(); i-- > 0;)
+        {
+            uint32_t object = objects[i];
+            uint32_t last = static_cast<uint32_t>(m_objects.size()) - 1;
+            if(object != last)
+            {
+                m_objects[object] = m_objects[last];
+                m_objectMeshMatrices[object] = m_objectMeshMatrices[last];
+                m_objectAssets[object] = m_objectAssets[last];
+                m_objectSurfaces[object] = m_objectSurfaces[last];
+                m_objectLocalSpheres[object] = m_objectLocalSpheres[last];
+                m_objectSpheres.Move(object, last);
+                m_objectInstances[object] = m_objectInstances[last];
+                m_instances[m_objectInstances[object]].objects[m_objectSurfaces[object]] = object;
+                MarkObjectChanged(object);
+            }
+            m_objects.pop_back();
+            m_objectMeshMatrices.pop_back();
+            m_objectAssets.pop_back();
+            m_objectSurfaces.pop_back();
+            m_objectLocalSpheres.pop_back();
+            m_objectSpheres.PopBack();
+            m_objectInstances.pop_back();
+            m_objectChangedFlags.pop_back();
+        }
+
+        //Objects that were listed as changed may now be past the end of the array
+        uint32_t objectCount = static_cast<uint32_t>(m_objects.size());
+        m_changedObjects.erase(std::remove_if(m_changedObjects.begin(), m_changedObjects.end(),
+        [objectCount](uint32_t object) {return object >= objectCount;}), m_changedObjects.end());
+
+        instance.bAlive = false;
+        instance.objects.clear();
+        ++instance.generation;
+        m_freeInstances.push_back(handle.slot);
+    }
+
+    bool RenderObjectRegistry::IsValid(RenderInstanceHandle handle) const
+    {
+        return handle.slot < m_instances.size() && m_instances[handle.slot].bAlive &&
+        m_instances[handle.slot].generation == handle.generation;
+    }
+
+    void RenderObjectRegistry::SetInstanceTransform(RenderInstanceHandle handle, const glm::mat4& meshMatrix)
+    {
+        if(IsValid(handle))
+        {
+            WriteInstanceTransform(handle.slot, meshMatrix);
+        }
+    }
+
+    void RenderObjectRegistry::WriteInstanceTransform(uint32_t slot, const glm::mat4& meshMatrix)
+    {
+        const InstanceSlot& instance = m_instances[slot];
+        glm::mat4 transform;
+        BlitzenEngine::MultiplyMatrices(&transform, &meshMatrix, 0, &instance.vertexDequantization, 0, 1);
+        for(uint32_t object : instance.objects)
+        {
+            m_objects[object].transform = transform;
+            m_objectMeshMatrices[object] = meshMatrix;
+            m_objectSpheres.Set(object, BlitzenEngine::TransformBoundingSphere(meshMatrix, m_objectLocalSpheres[object]));
+            MarkObjectChanged(object);
+        }
+    }
+
+    void RenderObjectRegistry::MarkObjectChanged(uint32_t object)
+    {
+        if(!m_objectChangedFlags[object])
+        {
+            m_objectChangedFlags[object] = 1;
+            m_changedObjects.push_back(object);
+        }
+    }
+
+    void RenderObjectRegistry::UpdateSceneInstances(const BlitzenEngine::TransformHierarchy& hierarchy)
+    {
+        const std::vector<glm::mat4>& worldTransforms = hierarchy.GetWorldTransforms();
+        for(uint32_t node : hierarchy.GetChangedNodes())
+        {
+            BlitzenEngine::TransformHandle nodeHandle = hierarchy.GetHandle(node);
+            if(nodeHandle.slot >= m_nodeInstances.size())
+            {
+                continue;
+            }
+
+            for(uint32_t slot = m_nodeInstances[nodeHandle.slot]; slot != BLITZEN_SCENE_NODE_NONE;
+            slot = m_instances[slot].nextNodeInstance)
+            {
+                //A slot of the hierarchy that was reused by a new node still links the instances of the old one
+                if(m_instances[slot].node != nodeHandle)
+                {
+                    continue;
+                }
+
+                glm::mat4 meshMatrix;
+                BlitzenEngine::MultiplyMatrices(&meshMatrix, &m_instances[slot].topMatrix, 0, &worldTransforms[node], 0, 1);
+                WriteInstanceTransform(slot, meshMatrix);
+            }
+        }
+    }
+
+    void RenderObjectRegistry::SelectLods(const std::vector<VulkanMeshAsset>& assets, const DrawContext& drawContext,
+    const uint8_t* pVisibility /* =nullptr */)
+    {
+        for(size_t i = 0; i < m_objects.size(); ++i)
+        {
+            if(pVisibility && !pVisibility[i])
+            {
+                continue;
+            }
+
+            const GeoSurface& surface = assets[m_objectAssets[i]].geoSurfaces[m_objectSurfaces[i]];
+            const VulkanMeshLod& lod = surface.lods[SelectSurfaceLod(surface, m_objectMeshMatrices[i], drawContext)];
+            m_objects[i].firstIndex = lod.firstIndex;
+            m_objects[i].indexCount = lod.indexCount;
+        }
+    }
+
+    void RenderObjectRegistry::ClearChangedObjects()
+    {
+        for(uint32_t object : m_changedObjects)
+        {
+            m_objectChangedFlags[object] = 0;
+        }
+        m_changedObjects.clear();
+    }
+
+    void RenderObjectRegistry::Clear()
+    {
+        for(uint32_t slot = 0; slot < m_instances.size(); ++slot)
+        {
+            if(m_instances[slot].bAlive)
+            {
+                m_instances[slot].bAlive = false;
+                m_instances[slot].objects.clear();
+                ++m_instances[slot].generation;
+                m_freeInstances.push_back(slot);
+            }
+        }
+        m_nodeInstances.clear();
+
+        m_objects.clear();
+        m_objectMeshMatrices.clear();
+        m_objectAssets.clear();
+        m_objectSurfaces.clear();
+        m_objectLocalSpheres.clear();
+        m_objectSpheres.Clear();
+        m_objectInstances.clear();
+        m_objectChangedFlags.clear();
+        m_changedObjects.clear();
+    }
+}
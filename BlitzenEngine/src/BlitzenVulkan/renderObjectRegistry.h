@@ -0,0 +1,126 @@
+#pragma once
+
+#include "vulkanRenderData.h"
+#include "Culling/frustumCulling.h"
+
+namespace BlitzenRendering
+{
+    //Refers to a mesh instance of a RenderObjectRegistry, stays valid until the instance is removed
+    struct RenderInstanceHandle
+    {
+        uint32_t slot = BLITZEN_SCENE_NODE_NONE;
+        uint32_t generation = 0;
+
+        inline bool operator == (const RenderInstanceHandle& other) const
+        {return slot == other.slot && generation == other.generation;}
+        inline bool operator != (const RenderInstanceHandle& other) const {return !(*this == other);}
+    };
+
+    /*-----------------------------------------------------------------------------------------------------
+    The render objects that the renderer draws, kept from frame to frame. Adding a mesh instance creates a
+    render object for each of its surfaces once, moving it only rewrites the transforms of those objects.
+    The objects are packed in a single array that the draw walks, removing an instance moves the last
+    objects into its place, so the array never has holes and the handles of other instances stay valid.
+    Instances can follow a node of the scene hierarchy, they move whenever the hierarchy recomputes it
+    ------------------------------------------------------------------------------------------------------*/
+    class RenderObjectRegistry
+    {
+    public:
+
+        /*-------------------------------------------------------------------------------------------------
+        Adds a render object for every surface of the mesh asset. The mesh matrix takes the mesh to world
+        space, the surfaces' materials should already be assigned since the objects copy them
+        --------------------------------------------------------------------------------------------------*/
+        RenderInstanceHandle AddMeshInstance(const std::vector<VulkanMeshAsset>& assets, uint32_t meshAsset,
+        const glm::mat4& meshMatrix);
+
+        /*-------------------------------------------------------------------------------------------------
+        Adds an instance for every node with a mesh in the subtree of the node, at the top matrix times the
+        node's world transform. The instances follow their nodes from then on. Their handles are appended
+        to pInstances if it is not null
+        --------------------------------------------------------------------------------------------------*/
+        void AddSceneNode(const BlitzenEngine::TransformHierarchy& hierarchy, BlitzenEngine::TransformHandle node,
+        const std::vector<VulkanMeshAsset>& assets, const glm::mat4& topMatrix,
+        std::vector<RenderInstanceHandle>* pInstances = nullptr);
+
+        //Removes the render objects of the instance, the last objects of the array are moved into their places
+        void RemoveMeshInstance(RenderInstanceHandle instance);
+
+        bool IsValid(RenderInstanceHandle instance) const;
+
+        void SetInstanceTransform(RenderInstanceHandle instance, const glm::mat4& meshMatrix);
+
+        //Moves the instances that follow the nodes whose world transforms the hierarchy's last update recomputed
+        void UpdateSceneInstances(const BlitzenEngine::TransformHierarchy& hierarchy);
+
+        //Picks the level of detail of every render object for the draw context's view, or only of the visible ones
+        void SelectLods(const std::vector<VulkanMeshAsset>& assets, const DrawContext& drawContext,
+        const uint8_t* pVisibility = nullptr);
+
+        inline const std::vector<VulkanRenderObject>& GetRenderObjects() const {return m_objects;}
+
+        //What each render object was created from, indexed like the render objects
+        inline const std::vector<glm::mat4>& GetObjectMeshMatrices() const {return m_objectMeshMatrices;}
+        inline const std::vector<uint32_t>& GetObjectAssets() const {return m_objectAssets;}
+        inline const std::vector<uint32_t>& GetObjectSurfaces() const {return m_objectSurfaces;}
+        //The world space bounding sphere of every render object, moved along with its transform
+        inline const BlitzenEngine::BoundingSpheres& GetObjectSpheres() const {return m_objectSpheres;}
+
+        /*-------------------------------------------------------------------------------------------------
+        Indices of the render objects whose transform changed, or that were created or moved to another
+        place in the array, since the list was last cleared. Each object is listed once
+        --------------------------------------------------------------------------------------------------*/
+        inline const std::vector<uint32_t>& GetChangedObjects() const {return m_changedObjects;}
+        void ClearChangedObjects();
+
+        void Clear();
+
+    private:
+
+        RenderInstanceHandle AddInstance(const std::vector<VulkanMeshAsset>& assets, uint32_t meshAsset,
+        const glm::mat4& meshMatrix, BlitzenEngine::TransformHandle node, const glm::mat4& topMatrix);
+
+        void WriteInstanceTransform(uint32_t slot, const glm::mat4& meshMatrix);
+
+        void MarkObjectChanged(uint32_t object);
+
+    private:
+
+        //The objects that the draw walks, along with what each one was created from
+        std::vector<VulkanRenderObject> m_objects;
+        //The mesh matrix without the dequantization, used to pick the level of detail
+        std::vector<glm::mat4> m_objectMeshMatrices;
+        std::vector<uint32_t> m_objectAssets;
+        std::vector<uint32_t> m_objectSurfaces;
+        //The surface's bounding sphere in the mesh's space and in world space
+        std::vector<glm::vec4> m_objectLocalSpheres;
+        BlitzenEngine::BoundingSpheres m_objectSpheres;
+        //The slot of the instance that owns every object
+        std::vector<uint32_t> m_objectInstances;
+        //Set for the places of the array that are in the changed objects
+        std::vector<uint8_t> m_objectChangedFlags;
+        std::vector<uint32_t> m_changedObjects;
+
+        struct InstanceSlot
+        {
+            uint32_t generation = 0;
+            bool bAlive = false;
+
+            uint32_t meshAsset = BLITZEN_SCENE_NODE_NONE;
+            glm::mat4 vertexDequantization{1.f};
+            //The place of the object of every surface in the objects array
+            std::vector<uint32_t> objects;
+
+            //The node that the instance follows, if any, and the matrix that its world transform is multiplied by
+            BlitzenEngine::TransformHandle node;
+            glm::mat4 topMatrix{1.f};
+            //The next instance that follows the same node
+            uint32_t nextNodeInstance = BLITZEN_SCENE_NODE_NONE;
+        };
+        std::vector<InstanceSlot> m_instances;
+        std::vector<uint32_t> m_freeInstances;
+
+        //For every slot of the hierarchy's handles, the first instance that follows its node
+        std::vector<uint32_t> m_nodeInstances;
+    };
+}
@@ -33,6 +33,32 @@ namespace BlitzenRendering
         vkCreateGraphicsPipelines(*m_pDevice, nullptr, 1, &info, nullptr, m_pGraphicsPipeline);
     }
 
+    void VulkanGraphicsPipelineBuilder::BuildComputePipeline(const char* filepath, VkPipeline* pPipeline, 
+    VkPipelineLayout* pLayout, VkPushConstantRange* pPushConstants, uint32_t pushConstantCount, 
+    VkDescriptorSetLayout* pDescriptorLayouts /* =nullptr */, uint32_t descriptorLayoutCount /* =0 */)
+    {
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        VulkanSDKobjects::PipelineLayoutCreateInfoInit(layoutInfo, pDescriptorLayouts, descriptorLayoutCount, 
+        pPushConstants, pushConstantCount);
+        vkCreatePipelineLayout(*m_pDevice, &layoutInfo, nullptr, pLayout);
+
+        std::vector<char> shaderCode;
+        ReadShaderFile(filepath, shaderCode);
+        VkShaderModuleCreateInfo moduleInfo{};
+        VulkanSDKobjects::ShaderModuleCreateInfoInit(moduleInfo, shaderCode);
+        VkShaderModule shaderModule;
+        vkCreateShaderModule(*m_pDevice, &moduleInfo, nullptr, &shaderModule);
+
+        VkComputePipelineCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        VulkanSDKobjects::PipelineShaderStageInit(info.stage, shaderModule, VK_SHADER_STAGE_COMPUTE_BIT);
+        info.layout = *pLayout;
+        vkCreateComputePipelines(*m_pDevice, nullptr, 1, &info, nullptr, pPipeline);
+
+        //The pipeline keeps what it needs from the module
+        vkDestroyShaderModule(*m_pDevice, shaderModule, nullptr);
+    }
+
     void VulkanGraphicsPipelineBuilder::Clear()
     {
         m_pGraphicsPipeline = nullptr;
@@ -68,11 +94,9 @@ namespace BlitzenRendering
         m_pGraphicsPipeline = graphicsPipeline;
         m_pPipelineLayout = pipelineLayout;
 
-        VkPushConstantRange pushConstantRange{};
-        VulkanSDKobjects::PushConstantRangeInit(pushConstantRange, sizeof(GPUPushConstant), 
-        VK_SHADER_STAGE_VERTEX_BIT);
+        //Nothing is pushed to the shaders, they read the objects' data from the object buffer
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        VulkanSDKobjects::PipelineLayoutCreateInfoInit(pipelineLayoutInfo, nullptr, 0, &pushConstantRange, 1);
+        VulkanSDKobjects::PipelineLayoutCreateInfoInit(pipelineLayoutInfo, nullptr, 0);
         vkCreatePipelineLayout(*m_pDevice, &pipelineLayoutInfo, nullptr, pipelineLayout);
 
         //Get the vertex shader code and wrap in in a vkShaderModule object
@@ -13,7 +13,10 @@
 namespace BlitzenRendering
 {
     #define VULKAN_OPAQUE_GEOMETRY_VERTEX_SHADER_FILENAME "BlitzenEngine/VulkanShaders/OpaqueGeometryShader.vert.spv"
+    #define VULKAN_OPAQUE_GEOMETRY_COMPACT_VERTEX_SHADER_FILENAME "BlitzenEngine/VulkanShaders/OpaqueGeometryShaderCompact.vert.spv"
     #define VULKAN_OPAQUE_GEOMETRY_FRAGMENT_SHADER_FILENAME "BlitzenEngine/VulkanShaders/OpaqueGeometryShader.frag.spv"
+    #define VULKAN_DRAW_CULLING_COMPUTE_SHADER_FILENAME "BlitzenEngine/VulkanShaders/DrawCulling.comp.spv"
+    #define VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER_FILENAME "BlitzenEngine/VulkanShaders/DepthPyramid.comp.spv"
 
     class VulkanGraphicsPipelineBuilder
     {
@@ -61,6 +64,11 @@ namespace BlitzenRendering
         //When one of the specialized build functions are done, this is called to actually create the pipeline
         void Build();
 
+        //Creates a compute pipeline and its layout from a compiled compute shader, it does not touch the graphics state
+        void BuildComputePipeline(const char* filepath, VkPipeline* pPipeline, VkPipelineLayout* pLayout, 
+        VkPushConstantRange* pPushConstants, uint32_t pushConstantCount, 
+        VkDescriptorSetLayout* pDescriptorLayouts = nullptr, uint32_t descriptorLayoutCount = 0);
+
 
 
         VulkanGraphicsPipelineBuilder();
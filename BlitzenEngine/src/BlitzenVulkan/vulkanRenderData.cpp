@@ -1,63 +1,38 @@
 #include "vulkanRenderData.h"
 
+#include <algorithm>
+
 namespace BlitzenRendering
 {
-    void Node::UpdateTransform(const glm::mat4& parentTransform)
+    uint32_t SelectSurfaceLod(const GeoSurface& surface, const glm::mat4& meshMatrix, const DrawContext& drawContext)
     {
-        worldTransform = parentTransform * localTransform;
-        for(Node& child : m_children)
+        if(drawContext.lodErrorScale <= 0.f || surface.lodCount < 2)
         {
-            child.UpdateTransform(worldTransform);
+            return 0;
         }
-    }
 
-    void Node::AddToDrawContext(const glm::mat4& topMatrix, DrawContext& drawContext)
-    {
-        switch(type)
+        //The error grows with the largest scale of the mesh's matrix, the sphere's radius does as well
+        float scale = 0.f;
+        for(int axis = 0; axis < 3; ++axis)
         {
-            case NodeType::NT_Undefined:
-            {
-                for(Node& child : m_children)
-                {
-                    child.AddToDrawContext(topMatrix, drawContext);
-                }
-                break;
-            }
-            case NodeType::NT_MeshNode:
-            {
-                glm::mat4 nodeMatrix = topMatrix * worldTransform;
-
-                for(GeoSurface& surface : m_asset->geoSurfaces )
-                {
-                    drawContext.opaqueObjects.push_back(VulkanRenderObject());
-                    VulkanRenderObject& newObject = drawContext.opaqueObjects.back();
-                    newObject.firstIndex = surface.firstIndex;
-                    newObject.indexCount = surface.indexCount;
-                    newObject.pMaterial = surface.pMaterial;
-                    newObject.transform = nodeMatrix;
-                    newObject.vertexBufferOffset = surface.vertexBufferOffset;
-                }
-                break;
-
-            }
+            scale = std::max(scale, glm::length(glm::vec3(meshMatrix[axis])));
         }
-    }
-
-    void MeshNode::AddToDrawContext(const glm::mat4& topMatrix, DrawContext& drawContext)
-    {
-        glm::mat4 nodeMatrix = topMatrix * worldTransform;
-
-        for(GeoSurface& surface : m_asset->geoSurfaces )
+        glm::vec3 viewCenter = glm::vec3(drawContext.viewMatrix * meshMatrix * 
+        glm::vec4(glm::vec3(surface.boundingSphere), 1.f));
+        float distance = glm::length(viewCenter) - surface.boundingSphere.w * scale;
+        if(distance <= 0.f)
         {
-            drawContext.opaqueObjects.push_back(VulkanRenderObject());
-            VulkanRenderObject& newObject = drawContext.opaqueObjects.back();
-            newObject.firstIndex = surface.firstIndex;
-            newObject.indexCount = surface.indexCount;
-            newObject.pMaterial = surface.pMaterial;
-            newObject.transform = nodeMatrix;
-            newObject.vertexBufferOffset = surface.vertexBufferOffset;
+            return 0;
         }
 
-        Node::AddToDrawContext(topMatrix, drawContext);
+        float pixelsPerError = scale / distance * drawContext.lodErrorScale;
+        for(uint32_t lod = surface.lodCount - 1; lod > 0; --lod)
+        {
+            if(surface.lods[lod].error * pixelsPerError <= drawContext.lodPixelThreshold)
+            {
+                return lod;
+            }
+        }
+        return 0;
     }
 }
\ No newline at end of file
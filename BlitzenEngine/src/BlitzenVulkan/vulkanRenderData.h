@@ -12,6 +12,8 @@
 #include <string>
 #include <unordered_map>
 
+#include "Scene/transformHierarchy.h"
+
 namespace BlitzenRendering
 {
     //This is the way the data that will be passed to each vertex is structured
@@ -24,6 +26,33 @@ namespace BlitzenRendering
         glm::vec4 color;
     };
 
+    /*-------------------------------------------------------------------------------------------------------
+    The quantized version of VulkanVertex, 20 bytes instead of 48. The position is stored as 16 bit unorms 
+    relative to the bounds of its mesh, the normal is octahedral encoded in two 16 bit snorms, the uv map is
+    two half floats and the color is four 8 bit unorms. The vertex shader decodes every attribute, while the
+    position is brought back to the mesh's space by the mesh's dequantization matrix
+    ---------------------------------------------------------------------------------------------------------*/
+    struct CompactVulkanVertex
+    {
+        uint16_t position[3];
+        uint16_t padding;
+        uint32_t normal;
+        uint32_t uv;
+        uint32_t color;
+    };
+
+    //The vertex layouts that the mesh buffers can hold, every vertex in the vertex buffer uses the same one
+    enum class VulkanVertexFormat : uint8_t
+    {
+        VVF_Full,
+        VVF_Compact
+    };
+
+    inline size_t GetVertexStride(VulkanVertexFormat format)
+    {
+        return format == VulkanVertexFormat::VVF_Compact ? sizeof(CompactVulkanVertex) : sizeof(VulkanVertex);
+    }
+
     /*-------------------------------------------------------------------------------------------------------
     Images outside the ones that were already created on the swapchain, will be allocated with the allocator.
     The AllocatedImage struct will hold information about the image itself and its allocation
@@ -45,7 +74,7 @@ namespace BlitzenRendering
     struct VulkanAllocatedBuffer
     {
         VkBuffer buffer{VK_NULL_HANDLE};
-        VmaAllocation allocation;
+        VmaAllocation allocation{VK_NULL_HANDLE};
         VmaAllocationInfo allocationInfo{};
 
         void CleanupResources(const VkDevice& device, const VmaAllocator& allocator);
@@ -53,21 +82,43 @@ namespace BlitzenRendering
 
     /*-------------------------------------------------------------------------------------
     Vulkan will draw a mesh by passing its vertex and index buffer to the GPU as an SSBO 
-    and getting the address of the vertex buffer to give to a push constant
+    and getting the address of the vertex buffer to give to a push constant.
+    Every surface reads its indices from one of the two index buffers, depending on its index type.
+    The meshlet tables are SSBOs read through their addresses as well, they are empty if no meshlets were built
     ----------------------------------------------------------------------------------------*/
     struct VulkanGPUMeshBuffers
     {
         VulkanAllocatedBuffer vertexBuffer;
-        VulkanAllocatedBuffer indexBuffer; 
+        VulkanAllocatedBuffer indexBuffer32; 
+        VulkanAllocatedBuffer indexBuffer16; 
         VkDeviceAddress vertexBufferAddress; 
 
+        VulkanAllocatedBuffer meshletBuffer;
+        VulkanAllocatedBuffer meshletVertexBuffer;
+        VulkanAllocatedBuffer meshletTriangleBuffer;
+        VkDeviceAddress meshletBufferAddress{0};
+        VkDeviceAddress meshletVertexBufferAddress{0};
+        VkDeviceAddress meshletTriangleBufferAddress{0};
+
         void CleanupResources(const VkDevice& device, const VmaAllocator& allocator);
     };
 
-    //This will be updated for each dynamic object to holds its vertex buffer address and its matrix
-    struct GPUPushConstant
+    /*-------------------------------------------------------------------------------------------------------
+    What the shaders know about every render object, laid out for std430. The model matrix holds the mesh's
+    dequantization, the normal matrix does not since normals are decoded to the mesh's space. The normal
+    matrix is a mat3 in the shaders, where each of its columns takes the space of a vec4. The rest is read by
+    the draw culling shader: the object's surface in the surface table, the group of indirect draws that it
+    is drawn with, the largest scale of its mesh matrix and its bounding sphere in world space
+    ---------------------------------------------------------------------------------------------------------*/
+    struct GPUObjectData
     {
-        glm::mat4 worldMatrix;
+        glm::mat4 modelMatrix;
+        glm::vec4 normalMatrix[3];
+        uint32_t materialIndex;
+        uint32_t surfaceIndex;
+        uint32_t drawBucket;
+        float lodScale;
+        glm::vec4 boundingSphere;
     };
 
     //Used to store all the different pipelines used by the different materials of the engine objects
@@ -87,27 +138,109 @@ namespace BlitzenRendering
     //A specific instance of a material, holds the pipeline and descriptor sets to be bound
     struct MaterialInstance
     {
-        MaterialPipeline* pPipeline;
-        VkDescriptorSet descriptorSet;
-        MaterialPass pass;
+        MaterialPipeline* pPipeline{nullptr};
+        //Null until the material's resources are written to it, the draw does not bind it then
+        VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+        MaterialPass pass{MaterialPass::MP_opaqueMaterial};
+        //The material's place in the material table that the shaders index, the placeholder material is the first
+        uint32_t materialIndex{0};
     };
 
-    //Every surface will have its own draw call and uses these to draw indexed
-    struct GeoSurface
+    //The most levels of detail that a surface can have, the first one is always the full detail geometry
+    #define BLITZEN_MAX_MESH_LODS           8
+
+    //A range of the index buffer that draws a surface at one level of detail
+    struct VulkanMeshLod
     {
-        uint32_t indexCount;
         uint32_t firstIndex;
+        uint32_t indexCount;
+
+        //How far the simplified surface can be from the full detail one, in the units of the mesh's space
+        float error;
+    };
+
+    /*------------------------------------------------------------------------------------------------------
+    A cluster of up to 64 vertices and 124 triangles of a surface's full detail geometry, laid out for std430.
+    The meshlet's vertices are indices of the surface's vertices, so the surface's vertex buffer offset is 
+    added to them. Its triangles are three bytes each, indices of the meshlet's vertices, starting at a 
+    4 byte aligned offset. The bounds are in the mesh's space. Every triangle faces away from viewers for
+    whom dot(normalize(coneApex - viewer), coneAxis) >= coneCutoff, a cutoff of 1 never culls
+    --------------------------------------------------------------------------------------------------------*/
+    struct VulkanMeshlet
+    {
+        glm::vec4 boundingSphere;
+
+        glm::vec3 coneApex;
+        float coneCutoff;
+        glm::vec3 coneAxis;
+
+        uint32_t vertexOffset;
+        uint32_t triangleOffset;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+        uint32_t padding;
+    };
+
+    /*------------------------------------------------------------------------------------------------------
+    Every surface will have its own draw call and uses these to draw indexed. The indices are local to the
+    surface and the vertex buffer offset is given as the draw's vertex offset. Surfaces with up to 65536 
+    vertices use 16 bit indices, the lods point into the index buffer of the surface's index type.
+    Every level of detail indexes the same vertices, only the triangles change
+    --------------------------------------------------------------------------------------------------------*/
+    struct GeoSurface
+    {
+        VulkanMeshLod lods[BLITZEN_MAX_MESH_LODS];
+        uint32_t lodCount;
+
         uint32_t vertexBufferOffset;
+        VkIndexType indexType;
+
+        //The box and the sphere around the surface in the mesh's space, the sphere's center in xyz and radius in w
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec4 boundingSphere;
+
+        //The surface's range of the meshlet buffer, the meshlets cover the full detail level
+        uint32_t firstMeshlet;
+        uint32_t meshletCount;
+
+        /*-------------------------------------------------------------------------------------------------
+        The surface's ranges of its asset's occluder arrays, the indices are local to its occluder vertices. 
+        The error is how far the occluder may be outside of the surface, in the mesh's space. 
+        Surfaces without an occluder have no indices
+        --------------------------------------------------------------------------------------------------*/
+        uint32_t firstOccluderVertex;
+        uint32_t occluderVertexCount;
+        uint32_t firstOccluderIndex;
+        uint32_t occluderIndexCount;
+        float occluderError;
 
         MaterialInstance* pMaterial;
     };
 
+    //What the draw culling shader knows about a surface, laid out for std430
+    struct GPUSurfaceData
+    {
+        VulkanMeshLod lods[BLITZEN_MAX_MESH_LODS];
+        uint32_t lodCount;
+        uint32_t vertexBufferOffset;
+    };
+
     //Holds a loaded mesh asset and the mesh buffers need to draw it
     struct VulkanMeshAsset
     {
         std::vector<GeoSurface> geoSurfaces;
 
         std::string meshName;
+
+        //Takes quantized vertex positions back to the mesh's space, it is the identity for full vertices
+        glm::mat4 vertexDequantization{1.f};
+
+        //The occluders of every surface, kept on the CPU in the mesh's space for the software occlusion culling
+        std::vector<glm::vec3> occluderVertices;
+        std::vector<uint32_t> occluderIndices;
+        //The neighbor of every edge of the occluder triangles, as BuildOccluderAdjacency gives it for each surface's triangles
+        std::vector<uint32_t> occluderAdjacency;
     };
 
     //Holds scene data that does not change per object but is global
@@ -115,10 +248,57 @@ namespace BlitzenRendering
     {
         glm::mat4 viewMatrix;
         glm::mat4 projectionMatrix;
+        //The projection times the view, multiplied once on the CPU instead of for every vertex
+        glm::mat4 viewProjectionMatrix;
         glm::vec4 ambientColor;
         glm::vec4 sunlightColor;
         glm::vec4 sunlightDirection;
         VkDeviceAddress vertexBufferAddress;
+        //The frame's object data, in the order of the render objects
+        VkDeviceAddress objectBufferAddress;
+        //The object of every instance that the frame draws, the vertex shader reads the one at gl_InstanceIndex
+        VkDeviceAddress instanceBufferAddress;
+    };
+
+    /*-------------------------------------------------------------------------------------------------------
+    Everything that the draw culling shader reads and writes, given to it through its address. The draws of
+    every bucket are written to their own range of the command and instance buffers, the draw capacity long
+    and starting at the bucket times the capacity, while the bucket's draw count is an atomic counter.
+    The visibility buffer holds 1 for every render object that the last occlusion test found visible
+    ---------------------------------------------------------------------------------------------------------*/
+    struct GPUCullingData
+    {
+        glm::vec4 frustumPlanes[6];
+        glm::vec4 cameraPosition;
+
+        //The view and the projection's [0][0], [1][1], [2][2] and [3][2], the spheres are projected with them
+        glm::mat4 viewMatrix;
+        glm::vec4 projection;
+
+        VkDeviceAddress objectBufferAddress;
+        VkDeviceAddress surfaceBufferAddress;
+        VkDeviceAddress drawCommandBufferAddress;
+        VkDeviceAddress drawCountBufferAddress;
+        VkDeviceAddress instanceBufferAddress;
+        VkDeviceAddress visibilityBufferAddress;
+
+        uint32_t objectCount;
+        uint32_t drawCapacity;
+        float lodErrorScale;
+        float lodPixelThreshold;
+
+        float nearPlane;
+        float viewportWidth;
+        float viewportHeight;
+        uint32_t padding;
+    };
+
+    //The draw culling shader's push constants, the phase is one of DrawCullingPhase
+    struct GPUDrawCullingConstants
+    {
+        VkDeviceAddress cullingDataAddress;
+        uint32_t phase;
+        uint32_t padding;
     };
 
     struct MaterialConstants 
@@ -173,48 +353,22 @@ namespace BlitzenRendering
         //The model matrix of the render object, to be given to the push constant
         glm::mat4 transform{1.0f};
         uint32_t vertexBufferOffset;
+        VkIndexType indexType;
     };
 
+    //The view that the levels of detail of the render objects are picked for
     struct DrawContext
     {
-        std::vector<VulkanRenderObject> opaqueObjects;
+        /*--------------------------------------------------------------------------------------------------
+        Surfaces are drawn at their coarsest level of detail whose error covers less than the pixel 
+        threshold on the screen. The error scale is the viewport's height over twice the tangent of half 
+        the vertical field of view, when it is 0 every surface is drawn at full detail
+        ---------------------------------------------------------------------------------------------------*/
+        glm::mat4 viewMatrix{1.f};
+        float lodErrorScale = 0.f;
+        float lodPixelThreshold = 1.f;
     };
 
-    class IRenderable
-    {
-        virtual void AddToDrawContext(const glm::mat4& topMatrix, DrawContext& drawContext) = 0;
-    };
-
-    enum class NodeType : uint8_t
-    {
-        NT_MeshNode,
-        NT_Undefined
-    };
-
-    class Node : public IRenderable
-    {
-    public:
-        Node* pParentNode;
-        std::vector<Node> m_children;
-
-        glm::mat4 localTransform;
-        glm::mat4 worldTransform;
-
-        //Used to identify how the node should be added to the draw context
-        NodeType type = NodeType::NT_Undefined;
-
-        VulkanMeshAsset* m_asset;
-
-        void UpdateTransform(const glm::mat4& parentMatrix);
-
-        virtual void AddToDrawContext(const glm::mat4& topMatrix, DrawContext& drawContext) override;    
-    };
-
-    class MeshNode : public Node
-    {
-    public:
-        VulkanMeshAsset* m_asset;
-
-        void AddToDrawContext(const glm::mat4& topMatrix, DrawContext& drawContext) override;
-    };
-}
+    //Picks the coarsest level of detail of a surface whose error projects to fewer pixels than the threshold
+    uint32_t SelectSurfaceLod(const GeoSurface& surface, const glm::mat4& meshMatrix, const DrawContext& drawContext);
+}
\ No newline at end of file
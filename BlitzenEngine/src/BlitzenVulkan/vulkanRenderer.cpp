@@ -1,5 +1,8 @@
 #include "VulkanRenderer.h"
 
+#include <algorithm>
+#include <limits>
+
 //Includes the Vulkan Memory Allocator with function definitions
 #define VMA_IMPLEMENTATION
 #include "vma/vk_mem_alloc.h"
@@ -45,9 +48,9 @@ namespace BlitzenRendering
         VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | 
         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
 
-        //Allocate the depth stencil attachment
+        //Allocate the depth stencil attachment, the depth pyramid samples it
         AllocateImage(m_depthAttachmentImage, m_colorAttachmentImage.extent, VK_FORMAT_D32_SFLOAT, 
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
     }
 
     void VulkanRenderer::InitPlaceholderData()
@@ -58,26 +61,29 @@ namespace BlitzenRendering
         InitPlaceholderMaterial();
         m_placeholderMaterial.pPipeline = &(m_placeholderMaterialData.opaquePipeline);
 
-        for(size_t i = 0; i < m_assets.size(); ++i)
-        {
-            //Create a new mesh node
-            m_nodeTable[m_assets[i].meshName] = Node();
-            Node& newNode = m_nodeTable[m_assets[i].meshName];
-
-            //Assign the current mesh asset to the node
-            newNode.m_asset = &m_assets[i];
-            newNode.type = NodeType::NT_MeshNode;
+        InitDrawCulling();
 
-            newNode.localTransform = glm::mat4{ 1.f };
-		    newNode.worldTransform = glm::mat4{ 1.f };
-
-            for(GeoSurface& surface : newNode.m_asset->geoSurfaces)
+        for(VulkanMeshAsset& asset : m_assets)
+        {
+            for(GeoSurface& surface : asset.geoSurfaces)
             {
                 surface.pMaterial = &m_placeholderMaterial;
             }
-
-            
         }
+
+        //The nodes that the placeholder scene draws are found once, every frame reaches them through their handles
+        m_sphereNode = m_sceneHierarchy.FindNode(BlitzenEngine::MakeAssetId("Sphere"));
+        m_suzanneNode = m_sceneHierarchy.FindNode(BlitzenEngine::MakeAssetId("Suzanne"));
+
+        //The render objects are created once, a row of spheres and suzanne in the middle
+        m_sceneHierarchy.UpdateWorldTransforms();
+        for (int x = -3; x < 3; ++x) 
+        {
+		    glm::mat4 scale = glm::scale(glm::vec3{0.2});
+		    glm::mat4 translation =  glm::translate(glm::vec3{x, 1, -2.0f});
+            m_renderObjects.AddSceneNode(m_sceneHierarchy, m_sphereNode, m_assets, translation * scale);
+	    }
+        m_renderObjects.AddSceneNode(m_sceneHierarchy, m_suzanneNode, m_assets, glm::mat4(1.f));
     }
 
     vkb::Instance VulkanRenderer::BootstrapCreateInstance()
@@ -132,6 +138,24 @@ namespace BlitzenRendering
         //Saving the actual vulkan gpu handle 
         m_bootstrapObjects.chosenGPU = vkbPhysicalDevice.physical_device;
 
+        /*--------------------------------------------------------------------------------------------------
+        GPU driven draws read the number of draws of every bucket from a buffer that the draw culling shader
+        writes, and start every indirect draw from the instance where the vertex shader finds the object.
+        The features are only enabled if the gpu has both, otherwise the draws are recorded on the CPU
+        ---------------------------------------------------------------------------------------------------*/
+        VkPhysicalDeviceVulkan12Features indirectCountFeatures{};
+        indirectCountFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        indirectCountFeatures.drawIndirectCount = true;
+        VkPhysicalDeviceFeatures firstInstanceFeatures{};
+        firstInstanceFeatures.drawIndirectFirstInstance = true;
+        m_bGPUDrivenDrawsSupported = vkbPhysicalDevice.enable_extension_features_if_present(indirectCountFeatures) && 
+        vkbPhysicalDevice.enable_features_if_present(firstInstanceFeatures);
+        if(!m_bGPUDrivenDrawsSupported && m_bGPUDrivenDraws)
+        {
+            std::cout << "GPU driven draws need drawIndirectCount and drawIndirectFirstInstance, which the gpu does not support, falling back to CPU draws\n";
+            m_bGPUDrivenDraws = false;
+        }
+
         //Setting up the vkDevice based on the chosen gpu
         vkb::DeviceBuilder vkbDeviceBuilder{ vkbPhysicalDevice };
         vkb::Device vkbDevice = vkbDeviceBuilder.build().value();
@@ -230,6 +254,13 @@ namespace BlitzenRendering
 
             AllocateBuffer(m_frameToolList[i].sceneDataBuffer, sizeof(GPUSceneData), 
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+            AllocateBuffer(m_frameToolList[i].cullingDataBuffer, sizeof(GPUCullingData), 
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+            VkBufferDeviceAddressInfo cullingDataAddressInfo{};
+            cullingDataAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            cullingDataAddressInfo.buffer = m_frameToolList[i].cullingDataBuffer.buffer;
+            m_frameToolList[i].cullingDataBufferAddress = vkGetBufferDeviceAddress(m_device, &cullingDataAddressInfo);
         }
     }
 
@@ -290,6 +321,10 @@ namespace BlitzenRendering
         //Create the Vulkan SDK vkImageCreateInfo object with the parameters given
         VkImageCreateInfo imageToAllocateInfo{};
         VulkanSDKobjects::ImageCreateInfoInit(imageToAllocateInfo, imageExtent, imageFormat, imageUsage);
+        if(bMipmapped)
+        {
+            imageToAllocateInfo.mipLevels = BlitzenEngine::GetMipLevelCount(imageExtent.width, imageExtent.height);
+        }
 
         //Create the allocation info for vma 
         VmaAllocationCreateInfo imageAllocationInfo{};
@@ -317,7 +352,67 @@ namespace BlitzenRendering
     void VulkanRenderer::LoadMeshBuffers(std::vector<VulkanVertex>& vertices, 
         std::vector<uint32_t>& indices)
     {
-        VkDeviceSize vertexBufferSize = sizeof(VulkanVertex) * vertices.size();
+        LoadMeshBuffers(vertices.data(), VulkanVertexFormat::VVF_Full, vertices.size(), indices.data(), indices.size(), 
+        nullptr, 0);
+    }
+
+    void VulkanRenderer::LoadMeshBuffers(const void* pVertexData, VulkanVertexFormat vertexFormat, size_t vertexCount, 
+        const uint32_t* pIndices32, size_t index32Count, const uint16_t* pIndices16, size_t index16Count)
+    {
+        MeshBufferStaging staging;
+        BeginMeshBufferUpload(staging, vertexFormat, vertexCount, index32Count, index16Count);
+
+        //Put the vertices at the start of the memory address and the indices after them
+        memcpy(staging.pVertexData, pVertexData, GetVertexStride(vertexFormat) * vertexCount);
+        if(index32Count)
+        {
+            memcpy(staging.pIndices32, pIndices32, sizeof(uint32_t) * index32Count);
+        }
+        if(index16Count)
+        {
+            memcpy(staging.pIndices16, pIndices16, sizeof(uint16_t) * index16Count);
+        }
+
+        EndMeshBufferUpload(staging);
+    }
+
+    void VulkanRenderer::BeginMeshBufferUpload(MeshBufferStaging& staging, VulkanVertexFormat vertexFormat, 
+    size_t vertexCount, size_t index32Count, size_t index16Count)
+    {
+        staging.vertexFormat = vertexFormat;
+        staging.vertexCount = vertexCount;
+        staging.index32Count = index32Count;
+        staging.index16Count = index16Count;
+
+        VkDeviceSize vertexBufferSize = GetVertexStride(vertexFormat) * vertexCount;
+        VkDeviceSize index32BufferSize = sizeof(uint32_t) * index32Count;
+        VkDeviceSize index16BufferSize = sizeof(uint16_t) * index16Count;
+
+        /*-----------------------------------------------------------------------------------------------------
+        The staging buffer holds the vertices followed by the 32 bit and then the 16 bit indices. Cached memory 
+        is preferred since the loaders write to it in several passes and might read it back to write the 
+        cooked mesh file
+        ------------------------------------------------------------------------------------------------------*/
+        AllocateBuffer(staging.stagingBuffer, vertexBufferSize + index32BufferSize + index16BufferSize, 
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+
+        //Map a void pointer to the staging buffer's memory, so that the vertex data can be loaded
+        char* data = reinterpret_cast<char*>(staging.stagingBuffer.allocation->GetMappedData());
+        staging.pVertexData = data;
+        staging.pIndices32 = reinterpret_cast<uint32_t*>(data + vertexBufferSize);
+        staging.pIndices16 = reinterpret_cast<uint16_t*>(data + vertexBufferSize + index32BufferSize);
+    }
+
+    void VulkanRenderer::EndMeshBufferUpload(MeshBufferStaging& staging)
+    {
+        m_vertexFormat = staging.vertexFormat;
+        VkDeviceSize vertexBufferSize = GetVertexStride(staging.vertexFormat) * staging.vertexCount;
+        VkDeviceSize index32BufferSize = sizeof(uint32_t) * staging.index32Count;
+        VkDeviceSize index16BufferSize = sizeof(uint16_t) * staging.index16Count;
+
+        //Make the writes visible to the GPU in case the staging memory is not host coherent
+        vmaFlushAllocation(m_allocator, staging.stagingBuffer.allocation, 0, VK_WHOLE_SIZE);
+
         /*----------------------------------------------------------------------------------------
         Create the vertex buffer as an SSBO (that will accept a transfer from a staging buffer), 
         its memory will only be accessed by the GPU but shaders will have access
@@ -325,10 +420,17 @@ namespace BlitzenRendering
         AllocateBuffer(m_meshBuffers.vertexBuffer, vertexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
 
-        VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices.size();
-        //The index buffer will have the index buffer bit and will also accept a memory transfer
-        AllocateBuffer(m_meshBuffers.indexBuffer, indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | 
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        //The index buffers will have the index buffer bit and will also accept a memory transfer, empty ones are not created
+        if(index32BufferSize)
+        {
+            AllocateBuffer(m_meshBuffers.indexBuffer32, index32BufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | 
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        }
+        if(index16BufferSize)
+        {
+            AllocateBuffer(m_meshBuffers.indexBuffer16, index16BufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | 
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        }
 
         /*---------------------------------------------------------------------------------------------------
         Since the vertex buffer is only available in the gpu(shaders), the meshBuffers to save its address 
@@ -339,19 +441,6 @@ namespace BlitzenRendering
         vertexBufferAddressInfo.buffer = m_meshBuffers.vertexBuffer.buffer;
         m_meshBuffers.vertexBufferAddress = vkGetBufferDeviceAddress(m_device, &vertexBufferAddressInfo);
 
-        //The buffers have been created, now the data needs to be passed to their gpu memory using a staging buffer
-        VulkanAllocatedBuffer stagingBuffer;
-        AllocateBuffer(stagingBuffer, vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-        VMA_MEMORY_USAGE_CPU_ONLY);
-
-        //Map a void pointer to the staging buffer's memory, so that the vertex data can be loaded
-        void* data = stagingBuffer.allocation->GetMappedData();
-
-        //Put the vertices at the start of the memory address
-        memcpy(data, vertices.data(), vertexBufferSize);
-        //Place the indices after the vertices
-        memcpy(reinterpret_cast<char*>(data) + vertexBufferSize, indices.data(), indexBufferSize);
-
         //Start recording copy commands
         m_instantSubmit.StartRecording();
 
@@ -360,26 +449,92 @@ namespace BlitzenRendering
         vertexBufferCopyRegion.dstOffset = 0;
         vertexBufferCopyRegion.srcOffset = 0;
         vertexBufferCopyRegion.size = vertexBufferSize;
-        vkCmdCopyBuffer(m_instantSubmit.commandBuffer, stagingBuffer.buffer, m_meshBuffers.vertexBuffer.buffer, 1, 
+        vkCmdCopyBuffer(m_instantSubmit.commandBuffer, staging.stagingBuffer.buffer, m_meshBuffers.vertexBuffer.buffer, 1, 
         &vertexBufferCopyRegion);
 
-        //Copy the indices into the index buffer
-        VkBufferCopy indexBufferCopyRegion{0};
-        indexBufferCopyRegion.dstOffset = 0;
-        indexBufferCopyRegion.srcOffset = vertexBufferSize;
-        indexBufferCopyRegion.size = indexBufferSize;
-        vkCmdCopyBuffer(m_instantSubmit.commandBuffer, stagingBuffer.buffer, m_meshBuffers.indexBuffer.buffer, 1, 
-        &indexBufferCopyRegion);
+        //Copy the indices into the index buffers
+        if(index32BufferSize)
+        {
+            VkBufferCopy indexBufferCopyRegion{0};
+            indexBufferCopyRegion.dstOffset = 0;
+            indexBufferCopyRegion.srcOffset = vertexBufferSize;
+            indexBufferCopyRegion.size = index32BufferSize;
+            vkCmdCopyBuffer(m_instantSubmit.commandBuffer, staging.stagingBuffer.buffer, m_meshBuffers.indexBuffer32.buffer, 
+            1, &indexBufferCopyRegion);
+        }
+        if(index16BufferSize)
+        {
+            VkBufferCopy indexBufferCopyRegion{0};
+            indexBufferCopyRegion.dstOffset = 0;
+            indexBufferCopyRegion.srcOffset = vertexBufferSize + index32BufferSize;
+            indexBufferCopyRegion.size = index16BufferSize;
+            vkCmdCopyBuffer(m_instantSubmit.commandBuffer, staging.stagingBuffer.buffer, m_meshBuffers.indexBuffer16.buffer, 
+            1, &indexBufferCopyRegion);
+        }
 
         //Submit the commands
         m_instantSubmit.EndRecordingAndSubmit();
 
         //Free the memory of the staging buffer
+        vmaDestroyBuffer(m_allocator, staging.stagingBuffer.buffer, staging.stagingBuffer.allocation);
+        staging.pVertexData = nullptr;
+        staging.pIndices32 = nullptr;
+        staging.pIndices16 = nullptr;
+    }
+
+    void VulkanRenderer::LoadMeshletBuffers(const VulkanMeshlet* pMeshlets, size_t meshletCount, 
+    const uint32_t* pMeshletVertices, size_t meshletVertexCount, const uint8_t* pMeshletTriangles, 
+    size_t meshletTriangleSize)
+    {
+        if(meshletCount == 0)
+        {
+            return;
+        }
+
+        //The three tables go through a single staging buffer, one after the other
+        VkDeviceSize tableSizes[3] = {sizeof(VulkanMeshlet) * meshletCount, sizeof(uint32_t) * meshletVertexCount, 
+        meshletTriangleSize};
+        const void* pTables[3] = {pMeshlets, pMeshletVertices, pMeshletTriangles};
+        VulkanAllocatedBuffer* pBuffers[3] = {&m_meshBuffers.meshletBuffer, &m_meshBuffers.meshletVertexBuffer, 
+        &m_meshBuffers.meshletTriangleBuffer};
+        VkDeviceAddress* pAddresses[3] = {&m_meshBuffers.meshletBufferAddress, 
+        &m_meshBuffers.meshletVertexBufferAddress, &m_meshBuffers.meshletTriangleBufferAddress};
+
+        VulkanAllocatedBuffer stagingBuffer;
+        AllocateBuffer(stagingBuffer, tableSizes[0] + tableSizes[1] + tableSizes[2], VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+        VMA_MEMORY_USAGE_CPU_ONLY);
+        char* data = reinterpret_cast<char*>(stagingBuffer.allocation->GetMappedData());
+
+        m_instantSubmit.StartRecording();
+        VkDeviceSize stagingOffset = 0;
+        for(size_t table = 0; table < 3; ++table)
+        {
+            memcpy(data + stagingOffset, pTables[table], tableSizes[table]);
+
+            AllocateBuffer(*pBuffers[table], tableSizes[table], VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+            VkBufferDeviceAddressInfo addressInfo{};
+            addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            addressInfo.buffer = pBuffers[table]->buffer;
+            *pAddresses[table] = vkGetBufferDeviceAddress(m_device, &addressInfo);
+
+            VkBufferCopy copyRegion{0};
+            copyRegion.dstOffset = 0;
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.size = tableSizes[table];
+            vkCmdCopyBuffer(m_instantSubmit.commandBuffer, stagingBuffer.buffer, pBuffers[table]->buffer, 1, &copyRegion);
+
+            stagingOffset += tableSizes[table];
+        }
+        vmaFlushAllocation(m_allocator, stagingBuffer.allocation, 0, VK_WHOLE_SIZE);
+        m_instantSubmit.EndRecordingAndSubmit();
+
         vmaDestroyBuffer(m_allocator, stagingBuffer.buffer, stagingBuffer.allocation);
     }
 
     void VulkanRenderer::AllocateBuffer(VulkanAllocatedBuffer& bufferToAllocate, VkDeviceSize bufferSize, 
-    VkBufferUsageFlags bufferUsage, VmaMemoryUsage memoryUsage)
+    VkBufferUsageFlags bufferUsage, VmaMemoryUsage memoryUsage, VkMemoryPropertyFlags preferredMemoryFlags /* =0 */)
     {
         //Create the buffer's info
         VkBufferCreateInfo bufferInfo{};
@@ -388,6 +543,7 @@ namespace BlitzenRendering
         //Create the allocation info
         VmaAllocationCreateInfo bufferAllocationInfo{};
         bufferAllocationInfo.usage = memoryUsage;
+        bufferAllocationInfo.preferredFlags = preferredMemoryFlags;
         //All buffer allocations will create a pointer to the allocation, available in the allocation info
         bufferAllocationInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
@@ -396,6 +552,105 @@ namespace BlitzenRendering
         &(bufferToAllocate.allocation), &(bufferToAllocate.allocationInfo));
     }
 
+    bool VulkanRenderer::ReserveMappedBuffer(VulkanAllocatedBuffer& buffer, VkDeviceAddress& address, 
+    size_t& capacity, size_t count, size_t elementSize)
+    {
+        return ReserveBuffer(buffer, address, capacity, count, elementSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    }
+
+    bool VulkanRenderer::ReserveBuffer(VulkanAllocatedBuffer& buffer, VkDeviceAddress& address, size_t& capacity, 
+    size_t count, size_t elementSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage)
+    {
+        if(count <= capacity)
+        {
+            return false;
+        }
+
+        size_t newCapacity = capacity ? capacity : BLITZEN_INITIAL_INSTANCE_CAPACITY;
+        while(newCapacity < count)
+        {
+            newCapacity *= 2;
+        }
+
+        vmaDestroyBuffer(m_allocator, buffer.buffer, buffer.allocation);
+        AllocateBuffer(buffer, newCapacity * elementSize, usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 
+        memoryUsage);
+        capacity = newCapacity;
+
+        VkBufferDeviceAddressInfo bufferAddressInfo{};
+        bufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        bufferAddressInfo.buffer = buffer.buffer;
+        address = vkGetBufferDeviceAddress(m_device, &bufferAddressInfo);
+        return true;
+    }
+
+    void VulkanRenderer::UpdateSurfaceTable()
+    {
+        if(m_assetFirstSurfaces.size() == m_assets.size() + 1)
+        {
+            return;
+        }
+
+        //Assets are only added while loading, the frames that might still read the old table are waited on
+        vkDeviceWaitIdle(m_device);
+        BuildGPUSurfaceTable(m_assets, m_surfaces, m_assetFirstSurfaces);
+        ReserveMappedBuffer(m_surfaceBuffer, m_surfaceBufferAddress, m_surfaceCapacity, m_surfaces.size(), 
+        sizeof(GPUSurfaceData));
+        if(!m_surfaces.empty())
+        {
+            memcpy(m_surfaceBuffer.allocation->GetMappedData(), m_surfaces.data(), 
+            m_surfaces.size() * sizeof(GPUSurfaceData));
+            vmaFlushAllocation(m_allocator, m_surfaceBuffer.allocation, 0, m_surfaces.size() * sizeof(GPUSurfaceData));
+        }
+    }
+
+    void VulkanRenderer::WriteObjectData(GPUObjectData* pObjectData, uint32_t object)
+    {
+        const VulkanRenderObject& renderObject = m_renderObjects.GetRenderObjects()[object];
+        const BlitzenEngine::BoundingSpheres& spheres = m_renderObjects.GetObjectSpheres();
+        glm::vec4 worldSphere(spheres.centerX[object], spheres.centerY[object], spheres.centerZ[object], 
+        spheres.radius[object]);
+        uint32_t surfaceIndex = m_assetFirstSurfaces[m_renderObjects.GetObjectAssets()[object]] + 
+        m_renderObjects.GetObjectSurfaces()[object];
+        WriteGPUObjectData(pObjectData[object], renderObject, m_renderObjects.GetObjectMeshMatrices()[object], 
+        worldSphere, surfaceIndex, m_drawBuckets.GetBucket(renderObject.pMaterial, renderObject.indexType));
+    }
+
+    void VulkanRenderer::UpdateObjectBuffer(FrameTools& frame)
+    {
+        const std::vector<VulkanRenderObject>& renderObjects = m_renderObjects.GetRenderObjects();
+
+        //A new buffer holds none of the objects, every one of them is written to it
+        bool bNewBuffer = ReserveMappedBuffer(frame.objectBuffer, frame.objectBufferAddress, frame.objectCapacity, 
+        renderObjects.size(), sizeof(GPUObjectData));
+        GPUObjectData* pObjectData = reinterpret_cast<GPUObjectData*>(frame.objectBuffer.allocation->GetMappedData());
+        if(bNewBuffer)
+        {
+            for(uint32_t i = 0; i < renderObjects.size(); ++i)
+            {
+                WriteObjectData(pObjectData, i);
+            }
+        }
+        else
+        {
+            //Objects that were removed after they changed can be past the end of the array
+            for(uint32_t object : frame.pendingObjects)
+            {
+                if(object < renderObjects.size())
+                {
+                    WriteObjectData(pObjectData, object);
+                }
+            }
+        }
+
+        if(bNewBuffer || !frame.pendingObjects.empty())
+        {
+            vmaFlushAllocation(m_allocator, frame.objectBuffer.allocation, 0, renderObjects.size() * sizeof(GPUObjectData));
+        }
+        frame.pendingObjects.clear();
+    }
+
 
 
 
@@ -404,10 +659,11 @@ namespace BlitzenRendering
         m_graphicsPipelineBuilder.StartSettingUp(&(m_placeholderMaterialData.opaquePipeline.graphicsPipeline), 
         &(m_placeholderMaterialData.opaquePipeline.pipelineLayout), &m_device);
 
-        //Set up the vertex shader stage
+        //Set up the vertex shader stage, the shader has to decode the vertex format of the mesh buffers
         std::vector<char> vertShaderCode;
         VkShaderModule vertShaderModule;
-        m_graphicsPipelineBuilder.LoadShader(VULKAN_OPAQUE_GEOMETRY_VERTEX_SHADER_FILENAME, 
+        m_graphicsPipelineBuilder.LoadShader(m_vertexFormat == VulkanVertexFormat::VVF_Compact ? 
+        VULKAN_OPAQUE_GEOMETRY_COMPACT_VERTEX_SHADER_FILENAME : VULKAN_OPAQUE_GEOMETRY_VERTEX_SHADER_FILENAME, 
         vertShaderCode, vertShaderModule, 0, VK_SHADER_STAGE_VERTEX_BIT);
 
         //Set up the fragment shader stage
@@ -447,12 +703,6 @@ namespace BlitzenRendering
         m_graphicsPipelineBuilder.SetupRenderingInfo(&(m_colorAttachmentImage.format), 1, 
         m_depthAttachmentImage.format, VK_FORMAT_UNDEFINED);
 
-        //Setup push constants for the pipeline layout
-        VkPushConstantRange pushConstants{};
-        pushConstants.offset = 0;
-        pushConstants.size = sizeof(GPUPushConstant);
-        pushConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
         //Set binding for material constants uniform buffer
         VkDescriptorSetLayoutBinding uniformBufferBinding{};
         uniformBufferBinding.binding = 0;
@@ -501,12 +751,138 @@ namespace BlitzenRendering
             m_globalSceneDataDescriptorSetLayout, m_placeholderMaterialData.materialLayout
         };
 
-        m_graphicsPipelineBuilder.SetupPipelineLayout(&pushConstants, 1, descriptorSetLayout.data(), 2);
+        //The vertex shader reads the instance matrices through the scene data, so the layout needs no push constants
+        m_graphicsPipelineBuilder.SetupPipelineLayout(nullptr, 0, descriptorSetLayout.data(), 2);
 
         m_graphicsPipelineBuilder.Build();
 
         vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
-        vkDestroyShaderModule(m_device, fragShaderModule, nullptr);  
+        vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+    }
+
+    void VulkanRenderer::SetGPUDrivenDraws(bool bGPUDrivenDraws)
+    {
+        if(bGPUDrivenDraws && !m_bGPUDrivenDrawsSupported)
+        {
+            std::cout << "GPU driven draws are not supported by the gpu, the draws stay on the CPU\n";
+            return;
+        }
+        m_bGPUDrivenDraws = bGPUDrivenDraws;
+    }
+
+    void VulkanRenderer::SetOcclusionCulling(bool bOcclusionCulling)
+    {
+        //The CPU reference that the draws are validated against cannot cull the second phase's draws
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            if(bOcclusionCulling)
+            {
+                std::cout << "Occlusion culling stays off while GPU culling is validated\n";
+            }
+        #else
+            m_bOcclusionCulling = bOcclusionCulling;
+        #endif
+    }
+
+    void VulkanRenderer::InitDrawCulling()
+    {
+        m_staticDescriptorAllocator.Init(m_device);
+        InitDepthPyramid();
+
+        //The shader finds everything else through the culling data's address, only the depth pyramid is a descriptor
+        VkDescriptorSetLayoutBinding depthPyramidBinding{};
+        VulkanSDKobjects::DescriptorSetLayoutBindingInit(depthPyramidBinding, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 
+        VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorSetLayoutCreateInfo drawCullingSetLayoutInfo{};
+        VulkanSDKobjects::DescriptorSetLayoutCreateInfoInit(drawCullingSetLayoutInfo, 1, &depthPyramidBinding);
+        vkCreateDescriptorSetLayout(m_device, &drawCullingSetLayoutInfo, nullptr, &m_drawCullingSetLayout);
+
+        VkPushConstantRange drawCullingConstants{};
+        VulkanSDKobjects::PushConstantRangeInit(drawCullingConstants, sizeof(GPUDrawCullingConstants), 
+        VK_SHADER_STAGE_COMPUTE_BIT);
+        m_graphicsPipelineBuilder.BuildComputePipeline(VULKAN_DRAW_CULLING_COMPUTE_SHADER_FILENAME, 
+        &m_drawCullingPipeline, &m_drawCullingPipelineLayout, &drawCullingConstants, 1, &m_drawCullingSetLayout, 1);
+
+        m_staticDescriptorAllocator.AllocateDescriptorSet(m_device, m_drawCullingSet, m_drawCullingSetLayout);
+        m_descriptorWriter.Clear();
+        m_descriptorWriter.WriteImage(0, m_depthPyramid.imageView, m_depthPyramidSampler, VK_IMAGE_LAYOUT_GENERAL, 
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        m_descriptorWriter.UpdateSet(m_device, m_drawCullingSet);
+        m_descriptorWriter.Clear();
+    }
+
+    void VulkanRenderer::InitDepthPyramid()
+    {
+        //The first level is half the depth attachment's size rounded up to a power of two, the rest are its mip chain
+        uint32_t pyramidWidth = 0;
+        uint32_t pyramidHeight = 0;
+        BlitzenEngine::GetDepthPyramidSize(m_depthAttachmentImage.extent.width, m_depthAttachmentImage.extent.height, 
+        pyramidWidth, pyramidHeight);
+        AllocateImage(m_depthPyramid, {pyramidWidth, pyramidHeight, 1}, VK_FORMAT_R32_SFLOAT, 
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, true);
+        uint32_t levelCount = BlitzenEngine::GetMipLevelCount(pyramidWidth, pyramidHeight);
+
+        //The pyramid stays in the general layout, it is written as a storage image and sampled
+        m_instantSubmit.StartRecording();
+        ChangeImageLayout(m_instantSubmit.commandBuffer, m_depthPyramid.image, VK_IMAGE_LAYOUT_UNDEFINED, 
+        VK_IMAGE_LAYOUT_GENERAL);
+        m_instantSubmit.EndRecordingAndSubmit();
+
+        m_depthPyramidLevelViews.resize(levelCount);
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+            VkImageViewCreateInfo levelViewInfo{};
+            VulkanSDKobjects::ImageViewCreateInfoInit(levelViewInfo, m_depthPyramid.image, VK_IMAGE_ASPECT_COLOR_BIT, 
+            m_depthPyramid.format);
+            levelViewInfo.subresourceRange.baseMipLevel = level;
+            levelViewInfo.subresourceRange.levelCount = 1;
+            vkCreateImageView(m_device, &levelViewInfo, nullptr, &m_depthPyramidLevelViews[level]);
+        }
+
+        //Texels are read one at a time, the shaders clamp the coordinates themselves
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        vkCreateSampler(m_device, &samplerInfo, nullptr, &m_depthPyramidSampler);
+
+        std::array<VkDescriptorSetLayoutBinding, 2> depthPyramidBindings{};
+        VulkanSDKobjects::DescriptorSetLayoutBindingInit(depthPyramidBindings[0], 0, 
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+        VulkanSDKobjects::DescriptorSetLayoutBindingInit(depthPyramidBindings[1], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 
+        VK_SHADER_STAGE_COMPUTE_BIT);
+        VkDescriptorSetLayoutCreateInfo depthPyramidSetLayoutInfo{};
+        VulkanSDKobjects::DescriptorSetLayoutCreateInfoInit(depthPyramidSetLayoutInfo, 2, depthPyramidBindings.data());
+        vkCreateDescriptorSetLayout(m_device, &depthPyramidSetLayoutInfo, nullptr, &m_depthPyramidSetLayout);
+
+        m_graphicsPipelineBuilder.BuildComputePipeline(VULKAN_DEPTH_PYRAMID_COMPUTE_SHADER_FILENAME, 
+        &m_depthPyramidPipeline, &m_depthPyramidPipelineLayout, nullptr, 0, &m_depthPyramidSetLayout, 1);
+
+        //The first level reads the depth attachment while it is in the shader read layout, every other the level before
+        m_depthPyramidSets.resize(levelCount);
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+            m_staticDescriptorAllocator.AllocateDescriptorSet(m_device, m_depthPyramidSets[level], m_depthPyramidSetLayout);
+            m_descriptorWriter.Clear();
+            if(level == 0)
+            {
+                m_descriptorWriter.WriteImage(0, m_depthAttachmentImage.imageView, m_depthPyramidSampler, 
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+            }
+            else
+            {
+                m_descriptorWriter.WriteImage(0, m_depthPyramidLevelViews[level - 1], m_depthPyramidSampler, 
+                VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+            }
+            m_descriptorWriter.WriteImage(1, m_depthPyramidLevelViews[level], m_depthPyramidSampler, 
+            VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            m_descriptorWriter.UpdateSet(m_device, m_depthPyramidSets[level]);
+        }
+        m_descriptorWriter.Clear();
     }
 
     void VulkanRenderer::WriteMaterial(MaterialInstance& instance, VkDevice device, MaterialPass pass, 
@@ -757,27 +1133,103 @@ namespace BlitzenRendering
 
     void VulkanRenderer::UpdateScene()
     {
-        m_mainDrawContext.opaqueObjects.clear();
-
-        for (int x = -3; x < 3; ++x) 
-        {
-		    glm::mat4 scale = glm::scale(glm::vec3{0.2});
-		    glm::mat4 translation =  glm::translate(glm::vec3{x, 1, -2.0f});
-		    m_nodeTable["Sphere"].AddToDrawContext(translation * scale, m_mainDrawContext);
-	    }
-
-        m_nodeTable["Suzanne"].AddToDrawContext(glm::mat4(1.f), m_mainDrawContext);
-
         //Setup the view matrix
         m_globalSceneData.viewMatrix = glm::translate(glm::vec3{ 0,0,-5 });
 	    
-        //Setup the projection matrix
-	    m_globalSceneData.projectionMatrix = glm::perspective(glm::radians(70.f), (float)m_pWindowData->windowWidth / 
-        (float)m_pWindowData->windowHeight, 10000.f, 0.1f);
+        //Setup the projection matrix, the planes are swapped for reversed depth, which is 1 at the near plane
+        float verticalFov = glm::radians(70.f);
+        float nearPlane = 0.1f;
+        float farPlane = 10000.f;
+	    m_globalSceneData.projectionMatrix = glm::perspective(verticalFov, (float)m_pWindowData->windowWidth / 
+        (float)m_pWindowData->windowHeight, farPlane, nearPlane);
 
 	    //Invert the projection matrix so that it matches glm and objects are not drawn upside down
 	    m_globalSceneData.projectionMatrix[1][1] *= -1;
 
+        //Vertices only need a single matrix to reach clip space from world space
+        m_globalSceneData.viewProjectionMatrix = m_globalSceneData.projectionMatrix * m_globalSceneData.viewMatrix;
+
+        //Only the subtrees of nodes that moved since the last frame are recomputed, their render objects follow them
+        m_sceneHierarchy.UpdateWorldTransforms();
+        m_renderObjects.UpdateSceneInstances(m_sceneHierarchy);
+
+        //The hierarchy over the render objects' spheres follows the ones that changed, in either mode, since picking uses it
+        const BlitzenEngine::BoundingSpheres& objectSpheres = m_renderObjects.GetObjectSpheres();
+        if(m_objectHierarchy.Update(objectSpheres, m_renderObjects.GetChangedObjects()))
+        {
+            std::cout << "Object hierarchy: built over " << m_objectHierarchy.GetObjectCount() << " objects, " << 
+            m_objectHierarchy.GetNodes().size() << " nodes\n";
+        }
+
+        //The object data of render objects points to their surface in the table, which has to cover every asset
+        UpdateSurfaceTable();
+
+        //Objects whose bounding sphere is outside of the view frustum are not given a level of detail or drawn
+        glm::vec4 frustumPlanes[BLITZEN_FRUSTUM_PLANE_COUNT];
+        BlitzenEngine::ExtractFrustumPlanes(m_globalSceneData.viewProjectionMatrix, frustumPlanes);
+
+        //The render objects pick their level of detail with the same view
+        m_mainDrawContext.viewMatrix = m_globalSceneData.viewMatrix;
+        m_mainDrawContext.lodErrorScale = (float)m_pWindowData->windowHeight / (2.f * glm::tan(verticalFov * 0.5f));
+
+        if(m_bGPUDrivenDraws)
+        {
+            //The draw culling shader does the culling and picks the levels of detail, it only needs the view
+            for(int plane = 0; plane < BLITZEN_FRUSTUM_PLANE_COUNT; ++plane)
+            {
+                m_cullingData.frustumPlanes[plane] = frustumPlanes[plane];
+            }
+            m_cullingData.cameraPosition = glm::inverse(m_globalSceneData.viewMatrix)[3];
+            m_cullingData.viewMatrix = m_globalSceneData.viewMatrix;
+            m_cullingData.projection = glm::vec4(m_globalSceneData.projectionMatrix[0][0], 
+            m_globalSceneData.projectionMatrix[1][1], m_globalSceneData.projectionMatrix[2][2], 
+            m_globalSceneData.projectionMatrix[3][2]);
+            m_cullingData.nearPlane = nearPlane;
+            m_cullingData.lodErrorScale = m_mainDrawContext.lodErrorScale;
+            m_cullingData.lodPixelThreshold = m_mainDrawContext.lodPixelThreshold;
+        }
+        else
+        {
+            m_objectVisibility.resize(objectSpheres.GetCount());
+            m_cullingStatistics.testedCount = static_cast<uint32_t>(objectSpheres.GetCount());
+            m_cullingStatistics.visibleCount = m_objectHierarchy.CullFrustum(frustumPlanes, objectSpheres, 
+            m_objectVisibility.data());
+            m_cullingStatistics.culledCount = m_cullingStatistics.testedCount - m_cullingStatistics.visibleCount;
+            m_cullingStatistics.occludedCount = 0;
+            if(m_bSoftwareOcclusionCulling)
+            {
+                m_cullingStatistics.occludedCount = CullOccludedObjects(glm::inverse(m_globalSceneData.viewMatrix)[3]);
+                m_cullingStatistics.visibleCount -= m_cullingStatistics.occludedCount;
+            }
+            if(m_cullingStatistics != m_previousCullingStatistics)
+            {
+                std::cout << "Frustum culling: " << m_cullingStatistics.visibleCount + m_cullingStatistics.occludedCount << 
+                " of " << m_cullingStatistics.testedCount << " objects visible, " << m_cullingStatistics.culledCount << 
+                " culled\n";
+                if(m_bSoftwareOcclusionCulling)
+                {
+                    std::cout << "Occlusion culling: " << m_cullingStatistics.occludedCount << " of " << 
+                    m_cullingStatistics.visibleCount + m_cullingStatistics.occludedCount << " objects occluded by " << 
+                    m_softwareOcclusion.GetOccluderCount() << " occluders, " << m_softwareOcclusion.GetTriangleCount() << 
+                    " triangles drawn\n";
+                }
+                m_previousCullingStatistics = m_cullingStatistics;
+            }
+
+            m_renderObjects.SelectLods(m_assets, m_mainDrawContext, m_objectVisibility.data());
+
+            //Objects that share state are drawn together, so that the draw does not bind it again
+            m_drawSorter.SortRenderObjects(m_renderObjects, m_assets, m_mainDrawContext, m_objectVisibility.data());
+        }
+
+        //Every frame's object buffer is behind on the changed objects until that frame draws again
+        const std::vector<uint32_t>& changedObjects = m_renderObjects.GetChangedObjects();
+        for(FrameTools& frame : m_frameToolList)
+        {
+            frame.pendingObjects.insert(frame.pendingObjects.end(), changedObjects.begin(), changedObjects.end());
+        }
+        m_renderObjects.ClearChangedObjects();
+
 	    //Default lighting parameters
 	    m_globalSceneData.ambientColor = glm::vec4(.1f);
 	    m_globalSceneData.sunlightColor = glm::vec4(1.f);
@@ -786,6 +1238,112 @@ namespace BlitzenRendering
         m_globalSceneData.vertexBufferAddress = m_meshBuffers.vertexBufferAddress;
     }
 
+    uint32_t VulkanRenderer::CullOccludedObjects(const glm::vec3& cameraPosition)
+    {
+        const std::vector<glm::mat4>& meshMatrices = m_renderObjects.GetObjectMeshMatrices();
+        const std::vector<uint32_t>& objectAssets = m_renderObjects.GetObjectAssets();
+        const std::vector<uint32_t>& objectSurfaces = m_renderObjects.GetObjectSurfaces();
+        const BlitzenEngine::BoundingSpheres& objectSpheres = m_renderObjects.GetObjectSpheres();
+
+        /*------------------------------------------------------------------------------------------------
+        The size of an object on the screen is its sphere's radius in pixels of the software depth buffer.
+        Objects that reach the camera are as big as they can get
+        -------------------------------------------------------------------------------------------------*/
+        float pixelsPerRadius = static_cast<float>(m_softwareOcclusion.GetHeight()) * 0.5f * 
+        glm::abs(m_globalSceneData.projectionMatrix[1][1]);
+        m_occluderCandidates.clear();
+        for(uint32_t object = 0; object < static_cast<uint32_t>(m_objectVisibility.size()); ++object)
+        {
+            const GeoSurface& surface = m_assets[objectAssets[object]].geoSurfaces[objectSurfaces[object]];
+            if(!m_objectVisibility[object] || !surface.occluderIndexCount)
+            {
+                continue;
+            }
+
+            glm::vec3 center(objectSpheres.centerX[object], objectSpheres.centerY[object], objectSpheres.centerZ[object]);
+            float radius = objectSpheres.radius[object];
+            float distance = glm::length(center - cameraPosition);
+            float size = distance > radius ? radius / distance * pixelsPerRadius : std::numeric_limits<float>::max();
+            if(size >= BLITZEN_SOFTWARE_OCCLUDER_MIN_PIXELS)
+            {
+                m_occluderCandidates.push_back({size, object});
+            }
+        }
+
+        //Biggest first, objects of the same size stay in order so that the same occluders are picked every frame
+        std::sort(m_occluderCandidates.begin(), m_occluderCandidates.end(), 
+        [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+        {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+
+        m_softwareOcclusion.BeginFrame(m_globalSceneData.viewMatrix, m_globalSceneData.projectionMatrix);
+        size_t triangleCount = 0;
+        for(const std::pair<float, uint32_t>& candidate : m_occluderCandidates)
+        {
+            uint32_t object = candidate.second;
+            const VulkanMeshAsset& asset = m_assets[objectAssets[object]];
+            const GeoSurface& surface = asset.geoSurfaces[objectSurfaces[object]];
+            if(triangleCount + surface.occluderIndexCount / 3 > BLITZEN_SOFTWARE_OCCLUSION_TRIANGLE_BUDGET)
+            {
+                continue;
+            }
+            triangleCount += surface.occluderIndexCount / 3;
+
+            //The error is in the mesh's units, the mesh matrix can stretch it by as much as its biggest scale
+            const glm::mat4& meshMatrix = meshMatrices[object];
+            float maxScale = glm::max(glm::length(glm::vec3(meshMatrix[0])), 
+            glm::max(glm::length(glm::vec3(meshMatrix[1])), glm::length(glm::vec3(meshMatrix[2]))));
+            m_softwareOcclusion.AddOccluder(meshMatrix, asset.occluderVertices.data() + surface.firstOccluderVertex, 
+            surface.occluderVertexCount, asset.occluderIndices.data() + surface.firstOccluderIndex, 
+            asset.occluderAdjacency.data() + surface.firstOccluderIndex, surface.occluderIndexCount, 
+            surface.occluderError * maxScale);
+        }
+        m_softwareOcclusion.Rasterize();
+
+        //Every visible object is tested, an occluder's own bounds are never behind its depth
+        m_occlusionBoxes.clear();
+        m_occlusionBoxObjects.clear();
+        for(uint32_t object = 0; object < static_cast<uint32_t>(m_objectVisibility.size()); ++object)
+        {
+            if(m_objectVisibility[object])
+            {
+                const GeoSurface& surface = m_assets[objectAssets[object]].geoSurfaces[objectSurfaces[object]];
+                m_occlusionBoxes.push_back({meshMatrices[object], surface.boundsMin, surface.boundsMax});
+                m_occlusionBoxObjects.push_back(object);
+            }
+        }
+        m_occlusionBoxVisibility.resize(m_occlusionBoxes.size());
+        uint32_t occludedCount = m_softwareOcclusion.CullBoxes(m_occlusionBoxes.data(), m_occlusionBoxes.size(), 
+        m_occlusionBoxVisibility.data());
+        for(size_t box = 0; box < m_occlusionBoxes.size(); ++box)
+        {
+            m_objectVisibility[m_occlusionBoxObjects[box]] = m_occlusionBoxVisibility[box];
+        }
+
+        if(!m_softwareOcclusionDumpPath.empty())
+        {
+            if(m_softwareOcclusion.WriteDebugImage(m_softwareOcclusionDumpPath))
+            {
+                std::cout << "Software occlusion: depth buffer written to " << m_softwareOcclusionDumpPath << '\n';
+            }
+            else
+            {
+                std::cout << "Software occlusion: " << m_softwareOcclusionDumpPath << " -> Could not write image\n";
+            }
+            m_softwareOcclusionDumpPath.clear();
+            m_softwareOcclusion.SetRecordTests(false);
+        }
+
+        return occludedCount;
+    }
+
+    void VulkanRenderer::RequestSoftwareOcclusionDump(const std::filesystem::path& path)
+    {
+        m_softwareOcclusionDumpPath = path;
+        m_softwareOcclusion.SetRecordTests(true);
+    }
+
     void VulkanRenderer::StartRecordingFrameCommands(const VkCommandBuffer& commandBuffer, 
     uint32_t swapchainImageIndex)
     {
@@ -852,9 +1410,43 @@ namespace BlitzenRendering
 
     void VulkanRenderer::DrawGeometry(const VkCommandBuffer& commandBuffer)
     {
+        /*-------------------------------------------------------------------------------------------------
+        The frame's fence was waited on, so the GPU is done reading the frame's buffers from its last draw.
+        The object buffer only takes the objects that changed since then, while the instance buffer gets the
+        object of every instance in draw order, so the objects of a run of the same surface are consecutive
+        instances and the draw's first instance is the run's place in the draw order
+        --------------------------------------------------------------------------------------------------*/
+        FrameTools& frame = m_frameToolList[currentFrame];
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            ValidateDrawCulling(frame);
+        #endif
+        UpdateObjectBuffer(frame);
+
+        //GPU driven draws get their instances from the draw culling shader, which is dispatched before each rendering
+        const std::vector<VulkanRenderObject>& renderObjects = m_renderObjects.GetRenderObjects();
+        const std::vector<uint32_t>& drawOrder = m_drawSorter.GetDrawOrder();
+        if(m_bGPUDrivenDraws)
+        {
+            PrepareDrawCulling(commandBuffer, frame);
+        }
+        else
+        {
+            ReserveMappedBuffer(frame.instanceBuffer, frame.instanceBufferAddress, frame.instanceCapacity, 
+            drawOrder.size(), sizeof(uint32_t));
+            if(!drawOrder.empty())
+            {
+                memcpy(frame.instanceBuffer.allocation->GetMappedData(), drawOrder.data(), 
+                drawOrder.size() * sizeof(uint32_t));
+                vmaFlushAllocation(m_allocator, frame.instanceBuffer.allocation, 0, drawOrder.size() * sizeof(uint32_t));
+            }
+        }
+
         GPUSceneData* pSceneData = reinterpret_cast<GPUSceneData*>(m_frameToolList[currentFrame].sceneDataBuffer.
         allocation->GetMappedData());
         *pSceneData = m_globalSceneData;
+        pSceneData->objectBufferAddress = frame.objectBufferAddress;
+        pSceneData->instanceBufferAddress = m_bGPUDrivenDraws ? frame.culledInstanceBufferAddress : 
+        frame.instanceBufferAddress;
 
         VkDescriptorSet sceneDataDescriptorSet;
         m_frameToolList[currentFrame].descriptorAllocator.AllocateDescriptorSet(m_device, sceneDataDescriptorSet, 
@@ -877,23 +1469,11 @@ namespace BlitzenRendering
 
 
 
-        //Specify rendering attachments and start rendering
-        VkRenderingAttachmentInfo colorAttachmentRenderingInfo{};
-        VulkanSDKobjects::ColorRenderingAttachmentInfoInit(colorAttachmentRenderingInfo, 
-        m_colorAttachmentImage.imageView, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-        VkRenderingAttachmentInfo depthAttachmentInfo{};
-        VulkanSDKobjects::DepthRenderingAttachmentInfoInit(depthAttachmentInfo, m_depthAttachmentImage.imageView, 
-        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
-        VkRenderingInfo renderingInfo{};
-        VulkanSDKobjects::RenderingInfoInit(renderingInfo, &colorAttachmentRenderingInfo, m_drawExtent, &depthAttachmentInfo, 
-        nullptr);
-        vkCmdBeginRendering(commandBuffer, &renderingInfo);
-
-        //Bind the pipeline that will be used for this surface
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_placeholderMaterial.pPipeline->graphicsPipeline);
+        //The scene data set is shared by every pipeline's layout, so it stays bound through every pipeline and rendering
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
         m_placeholderMaterialData.opaquePipeline.pipelineLayout, 0, 1, &sceneDataDescriptorSet, 0, nullptr);
-        vkCmdBindIndexBuffer(commandBuffer, m_meshBuffers.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        m_drawStatistics = DrawStatistics();
+        ++m_drawStatistics.descriptorSetBinds;
 
         //Since this pipeline has a dynamic viewport and scissor, it has to be set at draw time
         VkViewport viewport = {};
@@ -912,23 +1492,406 @@ namespace BlitzenRendering
         scissor.extent.height = m_drawExtent.height;
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        for(size_t i = 0; i < m_mainDrawContext.opaqueObjects.size(); ++i)
+        if(m_bGPUDrivenDraws && m_bOcclusionCulling)
         {
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-            m_mainDrawContext.opaqueObjects[i].pMaterial->pPipeline->graphicsPipeline);
-
-            GPUPushConstant pushConstants;
-            pushConstants.worldMatrix = m_mainDrawContext.opaqueObjects[i].transform;
-            vkCmdPushConstants(commandBuffer, m_mainDrawContext.opaqueObjects[i].pMaterial->pPipeline->pipelineLayout, 
-            VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GPUPushConstant), &pushConstants);
+            /*-------------------------------------------------------------------------------------------------
+            The early phase draws what was visible last frame and the depth pyramid is built from its depth.
+            The late phase then draws, on top of that depth, the objects that the pyramid does not hide and 
+            the early phase did not draw
+            --------------------------------------------------------------------------------------------------*/
+            RecordDrawCulling(commandBuffer, frame, DrawCullingPhase::DCP_Early);
+            BeginGeometryRendering(commandBuffer, true);
+            DrawIndirect(commandBuffer, frame);
+            vkCmdEndRendering(commandBuffer);
+
+            BuildDepthPyramid(commandBuffer);
+
+            RecordDrawCulling(commandBuffer, frame, DrawCullingPhase::DCP_Late);
+            BeginGeometryRendering(commandBuffer, false);
+            DrawIndirect(commandBuffer, frame);
+        }
+        else if(m_bGPUDrivenDraws)
+        {
+            RecordDrawCulling(commandBuffer, frame, DrawCullingPhase::DCP_All);
+            BeginGeometryRendering(commandBuffer, true);
+            DrawIndirect(commandBuffer, frame);
+        }
+        else
+        {
+            BeginGeometryRendering(commandBuffer, true);
+
+            /*-------------------------------------------------------------------------------------------------
+            The objects are drawn in the sorter's order, so objects with the same pipeline, material and index
+            buffer come one after the other, and within those the objects of the same surface. Every run of
+            objects that draw the same indices with the same material is a single instanced draw, its first
+            instance is the place of the run's first matrix in the instance buffer. Binds are skipped when the
+            state that they set is already bound
+            --------------------------------------------------------------------------------------------------*/
+            VkPipeline boundPipeline = VK_NULL_HANDLE;
+            VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
+            VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+            for(size_t first = 0; first < drawOrder.size();)
+            {
+                const VulkanRenderObject& object = renderObjects[drawOrder[first]];
+                const MaterialPipeline* pPipeline = object.pMaterial->pPipeline;
+
+                size_t end = first + 1;
+                while(end < drawOrder.size())
+                {
+                    const VulkanRenderObject& next = renderObjects[drawOrder[end]];
+                    if(next.pMaterial != object.pMaterial || next.indexType != object.indexType || 
+                    next.firstIndex != object.firstIndex || next.indexCount != object.indexCount || 
+                    next.vertexBufferOffset != object.vertexBufferOffset)
+                    {
+                        break;
+                    }
+                    ++end;
+                }
+
+                if(pPipeline->graphicsPipeline != boundPipeline)
+                {
+                    boundPipeline = pPipeline->graphicsPipeline;
+                    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+                    ++m_drawStatistics.pipelineBinds;
+                }
+                else
+                {
+                    ++m_drawStatistics.skippedBinds;
+                }
+
+                if(object.pMaterial->descriptorSet != VK_NULL_HANDLE)
+                {
+                    if(object.pMaterial->descriptorSet != boundMaterialSet)
+                    {
+                        boundMaterialSet = object.pMaterial->descriptorSet;
+                        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipeline->pipelineLayout, 
+                        1, 1, &boundMaterialSet, 0, nullptr);
+                        ++m_drawStatistics.descriptorSetBinds;
+                    }
+                    else
+                    {
+                        ++m_drawStatistics.skippedBinds;
+                    }
+                }
+
+                if(object.indexType != boundIndexType)
+                {
+                    boundIndexType = object.indexType;
+                    vkCmdBindIndexBuffer(commandBuffer, boundIndexType == VK_INDEX_TYPE_UINT16 ? 
+                    m_meshBuffers.indexBuffer16.buffer : m_meshBuffers.indexBuffer32.buffer, 0, boundIndexType);
+                    ++m_drawStatistics.indexBufferBinds;
+                }
+                else
+                {
+                    ++m_drawStatistics.skippedBinds;
+                }
+
+                //The indices are local to their surface, the vertex offset takes them to the surface's vertices
+                uint32_t instanceCount = static_cast<uint32_t>(end - first);
+                vkCmdDrawIndexed(commandBuffer, object.indexCount, instanceCount, object.firstIndex, 
+                static_cast<int32_t>(object.vertexBufferOffset), static_cast<uint32_t>(first));
+                ++m_drawStatistics.drawCount;
+                m_drawStatistics.instanceCount += instanceCount;
+
+                first = end;
+            }
+        }
 
-            vkCmdDrawIndexed(commandBuffer, m_mainDrawContext.opaqueObjects[i].indexCount, 1, 
-            m_mainDrawContext.opaqueObjects[i].firstIndex, 0, 0);
+        //Logged when the counts change instead of every frame, a static scene only logs them once
+        if(m_drawStatistics != m_previousDrawStatistics)
+        {
+            std::cout << "Draw statistics: " << m_drawStatistics.drawCount << (m_bGPUDrivenDraws ? 
+            " indirect draws of up to " : " draws of ") << m_drawStatistics.instanceCount << " instances, " << 
+            m_drawStatistics.pipelineBinds << " pipeline binds, " << m_drawStatistics.descriptorSetBinds << 
+            " descriptor set binds, " << m_drawStatistics.indexBufferBinds << " index buffer binds, " << 
+            m_drawStatistics.skippedBinds << " binds skipped\n";
+            m_previousDrawStatistics = m_drawStatistics;
         }
 
         vkCmdEndRendering(commandBuffer);
     }
 
+    void VulkanRenderer::BeginGeometryRendering(const VkCommandBuffer& commandBuffer, bool bClearDepth)
+    {
+        //The color attachment is loaded, the background was drawn before it
+        VkRenderingAttachmentInfo colorAttachmentRenderingInfo{};
+        VulkanSDKobjects::ColorRenderingAttachmentInfoInit(colorAttachmentRenderingInfo, 
+        m_colorAttachmentImage.imageView, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkRenderingAttachmentInfo depthAttachmentInfo{};
+        VulkanSDKobjects::DepthRenderingAttachmentInfoInit(depthAttachmentInfo, m_depthAttachmentImage.imageView, 
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        if(!bClearDepth)
+        {
+            depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        }
+        VkRenderingInfo renderingInfo{};
+        VulkanSDKobjects::RenderingInfoInit(renderingInfo, &colorAttachmentRenderingInfo, m_drawExtent, &depthAttachmentInfo, 
+        nullptr);
+        vkCmdBeginRendering(commandBuffer, &renderingInfo);
+    }
+
+    //Makes the writes of the source stages visible to the accesses of the destination stages
+    static void RecordMemoryBarrier(const VkCommandBuffer& commandBuffer, VkPipelineStageFlags2 srcStageMask, 
+    VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+    {
+        VkMemoryBarrier2 memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        memoryBarrier.srcStageMask = srcStageMask;
+        memoryBarrier.srcAccessMask = srcAccessMask;
+        memoryBarrier.dstStageMask = dstStageMask;
+        memoryBarrier.dstAccessMask = dstAccessMask;
+
+        VkDependencyInfo dependency{};
+        dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency.memoryBarrierCount = 1;
+        dependency.pMemoryBarriers = &memoryBarrier;
+
+        vkCmdPipelineBarrier2(commandBuffer, &dependency);
+    }
+
+    void VulkanRenderer::PrepareDrawCulling(const VkCommandBuffer& commandBuffer, FrameTools& frame)
+    {
+        /*-------------------------------------------------------------------------------------------------
+        Every bucket has room for every render object, so the shader never runs out of room whichever 
+        buckets the visible objects are in. There are only a few buckets, one for every material and index
+        type, and the CPU never has to count the objects of each
+        --------------------------------------------------------------------------------------------------*/
+        uint32_t objectCount = static_cast<uint32_t>(m_renderObjects.GetRenderObjects().size());
+        uint32_t bucketCount = static_cast<uint32_t>(m_drawBuckets.GetBuckets().size());
+        size_t drawCount = std::max<size_t>(static_cast<size_t>(objectCount) * bucketCount, 1);
+        ReserveBuffer(frame.drawCommandBuffer, frame.drawCommandBufferAddress, frame.drawCommandCapacity, drawCount, 
+        sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 
+        BLITZEN_DRAW_CULLING_MEMORY_USAGE);
+        ReserveBuffer(frame.culledInstanceBuffer, frame.culledInstanceBufferAddress, frame.culledInstanceCapacity, 
+        drawCount, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, BLITZEN_DRAW_CULLING_MEMORY_USAGE);
+        ReserveBuffer(frame.drawCountBuffer, frame.drawCountBufferAddress, frame.drawCountCapacity, 
+        std::max<size_t>(bucketCount, 1), sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, BLITZEN_DRAW_CULLING_MEMORY_USAGE);
+
+        /*-------------------------------------------------------------------------------------------------
+        The visibility buffer is shared by the frames, so the other frame has to be done with it before it
+        is replaced. It only grows with the render objects, which it starts as hidden, and objects that move
+        in it from swap removals only get a stale visibility, the late phase still tests them every frame
+        --------------------------------------------------------------------------------------------------*/
+        if(std::max<size_t>(objectCount, 1) > m_visibilityCapacity)
+        {
+            vkDeviceWaitIdle(m_device);
+            ReserveBuffer(m_visibilityBuffer, m_visibilityBufferAddress, m_visibilityCapacity, 
+            std::max<size_t>(objectCount, 1), sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+            vkCmdFillBuffer(commandBuffer, m_visibilityBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+            RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, 
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | 
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        }
+
+        m_cullingData.objectBufferAddress = frame.objectBufferAddress;
+        m_cullingData.surfaceBufferAddress = m_surfaceBufferAddress;
+        m_cullingData.drawCommandBufferAddress = frame.drawCommandBufferAddress;
+        m_cullingData.drawCountBufferAddress = frame.drawCountBufferAddress;
+        m_cullingData.instanceBufferAddress = frame.culledInstanceBufferAddress;
+        m_cullingData.visibilityBufferAddress = m_visibilityBufferAddress;
+        m_cullingData.objectCount = objectCount;
+        m_cullingData.drawCapacity = objectCount;
+        m_cullingData.viewportWidth = static_cast<float>(m_drawExtent.width);
+        m_cullingData.viewportHeight = static_cast<float>(m_drawExtent.height);
+        *reinterpret_cast<GPUCullingData*>(frame.cullingDataBuffer.allocation->GetMappedData()) = m_cullingData;
+        vmaFlushAllocation(m_allocator, frame.cullingDataBuffer.allocation, 0, sizeof(GPUCullingData));
+
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            //Reads back the object data that was just written, which is slow but only done to validate the shader
+            frame.referenceCommands.resize(drawCount);
+            frame.referenceInstanceObjects.resize(drawCount);
+            frame.referenceDrawCounts.resize(bucketCount);
+            frame.referenceDrawCapacity = objectCount;
+            CullDrawsReference(m_cullingData, objectCount ? reinterpret_cast<const GPUObjectData*>(
+            frame.objectBuffer.allocation->GetMappedData()) : nullptr, m_surfaces.data(), bucketCount, 
+            frame.referenceCommands.data(), frame.referenceInstanceObjects.data(), frame.referenceDrawCounts.data());
+        #endif
+    }
+
+    void VulkanRenderer::RecordDrawCulling(const VkCommandBuffer& commandBuffer, FrameTools& frame, 
+    DrawCullingPhase phase)
+    {
+        uint32_t objectCount = m_cullingData.objectCount;
+        uint32_t bucketCount = static_cast<uint32_t>(m_drawBuckets.GetBuckets().size());
+        if(!bucketCount)
+        {
+            return;
+        }
+
+        /*-------------------------------------------------------------------------------------------------
+        The counters start from 0 for every phase, the shader adds every object that it draws to its bucket's.
+        The draws of an earlier phase have to be done reading the buffers first, and the visibility that the
+        last frame's late phase wrote has to reach the shader
+        --------------------------------------------------------------------------------------------------*/
+        RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | 
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT | 
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | 
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer.buffer, 0, bucketCount * sizeof(uint32_t), 0);
+        RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, 
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        if(objectCount)
+        {
+            GPUDrawCullingConstants drawCullingConstants{};
+            drawCullingConstants.cullingDataAddress = frame.cullingDataBufferAddress;
+            drawCullingConstants.phase = static_cast<uint32_t>(phase);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_drawCullingPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_drawCullingPipelineLayout, 0, 1, 
+            &m_drawCullingSet, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, m_drawCullingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, 
+            sizeof(GPUDrawCullingConstants), &drawCullingConstants);
+            vkCmdDispatch(commandBuffer, (objectCount + BLITZEN_DRAW_CULLING_GROUP_SIZE - 1) / 
+            BLITZEN_DRAW_CULLING_GROUP_SIZE, 1, 1);
+        }
+
+        //The draws read the commands and counts, the vertex shader reads the instances and the host may read them all back
+        RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT, 
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | 
+        VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | 
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_HOST_READ_BIT);
+    }
+
+    void VulkanRenderer::BuildDepthPyramid(const VkCommandBuffer& commandBuffer)
+    {
+        //The first level samples the depth attachment once the early phase is done writing it
+        ChangeImageLayout(commandBuffer, m_depthAttachmentImage.image, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, 
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_depthPyramidPipeline);
+        for(uint32_t level = 0; level < m_depthPyramidSets.size(); ++level)
+        {
+            uint32_t levelWidth = std::max(m_depthPyramid.extent.width >> level, 1u);
+            uint32_t levelHeight = std::max(m_depthPyramid.extent.height >> level, 1u);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_depthPyramidPipelineLayout, 0, 1, 
+            &m_depthPyramidSets[level], 0, nullptr);
+            vkCmdDispatch(commandBuffer, (levelWidth + BLITZEN_DEPTH_PYRAMID_GROUP_SIZE - 1) / 
+            BLITZEN_DEPTH_PYRAMID_GROUP_SIZE, (levelHeight + BLITZEN_DEPTH_PYRAMID_GROUP_SIZE - 1) / 
+            BLITZEN_DEPTH_PYRAMID_GROUP_SIZE, 1);
+
+            //Every level is read by the next one, and all of them by the late phase
+            RecordMemoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, 
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, 
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+        }
+
+        //The late phase draws on top of the early phase's depth
+        ChangeImageLayout(commandBuffer, m_depthAttachmentImage.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    }
+
+    void VulkanRenderer::DrawIndirect(const VkCommandBuffer& commandBuffer, FrameTools& frame)
+    {
+        //Every bucket is a single draw of as many commands as the shader wrote to its range
+        const std::vector<GPUDrawBucket>& buckets = m_drawBuckets.GetBuckets();
+        uint32_t drawCapacity = m_cullingData.drawCapacity;
+        m_drawStatistics.instanceCount = m_cullingData.objectCount;
+        if(!drawCapacity)
+        {
+            return;
+        }
+
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
+        VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+        for(uint32_t bucket = 0; bucket < buckets.size(); ++bucket)
+        {
+            const MaterialInstance* pMaterial = buckets[bucket].pMaterial;
+            if(pMaterial->pPipeline->graphicsPipeline != boundPipeline)
+            {
+                boundPipeline = pMaterial->pPipeline->graphicsPipeline;
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+                ++m_drawStatistics.pipelineBinds;
+            }
+            else
+            {
+                ++m_drawStatistics.skippedBinds;
+            }
+
+            if(pMaterial->descriptorSet != VK_NULL_HANDLE)
+            {
+                if(pMaterial->descriptorSet != boundMaterialSet)
+                {
+                    boundMaterialSet = pMaterial->descriptorSet;
+                    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
+                    pMaterial->pPipeline->pipelineLayout, 1, 1, &boundMaterialSet, 0, nullptr);
+                    ++m_drawStatistics.descriptorSetBinds;
+                }
+                else
+                {
+                    ++m_drawStatistics.skippedBinds;
+                }
+            }
+
+            if(buckets[bucket].indexType != boundIndexType)
+            {
+                boundIndexType = buckets[bucket].indexType;
+                vkCmdBindIndexBuffer(commandBuffer, boundIndexType == VK_INDEX_TYPE_UINT16 ? 
+                m_meshBuffers.indexBuffer16.buffer : m_meshBuffers.indexBuffer32.buffer, 0, boundIndexType);
+                ++m_drawStatistics.indexBufferBinds;
+            }
+            else
+            {
+                ++m_drawStatistics.skippedBinds;
+            }
+
+            vkCmdDrawIndexedIndirectCount(commandBuffer, frame.drawCommandBuffer.buffer, 
+            static_cast<VkDeviceSize>(bucket) * drawCapacity * sizeof(VkDrawIndexedIndirectCommand), 
+            frame.drawCountBuffer.buffer, bucket * sizeof(uint32_t), drawCapacity, sizeof(VkDrawIndexedIndirectCommand));
+            ++m_drawStatistics.drawCount;
+        }
+    }
+
+    #ifdef BLITZEN_VALIDATE_GPU_CULLING
+
+        void VulkanRenderer::ValidateDrawCulling(FrameTools& frame)
+        {
+            //Nothing to compare until the frame has culled once, the frame's fence was waited on so the GPU is done
+            if(frame.referenceDrawCounts.empty())
+            {
+                return;
+            }
+
+            uint32_t bucketCount = static_cast<uint32_t>(frame.referenceDrawCounts.size());
+            size_t drawCount = static_cast<size_t>(bucketCount) * frame.referenceDrawCapacity;
+            vmaInvalidateAllocation(m_allocator, frame.drawCommandBuffer.allocation, 0, 
+            drawCount * sizeof(VkDrawIndexedIndirectCommand));
+            vmaInvalidateAllocation(m_allocator, frame.culledInstanceBuffer.allocation, 0, drawCount * sizeof(uint32_t));
+            vmaInvalidateAllocation(m_allocator, frame.drawCountBuffer.allocation, 0, bucketCount * sizeof(uint32_t));
+            const uint32_t* pDrawCounts = reinterpret_cast<const uint32_t*>(
+            frame.drawCountBuffer.allocation->GetMappedData());
+
+            uint32_t mismatchCount = CompareCulledDraws(bucketCount, frame.referenceDrawCapacity, 
+            frame.referenceCommands.data(), frame.referenceInstanceObjects.data(), frame.referenceDrawCounts.data(), 
+            reinterpret_cast<const VkDrawIndexedIndirectCommand*>(frame.drawCommandBuffer.allocation->GetMappedData()), 
+            reinterpret_cast<const uint32_t*>(frame.culledInstanceBuffer.allocation->GetMappedData()), pDrawCounts);
+
+            uint32_t gpuDrawCount = 0;
+            uint32_t referenceDrawCount = 0;
+            for(uint32_t bucket = 0; bucket < bucketCount; ++bucket)
+            {
+                gpuDrawCount += pDrawCounts[bucket];
+                referenceDrawCount += frame.referenceDrawCounts[bucket];
+            }
+
+            ++m_validatedFrameCount;
+            m_failedValidationCount += mismatchCount ? 1 : 0;
+
+            //Logged when the draws differ or when their number changes, a static scene only logs once
+            if(mismatchCount || gpuDrawCount != m_validatedDrawCount)
+            {
+                std::cout << "GPU draw culling: " << gpuDrawCount << " draws, CPU reference: " << referenceDrawCount << 
+                " draws, " << mismatchCount << " draws differ\n";
+                m_validatedDrawCount = gpuDrawCount;
+            }
+            frame.referenceDrawCounts.clear();
+        }
+
+    #endif
+
     void VulkanRenderer::ChangeImageLayout(const VkCommandBuffer& commandBuffer, VkImage& image, 
     VkImageLayout oldLayout, VkImageLayout newLayout)
     {
@@ -943,9 +1906,10 @@ namespace BlitzenRendering
         imageMemoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
         imageMemoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
 
+        //The depth attachment is also taken out of its layout, to be sampled
         VkImageAspectFlags aspectMask;
-        (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT : 
-        aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        (newLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || oldLayout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? 
+        aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT : aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         VkImageSubresourceRange subresource{};
         VulkanSDKobjects::ImageSubresourceRangeInit(subresource, aspectMask);
         imageMemoryBarrier.subresourceRange = subresource;
@@ -1008,6 +1972,22 @@ namespace BlitzenRendering
         m_placeholderMaterialData.CleanupResources(m_device);
         vkDestroyPipeline(m_device, m_placeholderPipeline, nullptr);
         vkDestroyPipelineLayout(m_device, m_placeholderPipelineLayout, nullptr);
+        vkDestroyPipeline(m_device, m_drawCullingPipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_drawCullingPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_drawCullingSetLayout, nullptr);
+        m_surfaceBuffer.CleanupResources(m_device, m_allocator);
+
+        vkDestroyPipeline(m_device, m_depthPyramidPipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_depthPyramidPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(m_device, m_depthPyramidSetLayout, nullptr);
+        vkDestroySampler(m_device, m_depthPyramidSampler, nullptr);
+        for(VkImageView levelView : m_depthPyramidLevelViews)
+        {
+            vkDestroyImageView(m_device, levelView, nullptr);
+        }
+        m_depthPyramid.CleanupResources(m_device, m_allocator);
+        m_visibilityBuffer.CleanupResources(m_device, m_allocator);
+        m_staticDescriptorAllocator.CleanupResources(m_device);
 
         CleanupImages();
 
@@ -1058,6 +2038,12 @@ namespace BlitzenRendering
         descriptorAllocator.CleanupResources(device);
 
         vmaDestroyBuffer(allocator, sceneDataBuffer.buffer, sceneDataBuffer.allocation);
+        vmaDestroyBuffer(allocator, objectBuffer.buffer, objectBuffer.allocation);
+        vmaDestroyBuffer(allocator, instanceBuffer.buffer, instanceBuffer.allocation);
+        vmaDestroyBuffer(allocator, cullingDataBuffer.buffer, cullingDataBuffer.allocation);
+        vmaDestroyBuffer(allocator, drawCommandBuffer.buffer, drawCommandBuffer.allocation);
+        vmaDestroyBuffer(allocator, drawCountBuffer.buffer, drawCountBuffer.allocation);
+        vmaDestroyBuffer(allocator, culledInstanceBuffer.buffer, culledInstanceBuffer.allocation);
     }
 
     void OneTimeCommands::CleanupResources(const VkDevice& device)
@@ -1079,7 +2065,11 @@ namespace BlitzenRendering
     void VulkanGPUMeshBuffers::CleanupResources(const VkDevice& device, const VmaAllocator& allocator)
     {
         vertexBuffer.CleanupResources(device, allocator);
-        indexBuffer.CleanupResources(device, allocator);
+        indexBuffer32.CleanupResources(device, allocator);
+        indexBuffer16.CleanupResources(device, allocator);
+        meshletBuffer.CleanupResources(device, allocator);
+        meshletVertexBuffer.CleanupResources(device, allocator);
+        meshletTriangleBuffer.CleanupResources(device, allocator);
     }
 
     void VulkanRenderer::CleanupVulkanBootstrapObjects()
@@ -14,6 +14,10 @@
 
 #include "vulkanPipelines.h"
 #include "vulkanRenderData.h"
+#include "drawSorting.h"
+#include "drawCulling.h"
+#include "Culling/softwareOcclusion.h"
+#include "Culling/boundingVolumeHierarchy.h"
 
 
 namespace BlitzenRendering
@@ -21,6 +25,24 @@ namespace BlitzenRendering
     //When Vuklan is busy drawing one frame, the cpu should be allowed to start processing the next one
     #define BLITZEN_MAX_FRAMES_IN_FLIGHT 2
 
+    //The objects and instances that each frame's buffers have room for at first, they double whenever they run out
+    #define BLITZEN_INITIAL_INSTANCE_CAPACITY 1024
+
+    /*-----------------------------------------------------------------------------------------------------
+    The software occlusion culling draws the occluders of the biggest visible objects on the screen until
+    their triangles reach the budget. Objects that cover fewer pixels of the software depth buffer than
+    the minimum hide too little to be worth drawing
+    -------------------------------------------------------------------------------------------------------*/
+    #define BLITZEN_SOFTWARE_OCCLUSION_TRIANGLE_BUDGET      16384
+    #define BLITZEN_SOFTWARE_OCCLUDER_MIN_PIXELS            8.f
+
+    //The draw culling shader's output stays on the GPU, unless it is read back to be compared with the CPU reference
+    #ifdef BLITZEN_VALIDATE_GPU_CULLING
+        #define BLITZEN_DRAW_CULLING_MEMORY_USAGE VMA_MEMORY_USAGE_GPU_TO_CPU
+    #else
+        #define BLITZEN_DRAW_CULLING_MEMORY_USAGE VMA_MEMORY_USAGE_GPU_ONLY
+    #endif
+
     //Holds the swapchain handle and all relevant data
     struct SwapchainData
     {
@@ -116,6 +138,44 @@ namespace BlitzenRendering
 
         VulkanAllocatedBuffer sceneDataBuffer;
 
+        /*-----------------------------------------------------------------------------------------
+        Mapped, holds the GPUObjectData of every render object. It stays from frame to frame, only the
+        objects that changed since this frame's last draw are written to it again
+        ------------------------------------------------------------------------------------------*/
+        VulkanAllocatedBuffer objectBuffer;
+        VkDeviceAddress objectBufferAddress{0};
+        size_t objectCapacity{0};
+        //The render objects that changed since this frame's buffer was last written, an object can be listed twice
+        std::vector<uint32_t> pendingObjects;
+
+        //Mapped, holds the index of the render object of every instance drawn in the frame, in draw order
+        VulkanAllocatedBuffer instanceBuffer;
+        VkDeviceAddress instanceBufferAddress{0};
+        size_t instanceCapacity{0};
+
+        /*-----------------------------------------------------------------------------------------
+        Used by GPU driven draws. The mapped culling data is given to the draw culling shader, which
+        writes the draw commands, the draw count of every bucket and the object of every draw to the 
+        buffers after it. The instance buffer above is not used then, the culled one takes its place
+        ------------------------------------------------------------------------------------------*/
+        VulkanAllocatedBuffer cullingDataBuffer;
+        VkDeviceAddress cullingDataBufferAddress{0};
+        VulkanAllocatedBuffer drawCommandBuffer;
+        VkDeviceAddress drawCommandBufferAddress{0};
+        size_t drawCommandCapacity{0};
+        VulkanAllocatedBuffer drawCountBuffer;
+        VkDeviceAddress drawCountBufferAddress{0};
+        size_t drawCountCapacity{0};
+        VulkanAllocatedBuffer culledInstanceBuffer;
+        VkDeviceAddress culledInstanceBufferAddress{0};
+        size_t culledInstanceCapacity{0};
+
+        //What the CPU reference culler found for the frame's last dispatch, only kept when the culling is validated
+        std::vector<VkDrawIndexedIndirectCommand> referenceCommands;
+        std::vector<uint32_t> referenceInstanceObjects;
+        std::vector<uint32_t> referenceDrawCounts;
+        uint32_t referenceDrawCapacity{0};
+
         void CleanupResources(const VkDevice& device, const VmaAllocator& allocator);
     };
 
@@ -136,6 +196,24 @@ namespace BlitzenRendering
         void CleanupResources(const VkDevice& m_device);
     };
 
+    //Mapped staging memory that mesh geometry is written to, before it gets copied to the mesh buffers
+    struct MeshBufferStaging
+    {
+        VulkanAllocatedBuffer stagingBuffer;
+
+        //Points to VulkanVertex or CompactVulkanVertex elements, depending on the vertex format
+        void* pVertexData{nullptr};
+        VulkanVertexFormat vertexFormat{VulkanVertexFormat::VVF_Full};
+        size_t vertexCount{0};
+
+        //Surfaces with few enough vertices use 16 bit indices, the rest use 32 bit indices
+        uint32_t* pIndices32{nullptr};
+        size_t index32Count{0};
+
+        uint16_t* pIndices16{nullptr};
+        size_t index16Count{0};
+    };
+
     class VulkanRenderer
     {
     public:
@@ -151,6 +229,23 @@ namespace BlitzenRendering
         void LoadMeshBuffers(std::vector<VulkanVertex>& vertices, 
         std::vector<uint32_t>& indices);
 
+        //Same as above but for geometry that is not owned by vectors, like a memory mapped cooked mesh
+        void LoadMeshBuffers(const void* pVertexData, VulkanVertexFormat vertexFormat, size_t vertexCount, 
+        const uint32_t* pIndices32, size_t index32Count, const uint16_t* pIndices16, size_t index16Count);
+
+        /*---------------------------------------------------------------------------------------------
+        Allocates and maps a staging buffer big enough for the given geometry, so that loaders can
+        write the vertices and indices straight into it. EndMeshBufferUpload then creates the mesh 
+        buffers, copies the staging buffer to them and frees it
+        ----------------------------------------------------------------------------------------------*/
+        void BeginMeshBufferUpload(MeshBufferStaging& staging, VulkanVertexFormat vertexFormat, 
+        size_t vertexCount, size_t index32Count, size_t index16Count);
+        void EndMeshBufferUpload(MeshBufferStaging& staging);
+
+        //Creates the meshlet buffers of the mesh buffers and uploads the meshlet tables to them
+        void LoadMeshletBuffers(const VulkanMeshlet* pMeshlets, size_t meshletCount, const uint32_t* pMeshletVertices, 
+        size_t meshletVertexCount, const uint8_t* pMeshletTriangles, size_t meshletTriangleSize);
+
         void WriteMaterial(MaterialInstance& instance, VkDevice device, MaterialPass pass, 
         MaterialResources& resources);
 
@@ -165,6 +260,56 @@ namespace BlitzenRendering
         //The destructor will be explicit so that the main engine can destroy it at the correct time
         void CleanupResources();
 
+        //What the last frame culled and drew
+        inline const BlitzenEngine::CullingStatistics& GetCullingStatistics() const {return m_cullingStatistics;}
+        inline const DrawStatistics& GetDrawStatistics() const {return m_drawStatistics;}
+
+        /*-----------------------------------------------------------------------------------------------
+        In GPU driven mode a compute shader culls the render objects and picks their levels of detail on 
+        the GPU, then writes their draws for a single indirect draw of every material and index type. The
+        CPU no longer walks the render objects every frame, only the ones that changed
+        ------------------------------------------------------------------------------------------------*/
+        void SetGPUDrivenDraws(bool bGPUDrivenDraws);
+        inline bool IsGPUDrivenDraws() const {return m_bGPUDrivenDraws;}
+        //False if the gpu cannot draw indirect with a count or from any first instance, the draws then stay on the CPU
+        inline bool IsGPUDrivenDrawsSupported() const {return m_bGPUDrivenDrawsSupported;}
+
+        /*-----------------------------------------------------------------------------------------------
+        With occlusion culling GPU driven draws are culled in two phases, around a depth pyramid that is
+        built from what the first phase drew, so that objects hidden behind others are not drawn
+        ------------------------------------------------------------------------------------------------*/
+        void SetOcclusionCulling(bool bOcclusionCulling);
+        inline bool IsOcclusionCulling() const {return m_bOcclusionCulling;}
+
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            //How many frames' draws were compared with the CPU reference, and how many of them differed from it
+            inline uint32_t GetValidatedFrameCount() const {return m_validatedFrameCount;}
+            inline uint32_t GetFailedValidationCount() const {return m_failedValidationCount;}
+        #endif
+
+        /*-----------------------------------------------------------------------------------------------
+        With software occlusion culling the draws of the CPU are also culled against a small depth buffer
+        that the CPU draws the simplified occluders of the biggest visible objects into. Has no effect on
+        GPU driven draws, which have their own occlusion culling
+        ------------------------------------------------------------------------------------------------*/
+        inline void SetSoftwareOcclusionCulling(bool bSoftwareOcclusionCulling) 
+        {m_bSoftwareOcclusionCulling = bSoftwareOcclusionCulling;}
+        inline bool IsSoftwareOcclusionCulling() const {return m_bSoftwareOcclusionCulling;}
+
+        //Writes the next frame's software depth buffer and tested boxes to a PPM image, for debugging
+        void RequestSoftwareOcclusionDump(const std::filesystem::path& path);
+
+        /*-----------------------------------------------------------------------------------------------
+        Queries on the render objects' bounding spheres as of the last frame, answered by the hierarchy
+        that the frustum culling uses. A pick returns the render object whose sphere a ray with normalized 
+        direction enters first within the distance, or BLITZEN_BVH_NO_OBJECT
+        ------------------------------------------------------------------------------------------------*/
+        inline uint32_t PickRenderObject(const glm::vec3& origin, const glm::vec3& direction, float& distance) const
+        {return m_objectHierarchy.Raycast(origin, direction, m_renderObjects.GetObjectSpheres(), distance);}
+        inline void QueryRenderObjects(const glm::vec3& boundsMin, const glm::vec3& boundsMax, 
+        std::vector<uint32_t>& objects) const
+        {m_objectHierarchy.QueryBox(boundsMin, boundsMax, m_renderObjects.GetObjectSpheres(), objects);}
+
         //Setting the constructor to default and destroy copy operators
         VulkanRenderer();
         VulkanRenderer operator = (VulkanRenderer& vulkan) = delete;
@@ -195,12 +340,46 @@ namespace BlitzenRendering
 
 
         void AllocateBuffer(VulkanAllocatedBuffer& bufferToAllocate, VkDeviceSize bufferSize, 
-        VkBufferUsageFlags bufferUsage, VmaMemoryUsage memoryUsage);
+        VkBufferUsageFlags bufferUsage, VmaMemoryUsage memoryUsage, VkMemoryPropertyFlags preferredMemoryFlags = 0);
 
 
 
         void InitPlaceholderMaterial();
 
+        //Creates the draw culling compute pipeline
+        void InitDrawCulling();
+
+        //Creates the depth pyramid with a view of every level, and the pipeline and sets that build it
+        void InitDepthPyramid();
+
+
+        /*---------------------------------------------------------------------------------------------
+        Makes a mapped storage buffer big enough for count elements, replacing it with one of double the
+        capacity when it is not. The frame that uses it must have finished drawing. Returns true if the
+        buffer was replaced, its contents are lost then
+        ----------------------------------------------------------------------------------------------*/
+        bool ReserveMappedBuffer(VulkanAllocatedBuffer& buffer, VkDeviceAddress& address, size_t& capacity, 
+        size_t count, size_t elementSize);
+
+        //Same as above, for buffers with any usage and memory usage
+        bool ReserveBuffer(VulkanAllocatedBuffer& buffer, VkDeviceAddress& address, size_t& capacity, 
+        size_t count, size_t elementSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
+
+        //Rebuilds the surface table and uploads it, when assets were added since it was last built
+        void UpdateSurfaceTable();
+
+        //Writes what the shaders need to know about a render object to its place in an object buffer
+        void WriteObjectData(GPUObjectData* pObjectData, uint32_t object);
+
+        //Writes the data of the render objects that changed since the frame last drew to the frame's object buffer
+        void UpdateObjectBuffer(FrameTools& frame);
+
+        /*---------------------------------------------------------------------------------------------
+        Draws the occluders of the visible render objects with the software rasterizer, then hides the
+        visible objects whose bounds are behind them. Returns how many were hidden
+        ----------------------------------------------------------------------------------------------*/
+        uint32_t CullOccludedObjects(const glm::vec3& cameraPosition);
+
 
 
         //Updates global scene data and adds the objects than need to be draw to the draw context
@@ -220,6 +399,26 @@ namespace BlitzenRendering
 
         void DrawGeometry(const VkCommandBuffer& commandBuffer);
 
+        //Starts rendering to the attachments, the depth is either cleared or kept from an earlier pass
+        void BeginGeometryRendering(const VkCommandBuffer& commandBuffer, bool bClearDepth);
+
+        /*---------------------------------------------------------------------------------------------
+        PrepareDrawCulling makes room for the frame's culled draws and writes its culling data, then each
+        phase's draw culling dispatch is recorded before the rendering that draws it. DrawIndirect records
+        the indirect draw of every bucket while rendering
+        ----------------------------------------------------------------------------------------------*/
+        void PrepareDrawCulling(const VkCommandBuffer& commandBuffer, FrameTools& frame);
+        void RecordDrawCulling(const VkCommandBuffer& commandBuffer, FrameTools& frame, DrawCullingPhase phase);
+        void DrawIndirect(const VkCommandBuffer& commandBuffer, FrameTools& frame);
+
+        //Builds every level of the depth pyramid from the depth attachment, outside of rendering
+        void BuildDepthPyramid(const VkCommandBuffer& commandBuffer);
+
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            //Compares the draws of the frame's last culling dispatch with the CPU reference, once the frame is done
+            void ValidateDrawCulling(FrameTools& frame);
+        #endif
+
         //Copies the contents of one image to the other
         void CopyImageToImage(const VkCommandBuffer& commandBuffer, VkImage& srcImage, VkImage& dstImage, 
         VkImageLayout srcImageLayout, VkImageLayout dstImageLayout, VkExtent2D srcImageSize, VkExtent2D dstImageSize);
@@ -246,6 +445,9 @@ namespace BlitzenRendering
 
         //Keeps track of the object assets that vulkan will have to access while drawing
         std::vector<VulkanMeshAsset> m_assets;
+
+        //The node hierarchy of every imported scene, its nodes reference the assets by index
+        BlitzenEngine::TransformHierarchy m_sceneHierarchy;
     
     private:
 
@@ -292,8 +494,89 @@ namespace BlitzenRendering
         VkDescriptorSetLayout m_globalSceneDataDescriptorSetLayout{VK_NULL_HANDLE};
 
 	VulkanGPUMeshBuffers m_meshBuffers;
+        //The layout of the vertices in the mesh buffers, decides which vertex shader the pipelines use
+        VulkanVertexFormat m_vertexFormat{VulkanVertexFormat::VVF_Full};
 
         DrawContext m_mainDrawContext;
-        std::unordered_map<std::string, Node> m_nodeTable;
+        RenderObjectRegistry m_renderObjects;
+        //Built over the render objects' spheres, refitted as they move and rebuilt when they are added or removed
+        BlitzenEngine::BoundingVolumeHierarchy m_objectHierarchy;
+        //1 for every render object whose bounding sphere was inside the view frustum this frame and that was not occluded
+        std::vector<uint8_t> m_objectVisibility;
+        BlitzenEngine::CullingStatistics m_cullingStatistics;
+        BlitzenEngine::CullingStatistics m_previousCullingStatistics;
+
+        //CPU draws test the objects that frustum culling kept against occluders rasterized in software
+        #ifdef BLITZEN_SOFTWARE_OCCLUSION
+            bool m_bSoftwareOcclusionCulling = true;
+        #else
+            bool m_bSoftwareOcclusionCulling = false;
+        #endif
+        BlitzenEngine::SoftwareOcclusionRasterizer m_softwareOcclusion;
+        //Reused every frame by the software occlusion culling, the size of each occluder candidate goes with its object
+        std::vector<std::pair<float, uint32_t>> m_occluderCandidates;
+        std::vector<BlitzenEngine::OcclusionBox> m_occlusionBoxes;
+        std::vector<uint32_t> m_occlusionBoxObjects;
+        std::vector<uint8_t> m_occlusionBoxVisibility;
+        //Not empty while a dump of the software depth buffer is waiting for the next frame
+        std::filesystem::path m_softwareOcclusionDumpPath;
+
+        //The order that the visible render objects are drawn in, rebuilt every frame
+        DrawSorter m_drawSorter;
+        //What the last two frames' draws bound, the counts are logged whenever they change
+        DrawStatistics m_drawStatistics;
+        DrawStatistics m_previousDrawStatistics;
+        //Used by GPU driven draws, the culling data is filled in every frame without the buffers' addresses
+        #if defined(BLITZEN_GPU_DRIVEN_DRAWS) || defined(BLITZEN_VALIDATE_GPU_CULLING)
+            bool m_bGPUDrivenDraws = true;
+        #else
+            bool m_bGPUDrivenDraws = false;
+        #endif
+        bool m_bGPUDrivenDrawsSupported = false;
+        VkPipeline m_drawCullingPipeline{VK_NULL_HANDLE};
+        VkPipelineLayout m_drawCullingPipelineLayout{VK_NULL_HANDLE};
+        VkDescriptorSetLayout m_drawCullingSetLayout{VK_NULL_HANDLE};
+        VkDescriptorSet m_drawCullingSet{VK_NULL_HANDLE};
+        GPUCullingData m_cullingData{};
+        GPUDrawBuckets m_drawBuckets;
+        //The surfaces of every asset, the first surface of every asset is where its surfaces start
+        std::vector<GPUSurfaceData> m_surfaces;
+        std::vector<uint32_t> m_assetFirstSurfaces;
+        VulkanAllocatedBuffer m_surfaceBuffer;
+        VkDeviceAddress m_surfaceBufferAddress{0};
+        size_t m_surfaceCapacity{0};
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            //The number of draws that the shader wrote the last time that the validation was logged
+            uint32_t m_validatedDrawCount{~0u};
+            uint32_t m_validatedFrameCount{0};
+            uint32_t m_failedValidationCount{0};
+        #endif
+
+        //The CPU reference has no depth pyramid, so the draws are culled in a single phase while they are validated
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            bool m_bOcclusionCulling = false;
+        #else
+            bool m_bOcclusionCulling = true;
+        #endif
+        /*-----------------------------------------------------------------------------------------------
+        Like the depth attachment, the depth pyramid is shared by the frames in flight, and so is the
+        visibility that the late phase finds for the next frame's early phase. Every level of the pyramid
+        has its own view and a set that builds it from the level before, all of them are made once
+        ------------------------------------------------------------------------------------------------*/
+        VulkanAllocatedImage m_depthPyramid;
+        std::vector<VkImageView> m_depthPyramidLevelViews;
+        std::vector<VkDescriptorSet> m_depthPyramidSets;
+        VkSampler m_depthPyramidSampler{VK_NULL_HANDLE};
+        VkPipeline m_depthPyramidPipeline{VK_NULL_HANDLE};
+        VkPipelineLayout m_depthPyramidPipelineLayout{VK_NULL_HANDLE};
+        VkDescriptorSetLayout m_depthPyramidSetLayout{VK_NULL_HANDLE};
+        VulkanAllocatedBuffer m_visibilityBuffer;
+        VkDeviceAddress m_visibilityBufferAddress{0};
+        size_t m_visibilityCapacity{0};
+        //Allocates the sets that are written once and never change, instead of the frames' allocators
+        DescriptorAllocator m_staticDescriptorAllocator;
+
+        BlitzenEngine::TransformHandle m_sphereNode;
+        BlitzenEngine::TransformHandle m_suzanneNode;
     };
 }
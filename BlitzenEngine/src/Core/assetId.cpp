@@ -0,0 +1,43 @@
+#include "assetId.h"
+
+#include <unordered_map>
+#include <mutex>
+#include <iostream>
+
+namespace BlitzenEngine
+{
+    //Names are interned while assets load, which can happen on the job system's workers
+    static std::unordered_map<uint64_t, std::string>& GetInternedNames(std::mutex*& pMutex)
+    {
+        static std::unordered_map<uint64_t, std::string> s_names;
+        static std::mutex s_mutex;
+        pMutex = &s_mutex;
+        return s_names;
+    }
+
+    AssetId InternAssetName(std::string_view name)
+    {
+        AssetId id = MakeAssetId(name);
+
+        std::mutex* pMutex;
+        std::unordered_map<uint64_t, std::string>& names = GetInternedNames(pMutex);
+        std::lock_guard<std::mutex> lock(*pMutex);
+        auto interned = names.try_emplace(id.hash, name);
+        if(!interned.second && interned.first->second != name)
+        {
+            std::cout << "Interning asset name: " << name << " -> Same ID as " << interned.first->second << '\n';
+        }
+        return id;
+    }
+
+    const std::string& GetAssetName(AssetId id)
+    {
+        static const std::string s_emptyName;
+
+        std::mutex* pMutex;
+        const std::unordered_map<uint64_t, std::string>& names = GetInternedNames(pMutex);
+        std::lock_guard<std::mutex> lock(*pMutex);
+        auto interned = names.find(id.hash);
+        return interned != names.end() ? interned->second : s_emptyName;
+    }
+}
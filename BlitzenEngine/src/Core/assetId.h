@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace BlitzenEngine
+{
+    /*---------------------------------------------------------------------------------------------------
+    Names an asset or a scene node by the 64 bit FNV-1a hash of its name. Hashing is constexpr, so the IDs
+    of names that the code looks up are computed by the compiler, and comparing IDs never touches a string.
+    Names that come from files are interned, which keeps the string around for tools and logs
+    ----------------------------------------------------------------------------------------------------*/
+    struct AssetId
+    {
+        uint64_t hash = 0;
+
+        constexpr bool operator == (const AssetId& other) const {return hash == other.hash;}
+        constexpr bool operator != (const AssetId& other) const {return hash != other.hash;}
+    };
+
+    constexpr uint64_t HashAssetName(std::string_view name)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(char character : name)
+        {
+            hash = (hash ^ static_cast<uint8_t>(character)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    constexpr AssetId MakeAssetId(std::string_view name)
+    {
+        return AssetId{HashAssetName(name)};
+    }
+
+    //Hashes the name and saves it, so that GetAssetName can find it. Logs if two different names share a hash
+    AssetId InternAssetName(std::string_view name);
+
+    //Returns the interned name of the ID, or an empty string if it was never interned
+    const std::string& GetAssetName(AssetId id);
+}
@@ -0,0 +1,122 @@
+#include "jobSystem.h"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace BlitzenEngine
+{
+    JobSystem::JobSystem()
+    {
+        uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        m_workers.reserve(hardwareThreads - 1);
+        for(uint32_t i = 0; i + 1 < hardwareThreads; ++i)
+        {
+            m_workers.emplace_back(&JobSystem::WorkerLoop, this);
+        }
+    }
+
+    void JobSystem::WorkerLoop()
+    {
+        while(true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_jobMutex);
+                m_jobCondition.wait(lock, [this]() {return m_bShuttingDown || !m_jobs.empty();});
+                if(m_bShuttingDown && m_jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    void JobSystem::ParallelFor(size_t count, const std::function<void(size_t)>& function)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+
+        //Not worth waking up the workers for a single call
+        if(count == 1 || m_workers.empty())
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                function(i);
+            }
+            return;
+        }
+
+        /*-----------------------------------------------------------------------------------------------
+        Every thread that joins in grabs the next index until none are left. The state is shared, since
+        a worker might only pick up its job after the caller has already returned
+        ------------------------------------------------------------------------------------------------*/
+        struct ParallelForState
+        {
+            std::function<void(size_t)> function;
+            size_t count;
+            std::atomic<size_t> nextIndex{0};
+            std::atomic<size_t> finishedCount{0};
+            std::mutex doneMutex;
+            std::condition_variable doneCondition;
+        };
+        std::shared_ptr<ParallelForState> pState = std::make_shared<ParallelForState>();
+        pState->function = function;
+        pState->count = count;
+
+        auto runIndices = [](ParallelForState& state)
+        {
+            for(size_t i = state.nextIndex++; i < state.count; i = state.nextIndex++)
+            {
+                state.function(i);
+                if(++state.finishedCount == state.count)
+                {
+                    std::lock_guard<std::mutex> lock(state.doneMutex);
+                    state.doneCondition.notify_all();
+                }
+            }
+        };
+
+        size_t helperCount = std::min(m_workers.size(), count - 1);
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            for(size_t i = 0; i < helperCount; ++i)
+            {
+                m_jobs.push_back([pState, runIndices]() {runIndices(*pState);});
+            }
+        }
+        m_jobCondition.notify_all();
+
+        //The caller works as well, so a ParallelFor inside a job never waits on jobs that no one will run
+        runIndices(*pState);
+
+        std::unique_lock<std::mutex> lock(pState->doneMutex);
+        pState->doneCondition.wait(lock, [&pState]() {return pState->finishedCount == pState->count;});
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_jobMutex);
+            m_bShuttingDown = true;
+        }
+        m_jobCondition.notify_all();
+
+        for(std::thread& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    JobSystem& GetJobSystem()
+    {
+        static JobSystem jobSystem;
+        return jobSystem;
+    }
+}
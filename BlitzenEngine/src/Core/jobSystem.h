@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace BlitzenEngine
+{
+    /*---------------------------------------------------------------------------------------------------
+    A pool of worker threads that engine systems can split their work on. The workers are created the
+    first time the job system is accessed and live until the engine shuts down
+    ----------------------------------------------------------------------------------------------------*/
+    class JobSystem
+    {
+    public:
+        //Creates one worker per hardware thread, minus the one that the caller of ParallelFor runs on
+        JobSystem();
+
+        /*------------------------------------------------------------------------------------------
+        Calls function once for every index in [0, count), spread across the workers and the calling
+        thread. Returns when every call has finished. It is safe to call this from inside a job
+        -------------------------------------------------------------------------------------------*/
+        void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+        //The number of threads that ParallelFor can run on at the same time, including the caller
+        inline uint32_t GetThreadCount() const {return static_cast<uint32_t>(m_workers.size()) + 1;}
+
+        ~JobSystem();
+
+        JobSystem(const JobSystem& jobSystem) = delete;
+        JobSystem& operator = (const JobSystem& jobSystem) = delete;
+
+    private:
+
+        //The loop that every worker runs, waiting for jobs and executing them
+        void WorkerLoop();
+
+    private:
+
+        std::vector<std::thread> m_workers;
+
+        //Jobs waiting for a worker, every ParallelFor pushes one job per worker that can help it
+        std::deque<std::function<void()>> m_jobs;
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobCondition;
+
+        bool m_bShuttingDown = false;
+    };
+
+    //Returns the engine wide job system
+    JobSystem& GetJobSystem();
+}
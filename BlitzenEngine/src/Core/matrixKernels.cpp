@@ -0,0 +1,354 @@
+#include "matrixKernels.h"
+
+#ifdef BLITZEN_MATRIX_BENCHMARK
+    #include <chrono>
+    #include <iostream>
+    #include <vector>
+    #include <random>
+#endif
+
+/*-------------------------------------------------------------------------------------------------------
+The SIMD kernels are only built for x86. GCC and Clang need every function that uses an instruction set
+beyond the compiler's baseline to be marked with it, MSVC lets any function use the intrinsics
+--------------------------------------------------------------------------------------------------------*/
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+    #define BLITZEN_MATRIX_KERNELS_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define BLITZEN_TARGET_SSE
+        #define BLITZEN_TARGET_AVX2
+    #else
+        #include <cpuid.h>
+        #define BLITZEN_TARGET_SSE      __attribute__((target("sse")))
+        #define BLITZEN_TARGET_AVX2     __attribute__((target("avx2,fma")))
+    #endif
+#endif
+
+namespace BlitzenEngine
+{
+    static void MultiplyMatricesScalar(glm::mat4* pResults, const glm::mat4* pLeft, size_t leftStride,
+    const glm::mat4* pRight, size_t rightStride, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i)
+        {
+            pResults[i] = pLeft[i * leftStride] * pRight[i * rightStride];
+        }
+    }
+
+    static void PropagateWorldTransformsScalar(glm::mat4* pWorldTransforms, const glm::mat4* pLocalTransforms,
+    const uint32_t* pParents, size_t first, size_t count)
+    {
+        for(size_t i = first; i < first + count; ++i)
+        {
+            pWorldTransforms[i] = pParents[i] == UINT32_MAX ? pLocalTransforms[i] :
+            pWorldTransforms[pParents[i]] * pLocalTransforms[i];
+        }
+    }
+
+    #ifdef BLITZEN_MATRIX_KERNELS_X86
+
+        /*-----------------------------------------------------------------------------------------------
+        glm matrices are 16 floats in column major order. Column j of the result is the sum of the left
+        matrix's columns, each scaled by one component of the right matrix's column j, so every column
+        is four broadcasts and four multiply adds of whole columns
+        ------------------------------------------------------------------------------------------------*/
+        BLITZEN_TARGET_SSE static inline void MultiplyMatrixSSE(float* pResult, const float* pLeft, const float* pRight)
+        {
+            __m128 left0 = _mm_loadu_ps(pLeft);
+            __m128 left1 = _mm_loadu_ps(pLeft + 4);
+            __m128 left2 = _mm_loadu_ps(pLeft + 8);
+            __m128 left3 = _mm_loadu_ps(pLeft + 12);
+            for(int column = 0; column < 4; ++column)
+            {
+                __m128 right = _mm_loadu_ps(pRight + column * 4);
+                __m128 result = _mm_mul_ps(left0, _mm_shuffle_ps(right, right, 0x00));
+                result = _mm_add_ps(result, _mm_mul_ps(left1, _mm_shuffle_ps(right, right, 0x55)));
+                result = _mm_add_ps(result, _mm_mul_ps(left2, _mm_shuffle_ps(right, right, 0xAA)));
+                result = _mm_add_ps(result, _mm_mul_ps(left3, _mm_shuffle_ps(right, right, 0xFF)));
+                _mm_storeu_ps(pResult + column * 4, result);
+            }
+        }
+
+        BLITZEN_TARGET_SSE static void MultiplyMatricesSSE(glm::mat4* pResults, const glm::mat4* pLeft, size_t leftStride,
+        const glm::mat4* pRight, size_t rightStride, size_t count)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                MultiplyMatrixSSE(&pResults[i][0][0], &pLeft[i * leftStride][0][0], &pRight[i * rightStride][0][0]);
+            }
+        }
+
+        BLITZEN_TARGET_SSE static void PropagateWorldTransformsSSE(glm::mat4* pWorldTransforms,
+        const glm::mat4* pLocalTransforms, const uint32_t* pParents, size_t first, size_t count)
+        {
+            for(size_t i = first; i < first + count; ++i)
+            {
+                if(pParents[i] == UINT32_MAX)
+                {
+                    pWorldTransforms[i] = pLocalTransforms[i];
+                    continue;
+                }
+                MultiplyMatrixSSE(&pWorldTransforms[i][0][0], &pWorldTransforms[pParents[i]][0][0],
+                &pLocalTransforms[i][0][0]);
+            }
+        }
+
+        //The same as the SSE kernel with two columns of the result in every 256 bit register
+        BLITZEN_TARGET_AVX2 static inline void MultiplyMatrixAVX2(float* pResult, const float* pLeft, const float* pRight)
+        {
+            __m256 left0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pLeft));
+            __m256 left1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pLeft + 4));
+            __m256 left2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pLeft + 8));
+            __m256 left3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pLeft + 12));
+            for(int column = 0; column < 4; column += 2)
+            {
+                __m256 right = _mm256_loadu_ps(pRight + column * 4);
+                __m256 result = _mm256_mul_ps(left0, _mm256_shuffle_ps(right, right, 0x00));
+                result = _mm256_fmadd_ps(left1, _mm256_shuffle_ps(right, right, 0x55), result);
+                result = _mm256_fmadd_ps(left2, _mm256_shuffle_ps(right, right, 0xAA), result);
+                result = _mm256_fmadd_ps(left3, _mm256_shuffle_ps(right, right, 0xFF), result);
+                _mm256_storeu_ps(pResult + column * 4, result);
+            }
+        }
+
+        BLITZEN_TARGET_AVX2 static void MultiplyMatricesAVX2(glm::mat4* pResults, const glm::mat4* pLeft,
+        size_t leftStride, const glm::mat4* pRight, size_t rightStride, size_t count)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                MultiplyMatrixAVX2(&pResults[i][0][0], &pLeft[i * leftStride][0][0], &pRight[i * rightStride][0][0]);
+            }
+        }
+
+        BLITZEN_TARGET_AVX2 static void PropagateWorldTransformsAVX2(glm::mat4* pWorldTransforms,
+        const glm::mat4* pLocalTransforms, const uint32_t* pParents, size_t first, size_t count)
+        {
+            for(size_t i = first; i < first + count; ++i)
+            {
+                if(pParents[i] == UINT32_MAX)
+                {
+                    pWorldTransforms[i] = pLocalTransforms[i];
+                    continue;
+                }
+                MultiplyMatrixAVX2(&pWorldTransforms[i][0][0], &pWorldTransforms[pParents[i]][0][0],
+                &pLocalTransforms[i][0][0]);
+            }
+        }
+
+        static void GetCpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+        {
+            #ifdef _MSC_VER
+                int values[4];
+                __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+                for(int i = 0; i < 4; ++i)
+                {
+                    registers[i] = static_cast<uint32_t>(values[i]);
+                }
+            #else
+                if(!__get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]))
+                {
+                    registers[0] = registers[1] = registers[2] = registers[3] = 0;
+                }
+            #endif
+        }
+
+        //AVX registers are only usable if the OS saves them on context switches, which XGETBV reports
+        static uint64_t GetEnabledRegisterStates()
+        {
+            #ifdef _MSC_VER
+                return _xgetbv(0);
+            #else
+                uint32_t low, high;
+                __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+                return (static_cast<uint64_t>(high) << 32) | low;
+            #endif
+        }
+
+        static MatrixKernelLevel DetectMatrixKernelLevel()
+        {
+            uint32_t registers[4];
+            GetCpuid(0, 0, registers);
+            uint32_t maxLeaf = registers[0];
+            if(maxLeaf < 1)
+            {
+                return MatrixKernelLevel::MKL_Scalar;
+            }
+
+            GetCpuid(1, 0, registers);
+            bool bSSE = registers[3] & (1u << 25);
+            bool bFMA = registers[2] & (1u << 12);
+            bool bOSXSAVE = registers[2] & (1u << 27);
+            bool bAVX = registers[2] & (1u << 28);
+            bool bAVX2 = false;
+            if(maxLeaf >= 7)
+            {
+                GetCpuid(7, 0, registers);
+                bAVX2 = registers[1] & (1u << 5);
+            }
+
+            //Both the SSE and the AVX state need to be enabled
+            if(bOSXSAVE && bAVX && bAVX2 && bFMA && (GetEnabledRegisterStates() & 0x6) == 0x6)
+            {
+                return MatrixKernelLevel::MKL_AVX2;
+            }
+            return bSSE ? MatrixKernelLevel::MKL_SSE : MatrixKernelLevel::MKL_Scalar;
+        }
+
+    #else
+
+        static MatrixKernelLevel DetectMatrixKernelLevel()
+        {
+            return MatrixKernelLevel::MKL_Scalar;
+        }
+
+    #endif
+
+    MatrixKernelLevel GetMatrixKernelLevel()
+    {
+        static const MatrixKernelLevel s_level = DetectMatrixKernelLevel();
+        return s_level;
+    }
+
+    const char* GetMatrixKernelName(MatrixKernelLevel level)
+    {
+        switch(level)
+        {
+            case MatrixKernelLevel::MKL_SSE:
+                return "SSE";
+            case MatrixKernelLevel::MKL_AVX2:
+                return "AVX2";
+            default:
+                return "Scalar";
+        }
+    }
+
+    void MultiplyMatrices(MatrixKernelLevel level, glm::mat4* pResults, const glm::mat4* pLeft, size_t leftStride,
+    const glm::mat4* pRight, size_t rightStride, size_t count)
+    {
+        #ifdef BLITZEN_MATRIX_KERNELS_X86
+            switch(level)
+            {
+                case MatrixKernelLevel::MKL_AVX2:
+                    MultiplyMatricesAVX2(pResults, pLeft, leftStride, pRight, rightStride, count);
+                    return;
+                case MatrixKernelLevel::MKL_SSE:
+                    MultiplyMatricesSSE(pResults, pLeft, leftStride, pRight, rightStride, count);
+                    return;
+                default:
+                    break;
+            }
+        #endif
+        MultiplyMatricesScalar(pResults, pLeft, leftStride, pRight, rightStride, count);
+    }
+
+    void PropagateWorldTransforms(MatrixKernelLevel level, glm::mat4* pWorldTransforms,
+    const glm::mat4* pLocalTransforms, const uint32_t* pParents, size_t first, size_t count)
+    {
+        #ifdef BLITZEN_MATRIX_KERNELS_X86
+            switch(level)
+            {
+                case MatrixKernelLevel::MKL_AVX2:
+                    PropagateWorldTransformsAVX2(pWorldTransforms, pLocalTransforms, pParents, first, count);
+                    return;
+                case MatrixKernelLevel::MKL_SSE:
+                    PropagateWorldTransformsSSE(pWorldTransforms, pLocalTransforms, pParents, first, count);
+                    return;
+                default:
+                    break;
+            }
+        #endif
+        PropagateWorldTransformsScalar(pWorldTransforms, pLocalTransforms, pParents, first, count);
+    }
+
+    void MultiplyMatrices(glm::mat4* pResults, const glm::mat4* pLeft, size_t leftStride,
+    const glm::mat4* pRight, size_t rightStride, size_t count)
+    {
+        MultiplyMatrices(GetMatrixKernelLevel(), pResults, pLeft, leftStride, pRight, rightStride, count);
+    }
+
+    void PropagateWorldTransforms(glm::mat4* pWorldTransforms, const glm::mat4* pLocalTransforms,
+    const uint32_t* pParents, size_t first, size_t count)
+    {
+        PropagateWorldTransforms(GetMatrixKernelLevel(), pWorldTransforms, pLocalTransforms, pParents, first, count);
+    }
+
+    #ifdef BLITZEN_MATRIX_BENCHMARK
+        void BenchmarkMatrixKernels(size_t matrixCount, size_t iterations)
+        {
+            //Random affine matrices, a hierarchy where every node's parent is any node before it
+            std::mt19937 random(1234);
+            std::uniform_real_distribution<float> distribution(-2.f, 2.f);
+            std::vector<glm::mat4> left(matrixCount), right(matrixCount), reference(matrixCount), results(matrixCount);
+            std::vector<uint32_t> parents(matrixCount);
+            for(size_t i = 0; i < matrixCount; ++i)
+            {
+                for(int column = 0; column < 4; ++column)
+                {
+                    for(int row = 0; row < 3; ++row)
+                    {
+                        left[i][column][row] = distribution(random);
+                        right[i][column][row] = distribution(random) * 0.5f;
+                    }
+                    left[i][column][3] = column == 3 ? 1.f : 0.f;
+                    right[i][column][3] = column == 3 ? 1.f : 0.f;
+                }
+                parents[i] = i ? static_cast<uint32_t>(random() % i) : UINT32_MAX;
+            }
+            glm::mat4 topMatrix = left[0];
+
+            //glm's operator is the reference and the baseline
+            auto start = std::chrono::high_resolution_clock::now();
+            for(size_t iteration = 0; iteration < iterations; ++iteration)
+            {
+                for(size_t i = 0; i < matrixCount; ++i)
+                {
+                    reference[i] = topMatrix * right[i];
+                }
+            }
+            double glmTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() -
+            start).count() / double(matrixCount * iterations);
+            std::cout << "Matrix kernels: glm -> " << glmTime << " ns per matrix\n";
+
+            for(uint8_t l = 0; l < static_cast<uint8_t>(MatrixKernelLevel::MKL_Count); ++l)
+            {
+                MatrixKernelLevel level = static_cast<MatrixKernelLevel>(l);
+                if(level > GetMatrixKernelLevel())
+                {
+                    break;
+                }
+
+                start = std::chrono::high_resolution_clock::now();
+                for(size_t iteration = 0; iteration < iterations; ++iteration)
+                {
+                    MultiplyMatrices(level, results.data(), &topMatrix, 0, right.data(), 1, matrixCount);
+                }
+                double multiplyTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() -
+                start).count() / double(matrixCount * iterations);
+
+                float maxDifference = 0.f;
+                for(size_t i = 0; i < matrixCount; ++i)
+                {
+                    for(int column = 0; column < 4; ++column)
+                    {
+                        glm::vec4 difference = glm::abs(results[i][column] - reference[i][column]);
+                        maxDifference = glm::max(maxDifference, glm::max(glm::max(difference.x, difference.y),
+                        glm::max(difference.z, difference.w)));
+                    }
+                }
+
+                start = std::chrono::high_resolution_clock::now();
+                for(size_t iteration = 0; iteration < iterations; ++iteration)
+                {
+                    PropagateWorldTransforms(level, results.data(), right.data(), parents.data(), 0, matrixCount);
+                }
+                double propagateTime = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() -
+                start).count() / double(matrixCount * iterations);
+
+                std::cout << "Matrix kernels: " << GetMatrixKernelName(level) << " -> multiply " << multiplyTime
+                << " ns per matrix (" << glmTime / multiplyTime << "x glm), propagate " << propagateTime
+                << " ns per node, max difference from glm " << maxDifference << '\n';
+            }
+        }
+    #endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+namespace BlitzenEngine
+{
+    //The instruction sets that the matrix kernels can run on, the best one the CPU supports is picked at startup
+    enum class MatrixKernelLevel : uint8_t
+    {
+        MKL_Scalar,
+        MKL_SSE,
+        MKL_AVX2,
+
+        MKL_Count
+    };
+
+    //The kernel level that the functions below dispatch to
+    MatrixKernelLevel GetMatrixKernelLevel();
+    const char* GetMatrixKernelName(MatrixKernelLevel level);
+
+    /*---------------------------------------------------------------------------------------------------
+    Multiplies count pairs of matrices, pResults[i] = pLeft[i * leftStride] * pRight[i * rightStride].
+    A stride of 0 multiplies every matrix of the other array by the same one, like the top matrix of a draw.
+    The results must not overlap the inputs
+    ----------------------------------------------------------------------------------------------------*/
+    void MultiplyMatrices(glm::mat4* pResults, const glm::mat4* pLeft, size_t leftStride,
+    const glm::mat4* pRight, size_t rightStride, size_t count);
+
+    /*---------------------------------------------------------------------------------------------------
+    Computes the world transforms of the nodes [first, first + count) of a hierarchy whose parents come
+    before their children. Nodes without a parent (UINT32_MAX) copy their local transform. Nodes are
+    processed in order, so parents inside the range are done before their children read them
+    ----------------------------------------------------------------------------------------------------*/
+    void PropagateWorldTransforms(glm::mat4* pWorldTransforms, const glm::mat4* pLocalTransforms,
+    const uint32_t* pParents, size_t first, size_t count);
+
+    //Same as the functions above, at the given level instead of the dispatched one. Used to compare the kernels
+    void MultiplyMatrices(MatrixKernelLevel level, glm::mat4* pResults, const glm::mat4* pLeft, size_t leftStride,
+    const glm::mat4* pRight, size_t rightStride, size_t count);
+    void PropagateWorldTransforms(MatrixKernelLevel level, glm::mat4* pWorldTransforms,
+    const glm::mat4* pLocalTransforms, const uint32_t* pParents, size_t first, size_t count);
+
+    #ifdef BLITZEN_MATRIX_BENCHMARK
+        /*-----------------------------------------------------------------------------------------------
+        Times every kernel level that the CPU supports against glm's operator on arrays of the given
+        size, checks that they agree and logs the results
+        ------------------------------------------------------------------------------------------------*/
+        void BenchmarkMatrixKernels(size_t matrixCount, size_t iterations);
+    #endif
+}
@@ -0,0 +1,75 @@
+#include "radixSort.h"
+
+#include <cstring>
+
+namespace BlitzenEngine
+{
+    #define BLITZEN_RADIX_BITS          8
+    #define BLITZEN_RADIX_BUCKETS       (1 << BLITZEN_RADIX_BITS)
+    #define BLITZEN_RADIX_PASSES        (64 / BLITZEN_RADIX_BITS)
+
+    void RadixSortKeys(uint64_t* pKeys, uint32_t* pValues, uint64_t* pScratchKeys, uint32_t* pScratchValues,
+    size_t count)
+    {
+        if(count < 2)
+        {
+            return;
+        }
+
+        //The histograms of every byte are counted in a single read of the keys
+        size_t histograms[BLITZEN_RADIX_PASSES][BLITZEN_RADIX_BUCKETS] = {};
+        for(size_t i = 0; i < count; ++i)
+        {
+            uint64_t key = pKeys[i];
+            for(int pass = 0; pass < BLITZEN_RADIX_PASSES; ++pass)
+            {
+                ++histograms[pass][(key >> (pass * BLITZEN_RADIX_BITS)) & (BLITZEN_RADIX_BUCKETS - 1)];
+            }
+        }
+
+        uint64_t* pSourceKeys = pKeys;
+        uint32_t* pSourceValues = pValues;
+        uint64_t* pDestinationKeys = pScratchKeys;
+        uint32_t* pDestinationValues = pScratchValues;
+        for(int pass = 0; pass < BLITZEN_RADIX_PASSES; ++pass)
+        {
+            //When every key has the same byte, the pass would copy the keys without changing their order
+            size_t* pHistogram = histograms[pass];
+            uint32_t shift = pass * BLITZEN_RADIX_BITS;
+            if(pHistogram[(pSourceKeys[0] >> shift) & (BLITZEN_RADIX_BUCKETS - 1)] == count)
+            {
+                continue;
+            }
+
+            //Turns the counts into the place where each bucket starts
+            size_t offset = 0;
+            for(int bucket = 0; bucket < BLITZEN_RADIX_BUCKETS; ++bucket)
+            {
+                size_t bucketCount = pHistogram[bucket];
+                pHistogram[bucket] = offset;
+                offset += bucketCount;
+            }
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                size_t destination = pHistogram[(pSourceKeys[i] >> shift) & (BLITZEN_RADIX_BUCKETS - 1)]++;
+                pDestinationKeys[destination] = pSourceKeys[i];
+                pDestinationValues[destination] = pSourceValues[i];
+            }
+
+            uint64_t* pKeySwap = pSourceKeys;
+            pSourceKeys = pDestinationKeys;
+            pDestinationKeys = pKeySwap;
+            uint32_t* pValueSwap = pSourceValues;
+            pSourceValues = pDestinationValues;
+            pDestinationValues = pValueSwap;
+        }
+
+        //An odd number of passes leaves the sorted keys in the scratch arrays
+        if(pSourceKeys != pKeys)
+        {
+            memcpy(pKeys, pSourceKeys, count * sizeof(uint64_t));
+            memcpy(pValues, pSourceValues, count * sizeof(uint32_t));
+        }
+    }
+}
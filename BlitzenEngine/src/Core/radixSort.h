@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace BlitzenEngine
+{
+    /*---------------------------------------------------------------------------------------------------
+    Sorts the keys in increasing order and moves every value along with its key. The sort is stable, keys
+    that are equal keep the order that they came in. It goes over the keys one byte at a time, from the
+    least significant byte up, and skips bytes that are the same in every key, so keys that only use a few
+    of their bits take fewer passes. The scratch arrays need room for count elements
+    ----------------------------------------------------------------------------------------------------*/
+    void RadixSortKeys(uint64_t* pKeys, uint32_t* pValues, uint64_t* pScratchKeys, uint32_t* pScratchValues,
+    size_t count);
+}
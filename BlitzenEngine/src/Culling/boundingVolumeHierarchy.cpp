@@ -0,0 +1,683 @@
+#include "boundingVolumeHierarchy.h"
+#include "Core/jobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace BlitzenEngine
+{
+    //Marks the parent of the root
+    #define BLITZEN_BVH_NO_NODE         0xFFFFFFFF
+
+    //The bounds of a range's spheres and of their centers
+    struct BvhRangeBounds
+    {
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+        glm::vec3 centerMin{std::numeric_limits<float>::max()};
+        glm::vec3 centerMax{-std::numeric_limits<float>::max()};
+    };
+
+    struct BvhBin
+    {
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+        uint32_t count = 0;
+    };
+
+    //The bins of all three axes, one after the other
+    using BvhBins = std::array<BvhBin, BLITZEN_BVH_BIN_COUNT * 3>;
+
+    static inline glm::vec3 GetSphereCenter(const BoundingSpheres& spheres, uint32_t object)
+    {
+        return glm::vec3(spheres.centerX[object], spheres.centerY[object], spheres.centerZ[object]);
+    }
+
+    //Half of the surface area of a box, only the ratios between areas are ever used
+    static inline float GetBoxArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        glm::vec3 extent = boundsMax - boundsMin;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    static BvhRangeBounds GetRangeBounds(const BvhBuildObject* pObjects, uint32_t begin, uint32_t end)
+    {
+        BvhRangeBounds bounds;
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            const BvhBuildObject& object = pObjects[i];
+            bounds.boundsMin = glm::min(bounds.boundsMin, object.center - object.radius);
+            bounds.boundsMax = glm::max(bounds.boundsMax, object.center + object.radius);
+            bounds.centerMin = glm::min(bounds.centerMin, object.center);
+            bounds.centerMax = glm::max(bounds.centerMax, object.center);
+        }
+        return bounds;
+    }
+
+    //The same scale has to be used to bin the centers and to partition them, so that both agree on every bin
+    static inline uint32_t GetBinIndex(float center, float centerMin, float binScale)
+    {
+        int32_t bin = static_cast<int32_t>((center - centerMin) * binScale);
+        return static_cast<uint32_t>(std::min(std::max(bin, 0), BLITZEN_BVH_BIN_COUNT - 1));
+    }
+
+    static void FillBins(const BvhBuildObject* pObjects, uint32_t begin, uint32_t end, const glm::vec3& centerMin,
+    const glm::vec3& binScale, BvhBins& bins)
+    {
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            const BvhBuildObject& object = pObjects[i];
+            glm::vec3 objectMin = object.center - object.radius;
+            glm::vec3 objectMax = object.center + object.radius;
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                BvhBin& bin = bins[axis * BLITZEN_BVH_BIN_COUNT + 
+                GetBinIndex(object.center[axis], centerMin[axis], binScale[axis])];
+                bin.boundsMin = glm::min(bin.boundsMin, objectMin);
+                bin.boundsMax = glm::max(bin.boundsMax, objectMax);
+                ++bin.count;
+            }
+        }
+    }
+
+    uint32_t BoundingVolumeHierarchy::SplitRange(uint32_t begin, uint32_t end, BvhNode& node, bool bParallel)
+    {
+        uint32_t count = end - begin;
+        const BvhBuildObject* pObjects = m_buildObjects.data();
+        uint32_t chunkCount = bParallel ? (count + BLITZEN_BVH_PARALLEL_CHUNK_SIZE - 1) / BLITZEN_BVH_PARALLEL_CHUNK_SIZE : 1;
+        auto GetChunkBegin = [&](size_t chunk) {return begin + static_cast<uint32_t>(chunk) * BLITZEN_BVH_PARALLEL_CHUNK_SIZE;};
+        auto GetChunkEnd = [&](size_t chunk) {return std::min(GetChunkBegin(chunk) + BLITZEN_BVH_PARALLEL_CHUNK_SIZE, end);};
+
+        //Each chunk finds its own bounds and bins, they are merged once every chunk is done
+        BvhRangeBounds bounds;
+        if(chunkCount > 1)
+        {
+            std::vector<BvhRangeBounds> chunkBounds(chunkCount);
+            GetJobSystem().ParallelFor(chunkCount, [&](size_t chunk)
+            {
+                chunkBounds[chunk] = GetRangeBounds(pObjects, GetChunkBegin(chunk), GetChunkEnd(chunk));
+            });
+            for(const BvhRangeBounds& chunk : chunkBounds)
+            {
+                bounds.boundsMin = glm::min(bounds.boundsMin, chunk.boundsMin);
+                bounds.boundsMax = glm::max(bounds.boundsMax, chunk.boundsMax);
+                bounds.centerMin = glm::min(bounds.centerMin, chunk.centerMin);
+                bounds.centerMax = glm::max(bounds.centerMax, chunk.centerMax);
+            }
+        }
+        else
+        {
+            bounds = GetRangeBounds(pObjects, begin, end);
+        }
+        node.boundsMin = bounds.boundsMin;
+        node.boundsMax = bounds.boundsMax;
+        if(count == 1)
+        {
+            return 0;
+        }
+
+        //Axes that every center is on the same point of are not split
+        glm::vec3 centerExtent = bounds.centerMax - bounds.centerMin;
+        glm::vec3 binScale(0.f);
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            if(centerExtent[axis] > 0.f)
+            {
+                binScale[axis] = BLITZEN_BVH_BIN_COUNT * 0.9999f / centerExtent[axis];
+            }
+        }
+
+        BvhBins bins;
+        if(chunkCount > 1)
+        {
+            std::vector<BvhBins> chunkBins(chunkCount);
+            GetJobSystem().ParallelFor(chunkCount, [&](size_t chunk)
+            {
+                FillBins(pObjects, GetChunkBegin(chunk), GetChunkEnd(chunk), bounds.centerMin, binScale, chunkBins[chunk]);
+            });
+            for(const BvhBins& chunk : chunkBins)
+            {
+                for(size_t bin = 0; bin < bins.size(); ++bin)
+                {
+                    bins[bin].boundsMin = glm::min(bins[bin].boundsMin, chunk[bin].boundsMin);
+                    bins[bin].boundsMax = glm::max(bins[bin].boundsMax, chunk[bin].boundsMax);
+                    bins[bin].count += chunk[bin].count;
+                }
+            }
+        }
+        else
+        {
+            FillBins(pObjects, begin, end, bounds.centerMin, binScale, bins);
+        }
+
+        /*------------------------------------------------------------------------------------------------
+        The cost of a split is the cost of visiting the node plus the cost of testing the objects of each
+        side, weighed by how likely a query that reaches the node is to reach that side. The right sides
+        are swept first so that every split between two bins is found with a single sweep from the left
+        -------------------------------------------------------------------------------------------------*/
+        float nodeArea = GetBoxArea(bounds.boundsMin, bounds.boundsMax);
+        float inverseNodeArea = nodeArea > 0.f ? 1.f / nodeArea : 0.f;
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            if(binScale[axis] == 0.f)
+            {
+                continue;
+            }
+
+            const BvhBin* pBins = bins.data() + axis * BLITZEN_BVH_BIN_COUNT;
+            float rightAreas[BLITZEN_BVH_BIN_COUNT];
+            uint32_t rightCounts[BLITZEN_BVH_BIN_COUNT];
+            BvhBin right;
+            for(uint32_t bin = BLITZEN_BVH_BIN_COUNT - 1; bin > 0; --bin)
+            {
+                right.boundsMin = glm::min(right.boundsMin, pBins[bin].boundsMin);
+                right.boundsMax = glm::max(right.boundsMax, pBins[bin].boundsMax);
+                right.count += pBins[bin].count;
+                rightAreas[bin] = right.count ? GetBoxArea(right.boundsMin, right.boundsMax) : 0.f;
+                rightCounts[bin] = right.count;
+            }
+
+            BvhBin left;
+            for(uint32_t split = 1; split < BLITZEN_BVH_BIN_COUNT; ++split)
+            {
+                left.boundsMin = glm::min(left.boundsMin, pBins[split - 1].boundsMin);
+                left.boundsMax = glm::max(left.boundsMax, pBins[split - 1].boundsMax);
+                left.count += pBins[split - 1].count;
+                if(!left.count || !rightCounts[split])
+                {
+                    continue;
+                }
+
+                float cost = BLITZEN_BVH_TRAVERSAL_COST + (GetBoxArea(left.boundsMin, left.boundsMax) * left.count +
+                rightAreas[split] * rightCounts[split]) * inverseNodeArea;
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        //Small nodes stay leaves when testing all of their objects costs less than splitting them
+        if(count <= BLITZEN_BVH_MAX_LEAF_SIZE && (bestAxis < 0 || static_cast<float>(count) <= bestCost))
+        {
+            return 0;
+        }
+
+        //Centers that all share a bin cannot be split by the bins, the range is split in the middle instead
+        uint32_t middle = begin + count / 2;
+        if(bestAxis < 0)
+        {
+            return middle;
+        }
+
+        float axisMin = bounds.centerMin[bestAxis];
+        float axisScale = binScale[bestAxis];
+        BvhBuildObject* pSplit = std::partition(m_buildObjects.data() + begin, m_buildObjects.data() + end, 
+        [&](const BvhBuildObject& object)
+        {
+            return GetBinIndex(object.center[bestAxis], axisMin, axisScale) < bestSplit;
+        });
+        uint32_t split = static_cast<uint32_t>(pSplit - m_buildObjects.data());
+        return split > begin && split < end ? split : middle;
+    }
+
+    void BoundingVolumeHierarchy::SplitRanges(std::vector<BuildRange>& ranges, std::vector<BvhNode>& nodes,
+    uint32_t subtreeSize, std::vector<BuildRange>* pSubtrees)
+    {
+        while(!ranges.empty())
+        {
+            BuildRange range = ranges.back();
+            ranges.pop_back();
+            if(pSubtrees && range.end - range.begin <= subtreeSize)
+            {
+                pSubtrees->push_back(range);
+                continue;
+            }
+
+            //The node is copied since adding its children may move the nodes
+            BvhNode node;
+            uint32_t split = SplitRange(range.begin, range.end, node, pSubtrees != nullptr);
+            if(!split)
+            {
+                node.first = range.begin;
+                node.objectCount = range.end - range.begin;
+                nodes[range.node] = node;
+                continue;
+            }
+
+            node.first = static_cast<uint32_t>(nodes.size());
+            node.objectCount = 0;
+            nodes[range.node] = node;
+            nodes.push_back(BvhNode());
+            nodes.push_back(BvhNode());
+            ranges.push_back({node.first, range.begin, split});
+            ranges.push_back({node.first + 1, split, range.end});
+        }
+    }
+
+    void BoundingVolumeHierarchy::Build(const BoundingSpheres& spheres)
+    {
+        uint32_t objectCount = static_cast<uint32_t>(spheres.GetCount());
+        m_buildObjects.resize(objectCount);
+        for(uint32_t object = 0; object < objectCount; ++object)
+        {
+            m_buildObjects[object] = {GetSphereCenter(spheres, object), spheres.radius[object], object};
+        }
+
+        m_nodes.clear();
+        m_subtreeRanges.clear();
+        if(objectCount)
+        {
+            m_nodes.reserve(static_cast<size_t>(objectCount) * 2);
+            m_nodes.push_back(BvhNode());
+
+            //With a single thread the whole tree is one subtree, and it is built the same way
+            JobSystem& jobSystem = GetJobSystem();
+            uint32_t threadCount = jobSystem.GetThreadCount();
+            uint32_t subtreeSize = threadCount > 1 ?
+            std::max<uint32_t>(BLITZEN_BVH_MIN_SUBTREE_SIZE, objectCount / (threadCount * 4)) : objectCount;
+            std::vector<BuildRange> ranges{{0, 0, objectCount}};
+            SplitRanges(ranges, m_nodes, subtreeSize, &m_subtreeRanges);
+
+            if(m_subtreeNodes.size() < m_subtreeRanges.size())
+            {
+                m_subtreeNodes.resize(m_subtreeRanges.size());
+            }
+            jobSystem.ParallelFor(m_subtreeRanges.size(), [&](size_t subtree)
+            {
+                std::vector<BvhNode>& nodes = m_subtreeNodes[subtree];
+                nodes.assign(1, BvhNode());
+                std::vector<BuildRange> subtreeRanges{{0, m_subtreeRanges[subtree].begin, m_subtreeRanges[subtree].end}};
+                SplitRanges(subtreeRanges, nodes, 0, nullptr);
+            });
+
+            //The first node of every subtree takes the place of its range's node, the rest go after the tree
+            for(size_t subtree = 0; subtree < m_subtreeRanges.size(); ++subtree)
+            {
+                const std::vector<BvhNode>& nodes = m_subtreeNodes[subtree];
+                uint32_t childOffset = static_cast<uint32_t>(m_nodes.size()) - 1;
+                for(size_t i = 0; i < nodes.size(); ++i)
+                {
+                    BvhNode node = nodes[i];
+                    if(!node.objectCount)
+                    {
+                        node.first += childOffset;
+                    }
+                    if(i)
+                    {
+                        m_nodes.push_back(node);
+                    }
+                    else
+                    {
+                        m_nodes[m_subtreeRanges[subtree].node] = node;
+                    }
+                }
+            }
+        }
+
+        m_objects.resize(objectCount);
+        for(uint32_t i = 0; i < objectCount; ++i)
+        {
+            m_objects[i] = m_buildObjects[i].object;
+        }
+
+        LinkNodes();
+        m_builtSurfaceArea = m_surfaceArea;
+    }
+
+    void BoundingVolumeHierarchy::LinkNodes()
+    {
+        m_parents.assign(m_nodes.size(), BLITZEN_BVH_NO_NODE);
+        m_objectLeaves.resize(m_objects.size());
+        m_dirtyNodes.assign(m_nodes.size(), 0);
+
+        double surfaceArea = 0.0;
+        for(uint32_t node = 0; node < static_cast<uint32_t>(m_nodes.size()); ++node)
+        {
+            const BvhNode& bvhNode = m_nodes[node];
+            if(bvhNode.objectCount)
+            {
+                for(uint32_t i = bvhNode.first; i < bvhNode.first + bvhNode.objectCount; ++i)
+                {
+                    m_objectLeaves[m_objects[i]] = node;
+                }
+            }
+            else
+            {
+                m_parents[bvhNode.first] = node;
+                m_parents[bvhNode.first + 1] = node;
+            }
+            surfaceArea += GetBoxArea(bvhNode.boundsMin, bvhNode.boundsMax);
+        }
+        m_surfaceArea = surfaceArea;
+    }
+
+    void BoundingVolumeHierarchy::FitNode(const BoundingSpheres& spheres, uint32_t node)
+    {
+        BvhNode& bvhNode = m_nodes[node];
+        if(bvhNode.objectCount)
+        {
+            bvhNode.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+            bvhNode.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+            for(uint32_t i = bvhNode.first; i < bvhNode.first + bvhNode.objectCount; ++i)
+            {
+                glm::vec3 center = GetSphereCenter(spheres, m_objects[i]);
+                float radius = spheres.radius[m_objects[i]];
+                bvhNode.boundsMin = glm::min(bvhNode.boundsMin, center - radius);
+                bvhNode.boundsMax = glm::max(bvhNode.boundsMax, center + radius);
+            }
+        }
+        else
+        {
+            const BvhNode& left = m_nodes[bvhNode.first];
+            const BvhNode& right = m_nodes[bvhNode.first + 1];
+            bvhNode.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+            bvhNode.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+        }
+    }
+
+    void BoundingVolumeHierarchy::Refit(const BoundingSpheres& spheres, const std::vector<uint32_t>& changedObjects)
+    {
+        if(changedObjects.empty() || m_nodes.empty())
+        {
+            return;
+        }
+
+        //Children always come after their parents, so fitting the nodes from the back fits the children first
+        if(changedObjects.size() * 4 >= m_objects.size())
+        {
+            double surfaceArea = 0.0;
+            for(size_t node = m_nodes.size(); node-- > 0;)
+            {
+                FitNode(spheres, static_cast<uint32_t>(node));
+                surfaceArea += GetBoxArea(m_nodes[node].boundsMin, m_nodes[node].boundsMax);
+            }
+            m_surfaceArea = surfaceArea;
+        }
+        else
+        {
+            //Only the nodes above the changed objects are fitted, the walk up stops at nodes that are already marked
+            m_dirtyList.clear();
+            for(uint32_t object : changedObjects)
+            {
+                if(object >= m_objectLeaves.size())
+                {
+                    continue;
+                }
+                for(uint32_t node = m_objectLeaves[object]; node != BLITZEN_BVH_NO_NODE && !m_dirtyNodes[node];
+                node = m_parents[node])
+                {
+                    m_dirtyNodes[node] = 1;
+                    m_dirtyList.push_back(node);
+                }
+            }
+
+            std::sort(m_dirtyList.begin(), m_dirtyList.end(), std::greater<uint32_t>());
+            for(uint32_t node : m_dirtyList)
+            {
+                m_surfaceArea -= GetBoxArea(m_nodes[node].boundsMin, m_nodes[node].boundsMax);
+                FitNode(spheres, node);
+                m_surfaceArea += GetBoxArea(m_nodes[node].boundsMin, m_nodes[node].boundsMax);
+                m_dirtyNodes[node] = 0;
+            }
+        }
+    }
+
+    bool BoundingVolumeHierarchy::Update(const BoundingSpheres& spheres, const std::vector<uint32_t>& changedObjects)
+    {
+        //Objects that were added or removed are not in the tree, or are in it under an index that no longer exists
+        if(spheres.GetCount() != m_objects.size())
+        {
+            Build(spheres);
+            return true;
+        }
+
+        Refit(spheres, changedObjects);
+        if(m_surfaceArea > m_builtSurfaceArea * BLITZEN_BVH_REBUILD_AREA_RATIO)
+        {
+            Build(spheres);
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t BoundingVolumeHierarchy::CullFrustum(const glm::vec4* pPlanes, const BoundingSpheres& spheres,
+    uint8_t* pVisibility) const
+    {
+        memset(pVisibility, 0, spheres.GetCount());
+        if(m_nodes.empty())
+        {
+            return 0;
+        }
+
+        //Every node on the stack comes with the planes that its parent is not fully inside of
+        constexpr uint32_t allPlanes = (1u << BLITZEN_FRUSTUM_PLANE_COUNT) - 1;
+        std::vector<std::pair<uint32_t, uint32_t>> stack;
+        stack.reserve(64);
+        stack.push_back({0, allPlanes});
+        uint32_t visibleCount = 0;
+        while(!stack.empty())
+        {
+            uint32_t node = stack.back().first;
+            uint32_t planeMask = stack.back().second;
+            stack.pop_back();
+            const BvhNode& bvhNode = m_nodes[node];
+
+            /*--------------------------------------------------------------------------------------------
+            The corner furthest along a plane's normal is the last one to leave it. If even that one is
+            outside the node is skipped, and if the nearest corner is inside the plane no longer needs to be
+            tested below the node
+            ---------------------------------------------------------------------------------------------*/
+            bool bOutside = false;
+            for(int plane = 0; plane < BLITZEN_FRUSTUM_PLANE_COUNT && !bOutside; ++plane)
+            {
+                if(!(planeMask & (1u << plane)))
+                {
+                    continue;
+                }
+                const glm::vec4& p = pPlanes[plane];
+                glm::vec3 furthest(p.x > 0.f ? bvhNode.boundsMax.x : bvhNode.boundsMin.x,
+                p.y > 0.f ? bvhNode.boundsMax.y : bvhNode.boundsMin.y, p.z > 0.f ? bvhNode.boundsMax.z : bvhNode.boundsMin.z);
+                glm::vec3 nearest(p.x > 0.f ? bvhNode.boundsMin.x : bvhNode.boundsMax.x,
+                p.y > 0.f ? bvhNode.boundsMin.y : bvhNode.boundsMax.y, p.z > 0.f ? bvhNode.boundsMin.z : bvhNode.boundsMax.z);
+                bOutside = glm::dot(glm::vec3(p), furthest) + p.w < 0.f;
+                if(glm::dot(glm::vec3(p), nearest) + p.w > 0.f)
+                {
+                    planeMask &= ~(1u << plane);
+                }
+            }
+            if(bOutside)
+            {
+                continue;
+            }
+
+            //Every node covers a single range of the object list, from its leftmost leaf to its rightmost one
+            if(!planeMask)
+            {
+                uint32_t leftmost = node;
+                uint32_t rightmost = node;
+                while(!m_nodes[leftmost].objectCount)
+                {
+                    leftmost = m_nodes[leftmost].first;
+                }
+                while(!m_nodes[rightmost].objectCount)
+                {
+                    rightmost = m_nodes[rightmost].first + 1;
+                }
+                uint32_t end = m_nodes[rightmost].first + m_nodes[rightmost].objectCount;
+                for(uint32_t i = m_nodes[leftmost].first; i < end; ++i)
+                {
+                    pVisibility[m_objects[i]] = 1;
+                }
+                visibleCount += end - m_nodes[leftmost].first;
+            }
+            else if(bvhNode.objectCount)
+            {
+                for(uint32_t i = bvhNode.first; i < bvhNode.first + bvhNode.objectCount; ++i)
+                {
+                    uint32_t object = m_objects[i];
+                    glm::vec4 sphere(GetSphereCenter(spheres, object), spheres.radius[object]);
+                    pVisibility[object] = IsSphereInFrustum(pPlanes, sphere) ? 1 : 0;
+                    visibleCount += pVisibility[object];
+                }
+            }
+            else
+            {
+                stack.push_back({bvhNode.first, planeMask});
+                stack.push_back({bvhNode.first + 1, planeMask});
+            }
+        }
+        return visibleCount;
+    }
+
+    //Finds where a ray enters a box, or returns false if it misses it before the maximum distance
+    static inline bool IntersectRayBox(const glm::vec3& origin, const glm::vec3& inverseDirection,
+    const BvhNode& node, float maxDistance, float& entry)
+    {
+        glm::vec3 toMin = (node.boundsMin - origin) * inverseDirection;
+        glm::vec3 toMax = (node.boundsMax - origin) * inverseDirection;
+        glm::vec3 slabEntry = glm::min(toMin, toMax);
+        glm::vec3 slabExit = glm::max(toMin, toMax);
+        entry = std::max(std::max(slabEntry.x, slabEntry.y), std::max(slabEntry.z, 0.f));
+        float exit = std::min(std::min(slabExit.x, slabExit.y), std::min(slabExit.z, maxDistance));
+        return entry <= exit;
+    }
+
+    uint32_t BoundingVolumeHierarchy::Raycast(const glm::vec3& origin, const glm::vec3& direction,
+    const BoundingSpheres& spheres, float& distance) const
+    {
+        uint32_t hitObject = BLITZEN_BVH_NO_OBJECT;
+        if(m_nodes.empty())
+        {
+            return hitObject;
+        }
+
+        //Directions that are parallel to an axis get a tiny component instead, so that no slab divides 0 by 0
+        glm::vec3 inverseDirection;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            inverseDirection[axis] = 1.f / (direction[axis] != 0.f ? direction[axis] : 1e-30f);
+        }
+
+        //The nearer child is visited first, so that the nodes behind the nearest hit are skipped
+        std::vector<std::pair<uint32_t, float>> stack;
+        stack.reserve(64);
+        float entry;
+        if(IntersectRayBox(origin, inverseDirection, m_nodes[0], distance, entry))
+        {
+            stack.push_back({0, entry});
+        }
+        while(!stack.empty())
+        {
+            uint32_t node = stack.back().first;
+            float nodeEntry = stack.back().second;
+            stack.pop_back();
+            if(nodeEntry > distance)
+            {
+                continue;
+            }
+
+            const BvhNode& bvhNode = m_nodes[node];
+            if(bvhNode.objectCount)
+            {
+                for(uint32_t i = bvhNode.first; i < bvhNode.first + bvhNode.objectCount; ++i)
+                {
+                    uint32_t object = m_objects[i];
+                    float radius = spheres.radius[object];
+                    glm::vec3 toCenter = GetSphereCenter(spheres, object) - origin;
+                    float along = glm::dot(toCenter, direction);
+                    float distanceSquared = glm::dot(toCenter, toCenter) - along * along;
+                    if(distanceSquared > radius * radius)
+                    {
+                        continue;
+                    }
+
+                    float halfChord = std::sqrt(radius * radius - distanceSquared);
+                    if(along + halfChord < 0.f)
+                    {
+                        continue;
+                    }
+                    float hit = std::max(along - halfChord, 0.f);
+                    if(hit < distance)
+                    {
+                        distance = hit;
+                        hitObject = object;
+                    }
+                }
+                continue;
+            }
+
+            float leftEntry, rightEntry;
+            bool bLeft = IntersectRayBox(origin, inverseDirection, m_nodes[bvhNode.first], distance, leftEntry);
+            bool bRight = IntersectRayBox(origin, inverseDirection, m_nodes[bvhNode.first + 1], distance, rightEntry);
+            if(bLeft && bRight && leftEntry < rightEntry)
+            {
+                stack.push_back({bvhNode.first + 1, rightEntry});
+                stack.push_back({bvhNode.first, leftEntry});
+            }
+            else
+            {
+                if(bLeft)
+                {
+                    stack.push_back({bvhNode.first, leftEntry});
+                }
+                if(bRight)
+                {
+                    stack.push_back({bvhNode.first + 1, rightEntry});
+                }
+            }
+        }
+        return hitObject;
+    }
+
+    void BoundingVolumeHierarchy::QueryBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+    const BoundingSpheres& spheres, std::vector<uint32_t>& objects) const
+    {
+        objects.clear();
+        if(m_nodes.empty())
+        {
+            return;
+        }
+
+        std::vector<uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+        while(!stack.empty())
+        {
+            const BvhNode& bvhNode = m_nodes[stack.back()];
+            stack.pop_back();
+            if(glm::any(glm::greaterThan(bvhNode.boundsMin, boundsMax)) ||
+            glm::any(glm::lessThan(bvhNode.boundsMax, boundsMin)))
+            {
+                continue;
+            }
+
+            if(!bvhNode.objectCount)
+            {
+                stack.push_back(bvhNode.first);
+                stack.push_back(bvhNode.first + 1);
+                continue;
+            }
+
+            //A sphere overlaps the box when the point of the box closest to its center is inside of it
+            for(uint32_t i = bvhNode.first; i < bvhNode.first + bvhNode.objectCount; ++i)
+            {
+                uint32_t object = m_objects[i];
+                glm::vec3 center = GetSphereCenter(spheres, object);
+                glm::vec3 offset = center - glm::clamp(center, boundsMin, boundsMax);
+                if(glm::dot(offset, offset) <= spheres.radius[object] * spheres.radius[object])
+                {
+                    objects.push_back(object);
+                }
+            }
+        }
+    }
+}
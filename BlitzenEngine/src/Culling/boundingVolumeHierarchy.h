@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include "frustumCulling.h"
+
+namespace BlitzenEngine
+{
+    //Centroids are sorted into this many bins along every axis to find where a node is split
+    #define BLITZEN_BVH_BIN_COUNT                   16
+    //Nodes with more objects than this are always split
+    #define BLITZEN_BVH_MAX_LEAF_SIZE               8
+    //The cost of visiting a node, relative to the cost of testing an object, weighed by the surface area heuristic
+    #define BLITZEN_BVH_TRAVERSAL_COST              1.f
+
+    //Ranges with at least this many objects have their bounds and bins found in parallel chunks of this size
+    #define BLITZEN_BVH_PARALLEL_CHUNK_SIZE         16384
+    //The nodes near the root are split until every thread has a few subtrees to build, but never below this size
+    #define BLITZEN_BVH_MIN_SUBTREE_SIZE            4096
+
+    /*---------------------------------------------------------------------------------------------------
+    Refitting keeps the tree valid as objects move, but lets it grow looser. It is rebuilt once the
+    surface area of its nodes, which the cost of a query grows with, has grown by this factor since it
+    was built
+    ----------------------------------------------------------------------------------------------------*/
+    #define BLITZEN_BVH_REBUILD_AREA_RATIO          1.5
+
+    //Returned by the queries that look for a single object when they find none
+    #define BLITZEN_BVH_NO_OBJECT                   0xFFFFFFFF
+
+    /*---------------------------------------------------------------------------------------------------
+    A node of the hierarchy. The two children of an interior node are next to each other and always come
+    after it in the array. A leaf holds a range of the hierarchy's object list
+    ----------------------------------------------------------------------------------------------------*/
+    struct BvhNode
+    {
+        glm::vec3 boundsMin;
+        //The first child of an interior node, or the first object of a leaf
+        uint32_t first;
+        glm::vec3 boundsMax;
+        //0 for interior nodes
+        uint32_t objectCount;
+    };
+
+    //An object's sphere, copied next to its index so that the build reads and moves every object as a whole
+    struct BvhBuildObject
+    {
+        glm::vec3 center;
+        float radius;
+        uint32_t object;
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    A bounding volume hierarchy over the bounding spheres of objects, indexed like the spheres. It is
+    built top down with the binned surface area heuristic: the large nodes near the root are split one at
+    a time with their objects binned in parallel, then the subtrees under them are built in parallel.
+
+    The hierarchy only holds boxes, every query is given the spheres that it was built from and tests them
+    at the leaves. When objects move Update refits the nodes above them, and rebuilds the whole tree if the
+    number of objects changed or the refits have made it too loose
+    ----------------------------------------------------------------------------------------------------*/
+    class BoundingVolumeHierarchy
+    {
+    public:
+
+        void Build(const BoundingSpheres& spheres);
+
+        //Recomputes the bounds of the leaves of the changed objects and of every node above them
+        void Refit(const BoundingSpheres& spheres, const std::vector<uint32_t>& changedObjects);
+
+        //Builds or refits the hierarchy as described above, returns true if it was rebuilt
+        bool Update(const BoundingSpheres& spheres, const std::vector<uint32_t>& changedObjects);
+
+        /*-------------------------------------------------------------------------------------------------
+        Does the same as CullSpheres, but skips the nodes that are outside of a plane and does not test the
+        objects of nodes that are inside of every plane. Sets pVisibility[i] to 1 for visible spheres and
+        to 0 for the rest, returns the number of visible spheres
+        --------------------------------------------------------------------------------------------------*/
+        uint32_t CullFrustum(const glm::vec4* pPlanes, const BoundingSpheres& spheres, uint8_t* pVisibility) const;
+
+        /*-------------------------------------------------------------------------------------------------
+        Finds the nearest sphere that a ray hits, within the distance that is passed in. The direction has
+        to be normalized. Returns the object and sets the distance to where the ray enters its sphere, or 0
+        if it starts inside of it. Returns BLITZEN_BVH_NO_OBJECT if the ray hits nothing
+        --------------------------------------------------------------------------------------------------*/
+        uint32_t Raycast(const glm::vec3& origin, const glm::vec3& direction, const BoundingSpheres& spheres,
+        float& distance) const;
+
+        //Replaces the contents of objects with every object whose sphere overlaps the box
+        void QueryBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const BoundingSpheres& spheres,
+        std::vector<uint32_t>& objects) const;
+
+        inline size_t GetObjectCount() const {return m_objects.size();}
+        inline const std::vector<BvhNode>& GetNodes() const {return m_nodes;}
+
+        //The sum of the surface areas of the nodes, the heuristic's cost of the tree grows with it
+        inline double GetSurfaceArea() const {return m_surfaceArea;}
+
+    private:
+
+        //A range of the object list that still has to be split into the node's subtree
+        struct BuildRange
+        {
+            uint32_t node;
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        /*-------------------------------------------------------------------------------------------------
+        Sets the node's bounds to the range's and splits the range in two with the surface area heuristic.
+        Returns where the second half starts, or 0 if the node should be a leaf. The passes over the range
+        run in parallel chunks when bParallel is true
+        --------------------------------------------------------------------------------------------------*/
+        uint32_t SplitRange(uint32_t begin, uint32_t end, BvhNode& node, bool bParallel);
+
+        /*-------------------------------------------------------------------------------------------------
+        Splits the ranges into the nodes until only leaves are left. When pSubtrees is not null, the passes
+        run in parallel and ranges with at most subtreeSize objects are added to it instead of being split
+        --------------------------------------------------------------------------------------------------*/
+        void SplitRanges(std::vector<BuildRange>& ranges, std::vector<BvhNode>& nodes, uint32_t subtreeSize,
+        std::vector<BuildRange>* pSubtrees);
+
+        //Finds the parent of every node, the leaf of every object and the surface area of the tree
+        void LinkNodes();
+
+        //Sets the bounds of a leaf to its spheres' or of an interior node to its children's
+        void FitNode(const BoundingSpheres& spheres, uint32_t node);
+
+    private:
+
+        std::vector<BvhNode> m_nodes;
+        //The objects in the order that the leaves reference them
+        std::vector<uint32_t> m_objects;
+
+        std::vector<uint32_t> m_parents;
+        std::vector<uint32_t> m_objectLeaves;
+        //Marks the nodes that a refit has to fit again, cleared once it has
+        std::vector<uint8_t> m_dirtyNodes;
+        std::vector<uint32_t> m_dirtyList;
+
+        //The objects in the order that the build has sorted them into so far
+        std::vector<BvhBuildObject> m_buildObjects;
+        //Every subtree that is built in parallel gets its own nodes, they are moved into the tree afterwards
+        std::vector<BuildRange> m_subtreeRanges;
+        std::vector<std::vector<BvhNode>> m_subtreeNodes;
+
+        double m_surfaceArea = 0.0;
+        double m_builtSurfaceArea = 0.0;
+    };
+}
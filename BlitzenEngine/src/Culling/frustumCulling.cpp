@@ -0,0 +1,148 @@
+#include "frustumCulling.h"
+
+#include <algorithm>
+
+//SSE is part of every x86 CPU that the engine runs on, so the culling tests do not need to be dispatched
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+    #define BLITZEN_CULLING_SSE
+    #include <xmmintrin.h>
+    #ifdef _MSC_VER
+        #define BLITZEN_TARGET_SSE
+    #else
+        #define BLITZEN_TARGET_SSE      __attribute__((target("sse")))
+    #endif
+#endif
+
+namespace BlitzenEngine
+{
+    void BoundingSpheres::PushBack(const glm::vec4& sphere)
+    {
+        centerX.push_back(sphere.x);
+        centerY.push_back(sphere.y);
+        centerZ.push_back(sphere.z);
+        radius.push_back(sphere.w);
+    }
+
+    void BoundingSpheres::Set(size_t index, const glm::vec4& sphere)
+    {
+        centerX[index] = sphere.x;
+        centerY[index] = sphere.y;
+        centerZ[index] = sphere.z;
+        radius[index] = sphere.w;
+    }
+
+    void BoundingSpheres::Move(size_t destination, size_t source)
+    {
+        centerX[destination] = centerX[source];
+        centerY[destination] = centerY[source];
+        centerZ[destination] = centerZ[source];
+        radius[destination] = radius[source];
+    }
+
+    void BoundingSpheres::PopBack()
+    {
+        centerX.pop_back();
+        centerY.pop_back();
+        centerZ.pop_back();
+        radius.pop_back();
+    }
+
+    void BoundingSpheres::Clear()
+    {
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        radius.clear();
+    }
+
+    void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* pPlanes)
+    {
+        //A point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w in clip space, each bound is one plane
+        glm::mat4 rows = glm::transpose(viewProjection);
+        pPlanes[0] = rows[3] + rows[0];
+        pPlanes[1] = rows[3] - rows[0];
+        pPlanes[2] = rows[3] + rows[1];
+        pPlanes[3] = rows[3] - rows[1];
+        pPlanes[4] = rows[2];
+        pPlanes[5] = rows[3] - rows[2];
+
+        for(int plane = 0; plane < BLITZEN_FRUSTUM_PLANE_COUNT; ++plane)
+        {
+            pPlanes[plane] /= glm::length(glm::vec3(pPlanes[plane]));
+        }
+    }
+
+    glm::vec4 TransformBoundingSphere(const glm::mat4& matrix, const glm::vec4& sphere)
+    {
+        float scale = 0.f;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            scale = std::max(scale, glm::length(glm::vec3(matrix[axis])));
+        }
+        return glm::vec4(glm::vec3(matrix * glm::vec4(glm::vec3(sphere), 1.f)), sphere.w * scale);
+    }
+
+    #ifdef BLITZEN_CULLING_SSE
+
+        //Tests the spheres in groups of four and returns how many were tested, the rest are left to the scalar loop
+        BLITZEN_TARGET_SSE static size_t CullSpheresSSE(const glm::vec4* pPlanes, const BoundingSpheres& spheres,
+        uint8_t* pVisibility, uint32_t& visibleCount)
+        {
+            __m128 planes[BLITZEN_FRUSTUM_PLANE_COUNT][4];
+            for(int plane = 0; plane < BLITZEN_FRUSTUM_PLANE_COUNT; ++plane)
+            {
+                for(int component = 0; component < 4; ++component)
+                {
+                    planes[plane][component] = _mm_set1_ps(pPlanes[plane][component]);
+                }
+            }
+
+            size_t groupEnd = spheres.GetCount() & ~size_t(3);
+            for(size_t i = 0; i < groupEnd; i += 4)
+            {
+                __m128 centerX = _mm_loadu_ps(spheres.centerX.data() + i);
+                __m128 centerY = _mm_loadu_ps(spheres.centerY.data() + i);
+                __m128 centerZ = _mm_loadu_ps(spheres.centerZ.data() + i);
+                __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+
+                //A sphere stays visible while its center is less than its radius outside of every plane
+                __m128 visible = _mm_setzero_ps();
+                for(int plane = 0; plane < BLITZEN_FRUSTUM_PLANE_COUNT; ++plane)
+                {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[plane][0], centerX),
+                    _mm_mul_ps(planes[plane][1], centerY)), _mm_add_ps(_mm_mul_ps(planes[plane][2], centerZ),
+                    planes[plane][3]));
+                    __m128 inside = _mm_cmpgt_ps(distance, negativeRadius);
+                    visible = plane ? _mm_and_ps(visible, inside) : inside;
+                }
+
+                int mask = _mm_movemask_ps(visible);
+                for(int lane = 0; lane < 4; ++lane)
+                {
+                    uint8_t bVisible = static_cast<uint8_t>((mask >> lane) & 1);
+                    pVisibility[i + lane] = bVisible;
+                    visibleCount += bVisible;
+                }
+            }
+            return groupEnd;
+        }
+
+    #endif
+
+    uint32_t CullSpheres(const glm::vec4* pPlanes, const BoundingSpheres& spheres, uint8_t* pVisibility)
+    {
+        uint32_t visibleCount = 0;
+        size_t first = 0;
+        #ifdef BLITZEN_CULLING_SSE
+            first = CullSpheresSSE(pPlanes, spheres, pVisibility, visibleCount);
+        #endif
+
+        for(size_t i = first; i < spheres.GetCount(); ++i)
+        {
+            glm::vec4 sphere(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]);
+            pVisibility[i] = IsSphereInFrustum(pPlanes, sphere) ? 1 : 0;
+            visibleCount += pVisibility[i];
+        }
+        return visibleCount;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+namespace BlitzenEngine
+{
+    //Left, right, bottom, top and the two depth planes
+    #define BLITZEN_FRUSTUM_PLANE_COUNT     6
+
+    /*---------------------------------------------------------------------------------------------------
+    Bounding spheres stored as one array per component, so that the culling tests load the same component
+    of several spheres with a single instruction. Indexed like the render objects that they bound
+    ----------------------------------------------------------------------------------------------------*/
+    struct BoundingSpheres
+    {
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> radius;
+
+        inline size_t GetCount() const {return radius.size();}
+
+        void PushBack(const glm::vec4& sphere);
+        void Set(size_t index, const glm::vec4& sphere);
+        //Copies the sphere at the source index over the one at the destination index
+        void Move(size_t destination, size_t source);
+        void PopBack();
+        void Clear();
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    The spheres that the last culling pass tested, and how many of them were found inside or outside the
+    frustum. The ones inside that were then found hidden behind occluders are counted as occluded instead
+    of visible
+    ----------------------------------------------------------------------------------------------------*/
+    struct CullingStatistics
+    {
+        uint32_t testedCount = 0;
+        uint32_t visibleCount = 0;
+        uint32_t culledCount = 0;
+        uint32_t occludedCount = 0;
+
+        inline bool operator == (const CullingStatistics& other) const
+        {
+            return testedCount == other.testedCount && visibleCount == other.visibleCount &&
+            culledCount == other.culledCount && occludedCount == other.occludedCount;
+        }
+        inline bool operator != (const CullingStatistics& other) const {return !(*this == other);}
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    Extracts the planes of the frustum of a view projection matrix with depth from 0 to 1. Every plane is
+    normalized and faces inwards, so dot(plane.xyz, point) + plane.w is the distance of the point inside
+    of it. Works for reversed depth as well, the two depth planes only trade places
+    ----------------------------------------------------------------------------------------------------*/
+    void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* pPlanes);
+
+    //Takes a sphere to the space of the matrix, the radius grows with the matrix's largest scale
+    glm::vec4 TransformBoundingSphere(const glm::mat4& matrix, const glm::vec4& sphere);
+
+    /*---------------------------------------------------------------------------------------------------
+    The distance to every plane is summed in the same order as the SSE path and the draw culling shader,
+    so that the CPU and the GPU find the same spheres visible, even the ones right on a plane
+    ----------------------------------------------------------------------------------------------------*/
+    inline bool IsSphereInFrustum(const glm::vec4* pPlanes, const glm::vec4& sphere)
+    {
+        for(int plane = 0; plane < BLITZEN_FRUSTUM_PLANE_COUNT; ++plane)
+        {
+            const glm::vec4& p = pPlanes[plane];
+            float distance = (p.x * sphere.x + p.y * sphere.y) + (p.z * sphere.z + p.w);
+            if(!(distance > -sphere.w))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*---------------------------------------------------------------------------------------------------
+    Tests every sphere against the frustum planes, four at a time with SSE where it is available. Sets
+    pVisibility[i] to 1 for spheres that are at least partly inside of the frustum and to 0 for the rest.
+    Returns the number of visible spheres
+    ----------------------------------------------------------------------------------------------------*/
+    uint32_t CullSpheres(const glm::vec4* pPlanes, const BoundingSpheres& spheres, uint8_t* pVisibility);
+}
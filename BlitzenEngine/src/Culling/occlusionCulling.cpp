@@ -0,0 +1,145 @@
+#include "occlusionCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace BlitzenEngine
+{
+    void GetDepthPyramidSize(uint32_t depthWidth, uint32_t depthHeight, uint32_t& width, uint32_t& height)
+    {
+        width = 1;
+        while(width < (depthWidth + 1) / 2)
+        {
+            width *= 2;
+        }
+        height = 1;
+        while(height < (depthHeight + 1) / 2)
+        {
+            height *= 2;
+        }
+    }
+
+    uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levelCount = 1;
+        uint32_t size = std::max(width, height);
+        while(size > 1)
+        {
+            size /= 2;
+            ++levelCount;
+        }
+        return levelCount;
+    }
+
+    //The farthest of the 2x2 source texels under a destination texel, the ones past the source's edge are clamped
+    static void ReduceDepthLevel(const float* pSource, uint32_t sourceWidth, uint32_t sourceHeight,
+    float* pDestination, uint32_t width, uint32_t height)
+    {
+        for(uint32_t y = 0; y < height; ++y)
+        {
+            uint32_t y0 = std::min(2 * y, sourceHeight - 1);
+            uint32_t y1 = std::min(2 * y + 1, sourceHeight - 1);
+            for(uint32_t x = 0; x < width; ++x)
+            {
+                uint32_t x0 = std::min(2 * x, sourceWidth - 1);
+                uint32_t x1 = std::min(2 * x + 1, sourceWidth - 1);
+                pDestination[static_cast<size_t>(y) * width + x] = std::min(
+                std::min(pSource[static_cast<size_t>(y0) * sourceWidth + x0], pSource[static_cast<size_t>(y0) * sourceWidth + x1]),
+                std::min(pSource[static_cast<size_t>(y1) * sourceWidth + x0], pSource[static_cast<size_t>(y1) * sourceWidth + x1]));
+            }
+        }
+    }
+
+    void BuildDepthPyramid(const float* pDepths, uint32_t depthWidth, uint32_t depthHeight, DepthPyramid& pyramid)
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GetDepthPyramidSize(depthWidth, depthHeight, width, height);
+        uint32_t levelCount = GetMipLevelCount(width, height);
+        pyramid.levelWidths.resize(levelCount);
+        pyramid.levelHeights.resize(levelCount);
+        pyramid.levelOffsets.resize(levelCount);
+
+        size_t depthCount = 0;
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+            pyramid.levelWidths[level] = std::max(width >> level, 1u);
+            pyramid.levelHeights[level] = std::max(height >> level, 1u);
+            pyramid.levelOffsets[level] = depthCount;
+            depthCount += static_cast<size_t>(pyramid.levelWidths[level]) * pyramid.levelHeights[level];
+        }
+        pyramid.depths.resize(depthCount);
+
+        ReduceDepthLevel(pDepths, depthWidth, depthHeight, pyramid.depths.data(), pyramid.levelWidths[0],
+        pyramid.levelHeights[0]);
+        for(uint32_t level = 1; level < levelCount; ++level)
+        {
+            ReduceDepthLevel(pyramid.depths.data() + pyramid.levelOffsets[level - 1], pyramid.levelWidths[level - 1],
+            pyramid.levelHeights[level - 1], pyramid.depths.data() + pyramid.levelOffsets[level],
+            pyramid.levelWidths[level], pyramid.levelHeights[level]);
+        }
+    }
+
+    bool ProjectSphere(const glm::vec3& viewCenter, float radius, const glm::vec4& projection, float nearPlane,
+    float viewportWidth, float viewportHeight, glm::vec4& rectangle, float& nearestDepth)
+    {
+        //The sphere's center with z as the distance in front of the view
+        glm::vec3 center(viewCenter.x, viewCenter.y, -viewCenter.z);
+        if(center.z < radius + nearPlane)
+        {
+            return false;
+        }
+
+        /*-------------------------------------------------------------------------------------------------
+        The planes through the eye that touch the sphere, found in x and y separately, bound its projection
+        exactly, from "2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere" by Mara and McGuire.
+        They are found as slopes, the projection takes them to normalized device coordinates
+        --------------------------------------------------------------------------------------------------*/
+        glm::vec3 scaledCenter = center * radius;
+        float tangentDistance = center.z * center.z - radius * radius;
+
+        float vx = std::sqrt(center.x * center.x + tangentDistance);
+        float minX = (vx * center.x - scaledCenter.z) / (vx * center.z + scaledCenter.x);
+        float maxX = (vx * center.x + scaledCenter.z) / (vx * center.z - scaledCenter.x);
+
+        float vy = std::sqrt(center.y * center.y + tangentDistance);
+        float minY = (vy * center.y - scaledCenter.z) / (vy * center.z + scaledCenter.y);
+        float maxY = (vy * center.y + scaledCenter.z) / (vy * center.z - scaledCenter.y);
+
+        //The projection flips y for Vulkan, so the order of the y bounds follows its sign
+        float ndcMinX = minX * projection.x;
+        float ndcMaxX = maxX * projection.x;
+        float ndcMinY = std::min(minY * projection.y, maxY * projection.y);
+        float ndcMaxY = std::max(minY * projection.y, maxY * projection.y);
+        rectangle = glm::vec4((ndcMinX * 0.5f + 0.5f) * viewportWidth, (ndcMinY * 0.5f + 0.5f) * viewportHeight,
+        (ndcMaxX * 0.5f + 0.5f) * viewportWidth, (ndcMaxY * 0.5f + 0.5f) * viewportHeight);
+
+        //Clip space z is [2][2] * z + [3][2] and w is -z, for the view space z of the sphere's nearest point
+        float nearestDistance = center.z - radius;
+        nearestDepth = projection.w / nearestDistance - projection.z;
+        return true;
+    }
+
+    bool IsRectangleOccluded(const DepthPyramid& pyramid, const glm::vec4& rectangle, float nearestDepth)
+    {
+        //Texels of level L are 2^(L+1) pixels wide, the first level that is as wide as the rectangle is read
+        float size = std::max(rectangle.z - rectangle.x, rectangle.w - rectangle.y);
+        int level = size > 1.f ? static_cast<int>(std::ceil(std::log2(size))) - 1 : 0;
+        level = std::min(std::max(level, 0), static_cast<int>(pyramid.GetLevelCount()) - 1);
+
+        uint32_t texelShift = static_cast<uint32_t>(level) + 1;
+        auto toTexel = [texelShift](float pixel, uint32_t levelSize)
+        {
+            int texel = static_cast<int>(std::floor(pixel)) >> texelShift;
+            return static_cast<uint32_t>(std::min(std::max(texel, 0), static_cast<int>(levelSize) - 1));
+        };
+        uint32_t x0 = toTexel(rectangle.x, pyramid.levelWidths[level]);
+        uint32_t x1 = toTexel(rectangle.z, pyramid.levelWidths[level]);
+        uint32_t y0 = toTexel(rectangle.y, pyramid.levelHeights[level]);
+        uint32_t y1 = toTexel(rectangle.w, pyramid.levelHeights[level]);
+
+        float farthestDepth = std::min(std::min(pyramid.GetDepth(level, x0, y0), pyramid.GetDepth(level, x1, y0)),
+        std::min(pyramid.GetDepth(level, x0, y1), pyramid.GetDepth(level, x1, y1)));
+        return nearestDepth < farthestDepth;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+namespace BlitzenEngine
+{
+    /*---------------------------------------------------------------------------------------------------
+    A hierarchical depth buffer for reversed depth, where 1 is near and 0 is far. Every texel holds the
+    farthest, so the smallest, depth of the 2x2 texels under it in the level below, and the first level is
+    built the same way from the depth buffer, with reads past the edges clamped. The first level is half the
+    depth buffer's size rounded up to a power of two and every level after it halves, like the mip chain of
+    an image, so a texel x of level L covers exactly the depth buffer's pixels from x * 2^(L+1) up to the
+    next texel's. Mirrors the depth pyramid that the renderer builds on the GPU
+    ----------------------------------------------------------------------------------------------------*/
+    struct DepthPyramid
+    {
+        std::vector<uint32_t> levelWidths;
+        std::vector<uint32_t> levelHeights;
+        //Where each level starts in the depths, every level is stored row by row
+        std::vector<size_t> levelOffsets;
+        std::vector<float> depths;
+
+        inline uint32_t GetLevelCount() const {return static_cast<uint32_t>(levelWidths.size());}
+
+        inline float GetDepth(uint32_t level, uint32_t x, uint32_t y) const
+        {return depths[levelOffsets[level] + static_cast<size_t>(y) * levelWidths[level] + x];}
+    };
+
+    //The size of the first level of the pyramid of a depth buffer, the levels after it are its mip chain
+    void GetDepthPyramidSize(uint32_t depthWidth, uint32_t depthHeight, uint32_t& width, uint32_t& height);
+
+    //How many levels the mip chain of an image of the given size has
+    uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+    //Builds the pyramid of a depth buffer that is stored row by row
+    void BuildDepthPyramid(const float* pDepths, uint32_t depthWidth, uint32_t depthHeight, DepthPyramid& pyramid);
+
+    /*---------------------------------------------------------------------------------------------------
+    Finds the rectangle of the viewport that a view space sphere covers, in pixels as min x, min y, max x,
+    max y, and the depth of the sphere's nearest point. The projection is given as its [0][0], [1][1], [2][2]
+    and [3][2] elements, the view looks down -z and the near plane is the distance of the closest depth.
+    Returns false when the sphere reaches the near plane, since its projection is unbounded then
+    ----------------------------------------------------------------------------------------------------*/
+    bool ProjectSphere(const glm::vec3& viewCenter, float radius, const glm::vec4& projection, float nearPlane,
+    float viewportWidth, float viewportHeight, glm::vec4& rectangle, float& nearestDepth);
+
+    /*---------------------------------------------------------------------------------------------------
+    True when every depth of the pyramid under the rectangle is nearer than the given depth, so whatever is
+    at that depth or farther is hidden. Reads the 2x2 texels of the first level whose texels are at least
+    as big as the rectangle, which is conservative: it may keep hidden objects but never hides visible ones
+    ----------------------------------------------------------------------------------------------------*/
+    bool IsRectangleOccluded(const DepthPyramid& pyramid, const glm::vec4& rectangle, float nearestDepth);
+}
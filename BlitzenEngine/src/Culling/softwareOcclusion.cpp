@@ -0,0 +1,707 @@
+#include "softwareOcclusion.h"
+#include "Core/jobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+//SSE is part of every x86 CPU that the engine runs on, so the rasterizer does not need to be dispatched
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+    #define BLITZEN_CULLING_SSE
+    #include <xmmintrin.h>
+    #ifdef _MSC_VER
+        #define BLITZEN_TARGET_SSE
+    #else
+        #define BLITZEN_TARGET_SSE      __attribute__((target("sse")))
+    #endif
+#endif
+
+namespace BlitzenEngine
+{
+    /*---------------------------------------------------------------------------------------------------
+    Triangles are clipped to this many times the screen's size in x and y, so that the edge functions
+    keep their precision. Triangles that only leave the screen by less than it are not clipped at all
+    ----------------------------------------------------------------------------------------------------*/
+    #define BLITZEN_SOFTWARE_OCCLUSION_GUARD_BAND       4.f
+
+    //The near plane and the four planes of the guard band
+    #define BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES      5
+
+    //How many boxes every job of CullBoxes tests
+    #define BLITZEN_SOFTWARE_OCCLUSION_BOX_BATCH        64
+
+    void BuildOccluderAdjacency(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t* pAdjacency)
+    {
+        //Every directed edge as its two vertices packed in a key, sorted so that the reverse of an edge can be searched
+        std::vector<std::pair<uint64_t, uint32_t>> edges(indexCount);
+        auto edgeKey = [vertexCount](uint32_t from, uint32_t to)
+        {
+            return static_cast<uint64_t>(from) * vertexCount + to;
+        };
+        for(size_t i = 0; i < indexCount; ++i)
+        {
+            size_t next = i - i % 3 + (i % 3 + 1) % 3;
+            edges[i] = {edgeKey(pIndices[i], pIndices[next]), static_cast<uint32_t>(i)};
+        }
+        std::sort(edges.begin(), edges.end());
+
+        auto findEdges = [&edges](uint64_t key)
+        {
+            return std::equal_range(edges.begin(), edges.end(), std::make_pair(key, uint32_t(0)),
+            [](const std::pair<uint64_t, uint32_t>& left, const std::pair<uint64_t, uint32_t>& right)
+            {
+                return left.first < right.first;
+            });
+        };
+
+        for(size_t i = 0; i < indexCount; ++i)
+        {
+            pAdjacency[i] = BLITZEN_OCCLUDER_NO_NEIGHBOR;
+            size_t next = i - i % 3 + (i % 3 + 1) % 3;
+            auto forward = findEdges(edgeKey(pIndices[i], pIndices[next]));
+            auto reverse = findEdges(edgeKey(pIndices[next], pIndices[i]));
+            if(forward.second - forward.first == 1 && reverse.second - reverse.first == 1 &&
+            reverse.first->second / 3 != i / 3)
+            {
+                pAdjacency[i] = reverse.first->second / 3;
+            }
+        }
+    }
+
+    SoftwareOcclusionRasterizer::SoftwareOcclusionRasterizer(uint32_t width /*=BLITZEN_SOFTWARE_OCCLUSION_WIDTH*/,
+    uint32_t height /*=BLITZEN_SOFTWARE_OCCLUSION_HEIGHT*/)
+    {
+        Resize(width, height);
+    }
+
+    void SoftwareOcclusionRasterizer::Resize(uint32_t width, uint32_t height)
+    {
+        m_width = (std::max(width, 1u) + 3) & ~3u;
+        m_height = std::max(height, 1u);
+        m_tileCountX = (m_width + BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE - 1) / BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE;
+        m_tileCountY = (m_height + BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE - 1) / BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE;
+        m_depths.assign(static_cast<size_t>(m_width) * m_height, 0.f);
+        m_pyramid = DepthPyramid();
+    }
+
+    void SoftwareOcclusionRasterizer::BeginFrame(const glm::mat4& view, const glm::mat4& projection)
+    {
+        m_viewProjection = projection * view;
+        m_depthScale = projection[2][2];
+        m_pixelScale = 0.5f * std::max(std::abs(projection[0][0]) * m_width, std::abs(projection[1][1]) * m_height);
+        m_occluders.clear();
+    }
+
+    void SoftwareOcclusionRasterizer::AddOccluder(const glm::mat4& matrix, const glm::vec3* pVertices,
+    size_t vertexCount, const uint32_t* pIndices, const uint32_t* pAdjacency, size_t indexCount, float error)
+    {
+        if(indexCount < 3)
+        {
+            return;
+        }
+        m_occluders.push_back({m_viewProjection * matrix, pVertices, vertexCount, pIndices, pAdjacency,
+        indexCount - indexCount % 3, error});
+    }
+
+    void SoftwareOcclusionRasterizer::SetupOccluder(const Occluder& occluder, SetupJob& job)
+    {
+        job.clipVertices.resize(occluder.vertexCount);
+        for(size_t v = 0; v < occluder.vertexCount; ++v)
+        {
+            job.clipVertices[v] = occluder.matrix * glm::vec4(occluder.pVertices[v], 1.f);
+        }
+
+        /*-------------------------------------------------------------------------------------------------
+        The facing of every triangle is the sign of the determinant of its clip space x, y and w. Those are
+        a linear map of the view space position, so the sign is the one of the triangle's area on the
+        screen when it is in front of the view, and it stays right for triangles that are not
+        --------------------------------------------------------------------------------------------------*/
+        size_t triangleCount = occluder.indexCount / 3;
+        job.facings.resize(triangleCount);
+        for(size_t t = 0; t < triangleCount; ++t)
+        {
+            const glm::vec4& c0 = job.clipVertices[occluder.pIndices[3 * t]];
+            const glm::vec4& c1 = job.clipVertices[occluder.pIndices[3 * t + 1]];
+            const glm::vec4& c2 = job.clipVertices[occluder.pIndices[3 * t + 2]];
+            float determinant = c0.x * (c1.y * c2.w - c2.y * c1.w) - c1.x * (c0.y * c2.w - c2.y * c0.w) +
+            c2.x * (c0.y * c1.w - c1.y * c0.w);
+            job.facings[t] = determinant > 0.f ? 1 : (determinant < 0.f ? -1 : 0);
+        }
+
+        for(size_t t = 0; t < triangleCount; ++t)
+        {
+            int8_t facing = job.facings[t];
+            if(!facing)
+            {
+                continue;
+            }
+
+            glm::vec4 clip[3];
+            for(int v = 0; v < 3; ++v)
+            {
+                clip[v] = job.clipVertices[occluder.pIndices[3 * t + v]];
+            }
+
+            //Triangles that are entirely on the outer side of a plane of the frustum are never seen
+            auto isOutside = [&clip](auto distance)
+            {
+                return distance(clip[0]) < 0.f && distance(clip[1]) < 0.f && distance(clip[2]) < 0.f;
+            };
+            if(isOutside([](const glm::vec4& c){return c.w + c.x;}) || isOutside([](const glm::vec4& c){return c.w - c.x;}) ||
+            isOutside([](const glm::vec4& c){return c.w + c.y;}) || isOutside([](const glm::vec4& c){return c.w - c.y;}) ||
+            isOutside([](const glm::vec4& c){return c.w - c.z;}) || isOutside([](const glm::vec4& c){return c.z;}))
+            {
+                continue;
+            }
+
+            //An edge is on the silhouette unless the triangle across it faces the same way
+            bool silhouetteEdges[3];
+            for(int e = 0; e < 3; ++e)
+            {
+                uint32_t neighbor = occluder.pAdjacency ? occluder.pAdjacency[3 * t + e] : BLITZEN_OCCLUDER_NO_NEIGHBOR;
+                silhouetteEdges[e] = neighbor >= triangleCount || job.facings[neighbor] != facing;
+            }
+
+            SetupTriangle(clip, silhouetteEdges, facing, occluder.error, job);
+        }
+    }
+
+    void SoftwareOcclusionRasterizer::SetupTriangle(const glm::vec4* pClip, const bool* pSilhouetteEdges,
+    int8_t facing, float error, SetupJob& job)
+    {
+        //The silhouette flag of every polygon vertex belongs to the edge that starts at it
+        struct ClipVertex
+        {
+            glm::vec4 position;
+            bool bSilhouette;
+        };
+        ClipVertex polygons[2][3 + BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES];
+        ClipVertex* pPolygon = polygons[0];
+        int vertexCount = 3;
+        for(int v = 0; v < 3; ++v)
+        {
+            pPolygon[v] = {pClip[v], pSilhouetteEdges[v]};
+        }
+
+        auto planeDistance = [](const glm::vec4& c, int plane)
+        {
+            switch(plane)
+            {
+                case 0: return c.w - c.z;
+                case 1: return BLITZEN_SOFTWARE_OCCLUSION_GUARD_BAND * c.w + c.x;
+                case 2: return BLITZEN_SOFTWARE_OCCLUSION_GUARD_BAND * c.w - c.x;
+                case 3: return BLITZEN_SOFTWARE_OCCLUSION_GUARD_BAND * c.w + c.y;
+                default: return BLITZEN_SOFTWARE_OCCLUSION_GUARD_BAND * c.w - c.y;
+            }
+        };
+
+        /*-------------------------------------------------------------------------------------------------
+        Sutherland-Hodgman against the near plane and the guard band. The intersection of an edge is always
+        found from its inside vertex, so two triangles that share an edge clip it to the same point. Edges
+        that the clipping adds run along a plane, they are treated as silhouettes
+        --------------------------------------------------------------------------------------------------*/
+        for(int plane = 0; plane < BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES; ++plane)
+        {
+            float distances[3 + BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES];
+            bool bClipped = false;
+            for(int v = 0; v < vertexCount; ++v)
+            {
+                distances[v] = planeDistance(pPolygon[v].position, plane);
+                bClipped |= distances[v] < 0.f;
+            }
+            if(!bClipped)
+            {
+                continue;
+            }
+
+            ClipVertex* pClipped = pPolygon == polygons[0] ? polygons[1] : polygons[0];
+            int clippedCount = 0;
+            for(int v = 0; v < vertexCount; ++v)
+            {
+                int next = (v + 1) % vertexCount;
+                bool bInside = distances[v] >= 0.f;
+                bool bNextInside = distances[next] >= 0.f;
+                if(bInside)
+                {
+                    pClipped[clippedCount++] = pPolygon[v];
+                }
+                if(bInside != bNextInside)
+                {
+                    int inside = bInside ? v : next;
+                    int outside = bInside ? next : v;
+                    float t = distances[inside] / (distances[inside] - distances[outside]);
+                    glm::vec4 position = pPolygon[inside].position +
+                    (pPolygon[outside].position - pPolygon[inside].position) * t;
+                    pClipped[clippedCount++] = {position, bInside ? true : pPolygon[v].bSilhouette};
+                }
+            }
+            pPolygon = pClipped;
+            vertexCount = clippedCount;
+            if(vertexCount < 3)
+            {
+                return;
+            }
+        }
+
+        //The depth is moved back by the error, the concave 1/w keeps the depth plane behind the moved vertices
+        float screenX[3 + BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES];
+        float screenY[3 + BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES];
+        float depths[3 + BLITZEN_SOFTWARE_OCCLUSION_CLIP_PLANES];
+        float minW = std::numeric_limits<float>::max();
+        for(int v = 0; v < vertexCount; ++v)
+        {
+            const glm::vec4& c = pPolygon[v].position;
+            float inverseW = 1.f / c.w;
+            screenX[v] = (c.x * inverseW * 0.5f + 0.5f) * m_width;
+            screenY[v] = (c.y * inverseW * 0.5f + 0.5f) * m_height;
+            depths[v] = (c.z - m_depthScale * error) / (c.w + error);
+            minW = std::min(minW, c.w);
+        }
+        //Silhouette edges are pulled in by as many pixels as the error covers at the triangle's nearest point
+        float errorPixels = error * m_pixelScale / minW;
+        float sign = static_cast<float>(facing);
+
+        for(int fan = 1; fan + 1 < vertexCount; ++fan)
+        {
+            int corners[3] = {0, fan, fan + 1};
+            //The diagonals of the fan are shared by its own triangles, only the polygon's edges may be silhouettes
+            bool silhouettes[3] = {fan == 1 && pPolygon[0].bSilhouette, pPolygon[fan].bSilhouette,
+            fan + 2 == vertexCount && pPolygon[fan + 1].bSilhouette};
+
+            float x0 = screenX[corners[0]], y0 = screenY[corners[0]], d0 = depths[corners[0]];
+            float x1 = screenX[corners[1]], y1 = screenY[corners[1]], d1 = depths[corners[1]];
+            float x2 = screenX[corners[2]], y2 = screenY[corners[2]], d2 = depths[corners[2]];
+            float doubleArea = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+            if(!(std::abs(doubleArea) > 1e-6f))
+            {
+                continue;
+            }
+
+            RasterTriangle triangle;
+            for(int e = 0; e < 3; ++e)
+            {
+                int from = corners[e];
+                int to = corners[(e + 1) % 3];
+
+                /*-----------------------------------------------------------------------------------------
+                The edge is always set up from the same one of its vertices and negated for the other
+                direction, so the two triangles of a shared edge get exactly opposite functions and agree on
+                every pixel center, whatever the compiler does with the products
+                ------------------------------------------------------------------------------------------*/
+                float edgeSign = sign;
+                if(screenX[from] > screenX[to] || (screenX[from] == screenX[to] && screenY[from] > screenY[to]))
+                {
+                    std::swap(from, to);
+                    edgeSign = -edgeSign;
+                }
+                float a = edgeSign * (screenY[from] - screenY[to]);
+                float b = edgeSign * (screenX[to] - screenX[from]);
+                float c = edgeSign * (screenX[from] * screenY[to] - screenX[to] * screenY[from]);
+                if(silhouettes[e])
+                {
+                    c -= 0.5f * (std::abs(a) + std::abs(b)) + errorPixels * std::sqrt(a * a + b * b);
+                }
+                triangle.edgeA[e] = a;
+                triangle.edgeB[e] = b;
+                triangle.edgeC[e] = c;
+            }
+
+            float depthA = ((d1 - d0) * (y2 - y0) - (d2 - d0) * (y1 - y0)) / doubleArea;
+            float depthB = ((x1 - x0) * (d2 - d0) - (x2 - x0) * (d1 - d0)) / doubleArea;
+            triangle.depthA = depthA;
+            triangle.depthB = depthB;
+            triangle.depthC = d0 - depthA * x0 - depthB * y0 - 0.5f * (std::abs(depthA) + std::abs(depthB));
+            triangle.minDepth = std::min(d0, std::min(d1, d2));
+            triangle.maxDepth = std::max(d0, std::max(d1, d2));
+
+            //The pixels whose centers are inside of the triangle's bounds, clamped to the screen
+            triangle.minX = std::max(static_cast<int32_t>(std::ceil(std::min(x0, std::min(x1, x2)) - 0.5f)), 0);
+            triangle.minY = std::max(static_cast<int32_t>(std::ceil(std::min(y0, std::min(y1, y2)) - 0.5f)), 0);
+            triangle.maxX = std::min(static_cast<int32_t>(std::floor(std::max(x0, std::max(x1, x2)) - 0.5f)),
+            static_cast<int32_t>(m_width) - 1);
+            triangle.maxY = std::min(static_cast<int32_t>(std::floor(std::max(y0, std::max(y1, y2)) - 0.5f)),
+            static_cast<int32_t>(m_height) - 1);
+            if(triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            {
+                continue;
+            }
+
+            uint32_t index = static_cast<uint32_t>(job.triangles.size());
+            job.triangles.push_back(triangle);
+            for(int32_t tileY = triangle.minY / BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE;
+            tileY <= triangle.maxY / BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE; ++tileY)
+            {
+                for(int32_t tileX = triangle.minX / BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE;
+                tileX <= triangle.maxX / BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE; ++tileX)
+                {
+                    job.tileBins[static_cast<size_t>(tileY) * m_tileCountX + tileX].push_back(index);
+                }
+            }
+        }
+    }
+
+    //Fills the rows of a triangle inside of a tile one pixel at a time, for CPUs without SSE
+    static void FillTriangleRows(float* pDepths, uint32_t width, int32_t firstX, int32_t lastX, int32_t firstY,
+    int32_t lastY, const float* pEdgeA, const float* pEdgeB, const float* pEdgeC, float depthA, float depthB, 
+    float depthC, float minDepth, float maxDepth)
+    {
+        //The edges are evaluated in the same order as the SSE path, so that neighbors still agree on every pixel
+        for(int32_t y = firstY; y <= lastY; ++y)
+        {
+            float centerY = static_cast<float>(y) + 0.5f;
+            float rowEdges[3];
+            for(int e = 0; e < 3; ++e)
+            {
+                rowEdges[e] = pEdgeB[e] * centerY + pEdgeC[e];
+            }
+            float rowDepth = depthB * centerY + depthC;
+
+            float* pRow = pDepths + static_cast<size_t>(y) * width;
+            for(int32_t x = firstX; x <= lastX; ++x)
+            {
+                float centerX = static_cast<float>(x) + 0.5f;
+                if(pEdgeA[0] * centerX + rowEdges[0] >= 0.f && pEdgeA[1] * centerX + rowEdges[1] >= 0.f &&
+                pEdgeA[2] * centerX + rowEdges[2] >= 0.f)
+                {
+                    float depth = std::min(std::max(depthA * centerX + rowDepth, minDepth), maxDepth);
+                    pRow[x] = std::max(pRow[x], depth);
+                }
+            }
+        }
+    }
+
+    #ifdef BLITZEN_CULLING_SSE
+
+        //Fills the rows of a triangle inside of a tile, four pixels at a time. The first pixel is a multiple of 4
+        BLITZEN_TARGET_SSE static void FillTriangleRowsSSE(float* pDepths, uint32_t width, int32_t firstX,
+        int32_t lastX, int32_t firstY, int32_t lastY, const float* pEdgeA, const float* pEdgeB, const float* pEdgeC,
+        float depthA, float depthB, float depthC, float minDepth, float maxDepth)
+        {
+            __m128 edgeA[3];
+            for(int e = 0; e < 3; ++e)
+            {
+                edgeA[e] = _mm_set1_ps(pEdgeA[e]);
+            }
+            __m128 planeA = _mm_set1_ps(depthA);
+            __m128 nearest = _mm_set1_ps(maxDepth);
+            __m128 farthest = _mm_set1_ps(minDepth);
+            __m128 zero = _mm_setzero_ps();
+            __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+            for(int32_t y = firstY; y <= lastY; ++y)
+            {
+                float centerY = static_cast<float>(y) + 0.5f;
+                __m128 rowEdges[3];
+                for(int e = 0; e < 3; ++e)
+                {
+                    rowEdges[e] = _mm_set1_ps(pEdgeB[e] * centerY + pEdgeC[e]);
+                }
+                __m128 rowDepth = _mm_set1_ps(depthB * centerY + depthC);
+
+                float* pRow = pDepths + static_cast<size_t>(y) * width;
+                for(int32_t x = firstX; x <= lastX; x += 4)
+                {
+                    __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenters);
+                    __m128 covered = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], centerX), rowEdges[0]), zero);
+                    covered = _mm_and_ps(covered, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], centerX), rowEdges[1]), zero));
+                    covered = _mm_and_ps(covered, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], centerX), rowEdges[2]), zero));
+
+                    //Uncovered pixels are given the far depth, which never replaces anything
+                    __m128 depth = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(planeA, centerX), rowDepth), farthest), nearest);
+                    depth = _mm_and_ps(covered, depth);
+                    _mm_storeu_ps(pRow + x, _mm_max_ps(_mm_loadu_ps(pRow + x), depth));
+                }
+            }
+        }
+
+    #endif
+
+    void SoftwareOcclusionRasterizer::RasterizeTile(uint32_t tile)
+    {
+        int32_t tileMinX = static_cast<int32_t>((tile % m_tileCountX) * BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE);
+        int32_t tileMinY = static_cast<int32_t>((tile / m_tileCountX) * BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE);
+        int32_t tileMaxX = std::min(tileMinX + BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE, static_cast<int32_t>(m_width)) - 1;
+        int32_t tileMaxY = std::min(tileMinY + BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE, static_cast<int32_t>(m_height)) - 1;
+        for(int32_t y = tileMinY; y <= tileMaxY; ++y)
+        {
+            float* pRow = m_depths.data() + static_cast<size_t>(y) * m_width;
+            std::fill(pRow + tileMinX, pRow + tileMaxX + 1, 0.f);
+        }
+
+        for(const SetupJob& job : m_setupJobs)
+        {
+            for(uint32_t index : job.tileBins[tile])
+            {
+                const RasterTriangle& triangle = job.triangles[index];
+                //Rows are filled in groups of 4 pixels, the tiles and the width are multiples of 4 so a group never leaves the tile
+                int32_t firstX = std::max(triangle.minX, tileMinX) & ~3;
+                int32_t lastX = std::min(triangle.maxX, tileMaxX);
+                int32_t firstY = std::max(triangle.minY, tileMinY);
+                int32_t lastY = std::min(triangle.maxY, tileMaxY);
+
+                #ifdef BLITZEN_CULLING_SSE
+                    if(!m_bScalarFill)
+                    {
+                        FillTriangleRowsSSE(m_depths.data(), m_width, firstX, lastX, firstY, lastY, triangle.edgeA,
+                        triangle.edgeB, triangle.edgeC, triangle.depthA, triangle.depthB, triangle.depthC,
+                        triangle.minDepth, triangle.maxDepth);
+                        continue;
+                    }
+                #endif
+                FillTriangleRows(m_depths.data(), m_width, firstX, lastX, firstY, lastY, triangle.edgeA, triangle.edgeB,
+                triangle.edgeC, triangle.depthA, triangle.depthB, triangle.depthC, triangle.minDepth, triangle.maxDepth);
+            }
+        }
+    }
+
+    void SoftwareOcclusionRasterizer::Rasterize()
+    {
+        /*-------------------------------------------------------------------------------------------------
+        The occluders are split in one run for every thread with about the same number of triangles, an
+        occluder is never split since the facings of all of its triangles are needed for its silhouettes
+        --------------------------------------------------------------------------------------------------*/
+        size_t totalTriangles = 0;
+        for(const Occluder& occluder : m_occluders)
+        {
+            totalTriangles += occluder.indexCount / 3;
+        }
+        size_t jobCount = std::max<size_t>(std::min<size_t>(GetJobSystem().GetThreadCount(), m_occluders.size()), 1);
+        std::vector<size_t> firstOccluders(jobCount + 1, m_occluders.size());
+        firstOccluders[0] = 0;
+        size_t triangleCount = 0;
+        size_t job = 1;
+        for(size_t o = 0; o < m_occluders.size() && job < jobCount; ++o)
+        {
+            triangleCount += m_occluders[o].indexCount / 3;
+            if(triangleCount * jobCount >= totalTriangles * job)
+            {
+                firstOccluders[job++] = o + 1;
+            }
+        }
+
+        size_t tileCount = static_cast<size_t>(m_tileCountX) * m_tileCountY;
+        m_setupJobs.resize(jobCount);
+        GetJobSystem().ParallelFor(jobCount, [&](size_t j)
+        {
+            SetupJob& setupJob = m_setupJobs[j];
+            setupJob.triangles.clear();
+            setupJob.tileBins.resize(tileCount);
+            for(std::vector<uint32_t>& bin : setupJob.tileBins)
+            {
+                bin.clear();
+            }
+            for(size_t o = firstOccluders[j]; o < firstOccluders[j + 1]; ++o)
+            {
+                SetupOccluder(m_occluders[o], setupJob);
+            }
+        });
+
+        m_triangleCount = 0;
+        for(const SetupJob& setupJob : m_setupJobs)
+        {
+            m_triangleCount += setupJob.triangles.size();
+        }
+
+        GetJobSystem().ParallelFor(tileCount, [this](size_t tile)
+        {
+            RasterizeTile(static_cast<uint32_t>(tile));
+        });
+
+        /*-------------------------------------------------------------------------------------------------
+        Every pixel takes the farthest depth of the 3x3 pixels around it, first along the rows then along
+        the columns. A pixel whose center was covered but that reaches past the edge of what the occluders
+        cover, or over a fold of triangles smaller than a pixel, always has a neighbor that shows it
+        --------------------------------------------------------------------------------------------------*/
+        m_erodedRows.resize(m_depths.size());
+        GetJobSystem().ParallelFor(m_height, [this](size_t y)
+        {
+            const float* pRow = m_depths.data() + y * m_width;
+            float* pEroded = m_erodedRows.data() + y * m_width;
+            for(uint32_t x = 0; x < m_width; ++x)
+            {
+                float depth = pRow[x];
+                depth = x > 0 ? std::min(depth, pRow[x - 1]) : depth;
+                depth = x + 1 < m_width ? std::min(depth, pRow[x + 1]) : depth;
+                pEroded[x] = depth;
+            }
+        });
+        GetJobSystem().ParallelFor(m_height, [this](size_t y)
+        {
+            const float* pAbove = m_erodedRows.data() + (y > 0 ? y - 1 : y) * m_width;
+            const float* pRow = m_erodedRows.data() + y * m_width;
+            const float* pBelow = m_erodedRows.data() + (y + 1 < m_height ? y + 1 : y) * m_width;
+            float* pDepths = m_depths.data() + y * m_width;
+            for(uint32_t x = 0; x < m_width; ++x)
+            {
+                pDepths[x] = std::min(pRow[x], std::min(pAbove[x], pBelow[x]));
+            }
+        });
+
+        BuildDepthPyramid(m_depths.data(), m_width, m_height, m_pyramid);
+    }
+
+    bool SoftwareOcclusionRasterizer::TestBox(const glm::mat4& matrix, const glm::vec3& boundsMin,
+    const glm::vec3& boundsMax, TestedRectangle& tested) const
+    {
+        tested = {glm::vec4(0.f), 0, 0};
+        if(!m_pyramid.GetLevelCount())
+        {
+            return false;
+        }
+
+        //The box covers the rectangle around its projected corners, its nearest corner is the nearest depth
+        glm::mat4 clipMatrix = m_viewProjection * matrix;
+        glm::vec4 rectangle(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+        -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+        float nearestDepth = 0.f;
+        for(int corner = 0; corner < 8; ++corner)
+        {
+            glm::vec3 position((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y,
+            (corner & 4) ? boundsMax.z : boundsMin.z);
+            glm::vec4 clip = clipMatrix * glm::vec4(position, 1.f);
+            if(!(clip.w > 0.f) || clip.z > clip.w)
+            {
+                return false;
+            }
+
+            float inverseW = 1.f / clip.w;
+            float x = (clip.x * inverseW * 0.5f + 0.5f) * m_width;
+            float y = (clip.y * inverseW * 0.5f + 0.5f) * m_height;
+            rectangle = glm::vec4(std::min(rectangle.x, x), std::min(rectangle.y, y), std::max(rectangle.z, x),
+            std::max(rectangle.w, y));
+            nearestDepth = std::max(nearestDepth, clip.z * inverseW);
+        }
+
+        float width = static_cast<float>(m_width);
+        float height = static_cast<float>(m_height);
+        if(rectangle.z < 0.f || rectangle.x > width || rectangle.w < 0.f || rectangle.y > height)
+        {
+            return false;
+        }
+
+        //What is off the screen cannot be seen, so only the part on it is tested
+        rectangle = glm::vec4(std::max(rectangle.x, 0.f), std::max(rectangle.y, 0.f), std::min(rectangle.z, width),
+        std::min(rectangle.w, height));
+        tested.rectangle = rectangle;
+        tested.bOnScreen = 1;
+        tested.bOccluded = IsRectangleOccluded(m_pyramid, rectangle, nearestDepth) ? 1 : 0;
+        return tested.bOccluded != 0;
+    }
+
+    bool SoftwareOcclusionRasterizer::IsBoxOccluded(const glm::mat4& matrix, const glm::vec3& boundsMin,
+    const glm::vec3& boundsMax) const
+    {
+        TestedRectangle tested;
+        return TestBox(matrix, boundsMin, boundsMax, tested);
+    }
+
+    uint32_t SoftwareOcclusionRasterizer::CullBoxes(const OcclusionBox* pBoxes, size_t count, uint8_t* pVisibility)
+    {
+        m_testedRectangles.resize(m_bRecordTests ? count : 0);
+
+        size_t batchCount = (count + BLITZEN_SOFTWARE_OCCLUSION_BOX_BATCH - 1) / BLITZEN_SOFTWARE_OCCLUSION_BOX_BATCH;
+        std::vector<uint32_t> batchOccludedCounts(batchCount, 0);
+        GetJobSystem().ParallelFor(batchCount, [&](size_t batch)
+        {
+            size_t end = std::min(count, (batch + 1) * BLITZEN_SOFTWARE_OCCLUSION_BOX_BATCH);
+            for(size_t i = batch * BLITZEN_SOFTWARE_OCCLUSION_BOX_BATCH; i < end; ++i)
+            {
+                TestedRectangle tested;
+                bool bOccluded = TestBox(pBoxes[i].matrix, pBoxes[i].boundsMin, pBoxes[i].boundsMax, tested);
+                pVisibility[i] = bOccluded ? 0 : 1;
+                batchOccludedCounts[batch] += bOccluded ? 1 : 0;
+                if(m_bRecordTests)
+                {
+                    m_testedRectangles[i] = tested;
+                }
+            }
+        });
+
+        uint32_t occludedCount = 0;
+        for(uint32_t batchOccluded : batchOccludedCounts)
+        {
+            occludedCount += batchOccluded;
+        }
+        return occludedCount;
+    }
+
+    bool SoftwareOcclusionRasterizer::WriteDebugImage(const std::filesystem::path& path) const
+    {
+        //The depths are scaled by the nearest one, reversed depth falls off quickly with the distance
+        float nearestDepth = 0.f;
+        for(float depth : m_depths)
+        {
+            nearestDepth = std::max(nearestDepth, depth);
+        }
+        float depthScale = nearestDepth > 0.f ? 255.f / nearestDepth : 0.f;
+
+        std::vector<uint8_t> pixels(static_cast<size_t>(m_width) * m_height * 3);
+        for(size_t p = 0; p < m_depths.size(); ++p)
+        {
+            uint8_t value = static_cast<uint8_t>(std::min(std::max(m_depths[p], 0.f) * depthScale, 255.f));
+            pixels[3 * p] = value;
+            pixels[3 * p + 1] = value;
+            pixels[3 * p + 2] = value;
+        }
+
+        for(const TestedRectangle& tested : m_testedRectangles)
+        {
+            if(!tested.bOnScreen)
+            {
+                continue;
+            }
+
+            uint8_t color[3] = {0, 255, 0};
+            if(tested.bOccluded)
+            {
+                color[0] = 255;
+                color[1] = 0;
+            }
+            auto toPixel = [](float coordinate, uint32_t size)
+            {
+                return std::min(static_cast<uint32_t>(std::max(coordinate, 0.f)), size - 1);
+            };
+            uint32_t minX = toPixel(tested.rectangle.x, m_width);
+            uint32_t minY = toPixel(tested.rectangle.y, m_height);
+            uint32_t maxX = toPixel(tested.rectangle.z, m_width);
+            uint32_t maxY = toPixel(tested.rectangle.w, m_height);
+            auto setPixel = [&](uint32_t x, uint32_t y)
+            {
+                size_t p = static_cast<size_t>(y) * m_width + x;
+                for(int channel = 0; channel < 3; ++channel)
+                {
+                    pixels[3 * p + channel] = color[channel];
+                }
+            };
+            for(uint32_t x = minX; x <= maxX; ++x)
+            {
+                setPixel(x, minY);
+                setPixel(x, maxY);
+            }
+            for(uint32_t y = minY; y <= maxY; ++y)
+            {
+                setPixel(minX, y);
+                setPixel(maxX, y);
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+        {
+            std::cout << "Writing occlusion image: " << path << " -> Could not create file\n";
+            return false;
+        }
+        file << "P6\n" << m_width << ' ' << m_height << "\n255\n";
+        file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+        file.close();
+        if(file.fail())
+        {
+            std::cout << "Writing occlusion image: " << path << " -> Write failed\n";
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <filesystem>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include "occlusionCulling.h"
+
+namespace BlitzenEngine
+{
+    //The default size of the software depth buffer, small enough to be filled in about a millisecond on a few threads
+    #define BLITZEN_SOFTWARE_OCCLUSION_WIDTH            256
+    #define BLITZEN_SOFTWARE_OCCLUSION_HEIGHT           128
+
+    //The depth buffer is split into square tiles of this many pixels a side, each one is filled by a single thread
+    #define BLITZEN_SOFTWARE_OCCLUSION_TILE_SIZE        32
+
+    //Stands in for the neighbor of an occluder triangle's edge that no other triangle shares
+    #define BLITZEN_OCCLUDER_NO_NEIGHBOR                0xFFFFFFFF
+
+    /*---------------------------------------------------------------------------------------------------
+    Finds the triangle across every edge of an occluder's triangle list. The neighbor of edge e of triangle
+    t, which goes from index 3t+e to the next index of the triangle, is written to pAdjacency[3t+e]. Only
+    triangles that share the edge in the opposite direction, so with the same winding, are neighbors, and
+    an edge that more than two triangles share has none
+    ----------------------------------------------------------------------------------------------------*/
+    void BuildOccluderAdjacency(const uint32_t* pIndices, size_t indexCount, size_t vertexCount, uint32_t* pAdjacency);
+
+    //A box that is tested against the software depth buffer, the bounds are taken to world space by the matrix
+    struct OcclusionBox
+    {
+        glm::mat4 matrix;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    Draws simplified occluder meshes into a low resolution depth buffer on the CPU and tests boxes against
+    it, for when the GPU cannot afford its own occlusion culling. Depth is reversed like the renderer's,
+    1 at the near plane and 0 at the far plane, which is what the buffer is cleared to.
+
+    The buffer is conservative, it does not hold a depth nearer than the occluders over a pixel:
+    - Every pixel gets the farthest depth that the triangle's plane reaches inside of it
+    - The triangles of an occluder meet without cracks where they face the same way, but on silhouette
+    edges only pixels that are fully inside the triangle are covered
+    - Once every triangle is drawn, each pixel takes the farthest depth of the pixels around it, which
+    takes care of the pixels that a triangle covers the center of but that reach past its neighbors
+    - The occluder's simplification error pushes its depth back and its silhouettes in, since the
+    simplified mesh may bulge out of the real one by that much
+
+    Triangles are set up and binned to tiles with one job per thread, then the tiles are filled in
+    parallel four pixels at a time. Each tile keeps the nearest depth written to every pixel, which does
+    not depend on the order of the triangles, so the result is the same on any number of threads
+    ----------------------------------------------------------------------------------------------------*/
+    class SoftwareOcclusionRasterizer
+    {
+    public:
+
+        //The width is rounded up to a multiple of 4, the pixels of a row are filled in groups of 4
+        SoftwareOcclusionRasterizer(uint32_t width = BLITZEN_SOFTWARE_OCCLUSION_WIDTH,
+        uint32_t height = BLITZEN_SOFTWARE_OCCLUSION_HEIGHT);
+
+        void Resize(uint32_t width, uint32_t height);
+
+        /*-------------------------------------------------------------------------------------------------
+        Forgets the last frame's occluders and sets the view that the next ones are drawn from. The
+        projection has to be a perspective one with w as the distance in front of the view
+        --------------------------------------------------------------------------------------------------*/
+        void BeginFrame(const glm::mat4& view, const glm::mat4& projection);
+
+        /*-------------------------------------------------------------------------------------------------
+        Adds an occluder to the frame, drawn with the matrix taking its vertices to world space. The indices
+        are local to the vertices and the adjacency is the one that BuildOccluderAdjacency gives. The error
+        is how far the occluder may be outside of the mesh that it stands in for, in world units.
+        Nothing is copied, the arrays have to stay alive until the frame is rasterized
+        --------------------------------------------------------------------------------------------------*/
+        void AddOccluder(const glm::mat4& matrix, const glm::vec3* pVertices, size_t vertexCount,
+        const uint32_t* pIndices, const uint32_t* pAdjacency, size_t indexCount, float error);
+
+        //Clears the depth buffer, draws the frame's occluders into it and builds its depth pyramid for the tests
+        void Rasterize();
+
+        /*-------------------------------------------------------------------------------------------------
+        True if the box is behind the depth buffer everywhere that it covers. Boxes that reach the near
+        plane or are not on the screen are never occluded. Safe to call from several threads at once
+        --------------------------------------------------------------------------------------------------*/
+        bool IsBoxOccluded(const glm::mat4& matrix, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+        /*-------------------------------------------------------------------------------------------------
+        Tests the boxes in parallel and sets pVisibility[i] to 0 for the occluded ones and to 1 for the
+        rest. Returns the number of occluded boxes. The tests are kept for the debug image while recording
+        --------------------------------------------------------------------------------------------------*/
+        uint32_t CullBoxes(const OcclusionBox* pBoxes, size_t count, uint8_t* pVisibility);
+
+        /*-------------------------------------------------------------------------------------------------
+        Writes the depth buffer as a binary PPM image, nearer is brighter. While tests are recorded, the
+        rectangle of every box of the last CullBoxes is outlined on top, red if it was occluded and green
+        if it was not
+        --------------------------------------------------------------------------------------------------*/
+        bool WriteDebugImage(const std::filesystem::path& path) const;
+
+        inline void SetRecordTests(bool bRecordTests) {m_bRecordTests = bRecordTests;}
+
+        //Fills the triangles one pixel at a time even where SSE is available, used to compare the two paths
+        inline void SetScalarFill(bool bScalarFill) {m_bScalarFill = bScalarFill;}
+
+        inline uint32_t GetWidth() const {return m_width;}
+        inline uint32_t GetHeight() const {return m_height;}
+        //Row by row, the depth pyramid is built from it
+        inline const float* GetDepths() const {return m_depths.data();}
+        inline const DepthPyramid& GetDepthPyramid() const {return m_pyramid;}
+
+        //What the last frame drew, the triangles are counted after clipping and culling
+        inline size_t GetOccluderCount() const {return m_occluders.size();}
+        inline size_t GetTriangleCount() const {return m_triangleCount;}
+
+    private:
+
+        struct Occluder
+        {
+            //Takes the vertices straight to clip space
+            glm::mat4 matrix;
+            const glm::vec3* pVertices;
+            size_t vertexCount;
+            const uint32_t* pIndices;
+            const uint32_t* pAdjacency;
+            size_t indexCount;
+            float error;
+        };
+
+        /*-------------------------------------------------------------------------------------------------
+        A triangle ready to be filled. The edges face inwards and are offset by the margin of silhouette
+        edges, so a pixel center is covered when all three are at least 0. The depth plane is moved to the
+        farthest point of a pixel around its center
+        --------------------------------------------------------------------------------------------------*/
+        struct RasterTriangle
+        {
+            float edgeA[3];
+            float edgeB[3];
+            float edgeC[3];
+            float depthA;
+            float depthB;
+            float depthC;
+            float minDepth;
+            float maxDepth;
+            //The pixels whose centers may be covered, inclusive
+            int32_t minX;
+            int32_t minY;
+            int32_t maxX;
+            int32_t maxY;
+        };
+
+        //Every setup job owns its triangles and bins them to tiles, so the jobs never wait on each other
+        struct SetupJob
+        {
+            std::vector<RasterTriangle> triangles;
+            std::vector<std::vector<uint32_t>> tileBins;
+            std::vector<glm::vec4> clipVertices;
+            std::vector<int8_t> facings;
+        };
+
+        //A tested box's rectangle on the screen, kept for the debug image
+        struct TestedRectangle
+        {
+            glm::vec4 rectangle;
+            uint8_t bOnScreen;
+            uint8_t bOccluded;
+        };
+
+        void SetupOccluder(const Occluder& occluder, SetupJob& job);
+
+        //Clips a triangle if it needs to, splits it into a fan and adds every triangle of the fan to the job
+        void SetupTriangle(const glm::vec4* pClip, const bool* pSilhouetteEdges, int8_t facing, float error,
+        SetupJob& job);
+
+        void RasterizeTile(uint32_t tile);
+
+        bool TestBox(const glm::mat4& matrix, const glm::vec3& boundsMin, const glm::vec3& boundsMax,
+        TestedRectangle& tested) const;
+
+    private:
+
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_tileCountX;
+        uint32_t m_tileCountY;
+        std::vector<float> m_depths;
+        //The depths after the rows' pass of the erosion, before the columns'
+        std::vector<float> m_erodedRows;
+        DepthPyramid m_pyramid;
+
+        glm::mat4 m_viewProjection{1.f};
+        //The projection's [2][2], moving a depth back by a distance needs it
+        float m_depthScale = 0.f;
+        //How many pixels a world unit covers at a distance of 1 in front of the view, along either axis
+        float m_pixelScale = 0.f;
+
+        std::vector<Occluder> m_occluders;
+        std::vector<SetupJob> m_setupJobs;
+        size_t m_triangleCount = 0;
+
+        bool m_bRecordTests = false;
+        bool m_bScalarFill = false;
+        std::vector<TestedRectangle> m_testedRectangles;
+    };
+}
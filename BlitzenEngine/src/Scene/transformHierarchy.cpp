@@ -0,0 +1,253 @@
+#include "transformHierarchy.h"
+#include "Core/matrixKernels.h"
+
+#include "glm/gtx/transform.hpp"
+
+namespace BlitzenEngine
+{
+    TransformHandle TransformHierarchy::CreateNode(TransformHandle parent /* =TransformHandle() */,
+    AssetId name /* =AssetId() */, uint32_t meshAsset /* =BLITZEN_SCENE_NODE_NONE */)
+    {
+        //Roots go after every other node, children at the end of their parent's subtree
+        uint32_t parentIndex = BLITZEN_SCENE_NODE_NONE;
+        uint32_t index = static_cast<uint32_t>(m_parents.size());
+        if(parent.slot != BLITZEN_SCENE_NODE_NONE)
+        {
+            parentIndex = GetIndex(parent);
+            if(parentIndex == BLITZEN_SCENE_NODE_NONE)
+            {
+                return TransformHandle();
+            }
+            index = parentIndex + m_subtreeSizes[parentIndex];
+        }
+
+        InsertNode(index);
+        m_parents[index] = parentIndex;
+        m_meshAssets[index] = meshAsset;
+        m_names[index] = name;
+        m_worldTransforms[index] = parentIndex == BLITZEN_SCENE_NODE_NONE ? glm::mat4(1.f) :
+        m_worldTransforms[parentIndex];
+        m_dirtyFlags[index] = 1;
+        ++m_dirtyNodeCount;
+        for(uint32_t ancestor = parentIndex; ancestor != BLITZEN_SCENE_NODE_NONE; ancestor = m_parents[ancestor])
+        {
+            ++m_subtreeSizes[ancestor];
+        }
+
+        //Slots of destroyed nodes are reused, their generation was already moved past the old handles
+        TransformHandle handle;
+        if(!m_freeSlots.empty())
+        {
+            handle.slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            handle.slot = static_cast<uint32_t>(m_slotIndices.size());
+            m_slotIndices.push_back(BLITZEN_SCENE_NODE_NONE);
+            m_slotGenerations.push_back(0);
+        }
+        handle.generation = m_slotGenerations[handle.slot];
+        m_slotIndices[handle.slot] = index;
+        m_handles[index] = handle;
+
+        return handle;
+    }
+
+    void TransformHierarchy::InsertNode(uint32_t index)
+    {
+        m_parents.insert(m_parents.begin() + index, BLITZEN_SCENE_NODE_NONE);
+        m_subtreeSizes.insert(m_subtreeSizes.begin() + index, 1);
+        m_meshAssets.insert(m_meshAssets.begin() + index, BLITZEN_SCENE_NODE_NONE);
+        m_names.insert(m_names.begin() + index, AssetId());
+        m_translations.insert(m_translations.begin() + index, glm::vec3(0.f));
+        m_rotations.insert(m_rotations.begin() + index, glm::quat(1.f, 0.f, 0.f, 0.f));
+        m_scales.insert(m_scales.begin() + index, glm::vec3(1.f));
+        m_localTransforms.insert(m_localTransforms.begin() + index, glm::mat4(1.f));
+        m_worldTransforms.insert(m_worldTransforms.begin() + index, glm::mat4(1.f));
+        m_dirtyFlags.insert(m_dirtyFlags.begin() + index, 0);
+        m_handles.insert(m_handles.begin() + index, TransformHandle());
+
+        //Appending moves nothing, otherwise every node after the new one is now one place further
+        for(uint32_t i = index + 1; i < m_parents.size(); ++i)
+        {
+            if(m_parents[i] != BLITZEN_SCENE_NODE_NONE && m_parents[i] >= index)
+            {
+                ++m_parents[i];
+            }
+            m_slotIndices[m_handles[i].slot] = i;
+        }
+    }
+
+    void TransformHierarchy::DestroyNode(TransformHandle handle)
+    {
+        uint32_t index = GetIndex(handle);
+        if(index == BLITZEN_SCENE_NODE_NONE)
+        {
+            return;
+        }
+
+        uint32_t count = m_subtreeSizes[index];
+        for(uint32_t ancestor = m_parents[index]; ancestor != BLITZEN_SCENE_NODE_NONE; ancestor = m_parents[ancestor])
+        {
+            m_subtreeSizes[ancestor] -= count;
+        }
+
+        //The whole subtree is a single range, its slots are freed and the range is erased from every array
+        for(uint32_t i = index; i < index + count; ++i)
+        {
+            m_dirtyNodeCount -= m_dirtyFlags[i];
+            uint32_t slot = m_handles[i].slot;
+            m_slotIndices[slot] = BLITZEN_SCENE_NODE_NONE;
+            ++m_slotGenerations[slot];
+            m_freeSlots.push_back(slot);
+        }
+
+        m_parents.erase(m_parents.begin() + index, m_parents.begin() + index + count);
+        m_subtreeSizes.erase(m_subtreeSizes.begin() + index, m_subtreeSizes.begin() + index + count);
+        m_meshAssets.erase(m_meshAssets.begin() + index, m_meshAssets.begin() + index + count);
+        m_names.erase(m_names.begin() + index, m_names.begin() + index + count);
+        m_translations.erase(m_translations.begin() + index, m_translations.begin() + index + count);
+        m_rotations.erase(m_rotations.begin() + index, m_rotations.begin() + index + count);
+        m_scales.erase(m_scales.begin() + index, m_scales.begin() + index + count);
+        m_localTransforms.erase(m_localTransforms.begin() + index, m_localTransforms.begin() + index + count);
+        m_worldTransforms.erase(m_worldTransforms.begin() + index, m_worldTransforms.begin() + index + count);
+        m_dirtyFlags.erase(m_dirtyFlags.begin() + index, m_dirtyFlags.begin() + index + count);
+        m_handles.erase(m_handles.begin() + index, m_handles.begin() + index + count);
+
+        for(uint32_t i = index; i < m_parents.size(); ++i)
+        {
+            if(m_parents[i] != BLITZEN_SCENE_NODE_NONE && m_parents[i] >= index + count)
+            {
+                m_parents[i] -= count;
+            }
+            m_slotIndices[m_handles[i].slot] = i;
+        }
+    }
+
+    bool TransformHierarchy::IsValid(TransformHandle handle) const
+    {
+        return GetIndex(handle) != BLITZEN_SCENE_NODE_NONE;
+    }
+
+    uint32_t TransformHierarchy::GetIndex(TransformHandle handle) const
+    {
+        if(handle.slot >= m_slotIndices.size() || m_slotGenerations[handle.slot] != handle.generation)
+        {
+            return BLITZEN_SCENE_NODE_NONE;
+        }
+        return m_slotIndices[handle.slot];
+    }
+
+    TransformHandle TransformHierarchy::FindNode(AssetId name) const
+    {
+        for(size_t i = 0; i < m_names.size(); ++i)
+        {
+            if(m_names[i] == name)
+            {
+                return m_handles[i];
+            }
+        }
+        return TransformHandle();
+    }
+
+    void TransformHierarchy::SetLocalTransform(TransformHandle handle, const glm::vec3& translation,
+    const glm::quat& rotation, const glm::vec3& scale)
+    {
+        uint32_t index = GetIndex(handle);
+        if(index == BLITZEN_SCENE_NODE_NONE)
+        {
+            return;
+        }
+
+        m_translations[index] = translation;
+        m_rotations[index] = rotation;
+        m_scales[index] = scale;
+        if(!m_dirtyFlags[index])
+        {
+            m_dirtyFlags[index] = 1;
+            ++m_dirtyNodeCount;
+        }
+    }
+
+    void TransformHierarchy::UpdateWorldTransforms()
+    {
+        m_changedNodes.clear();
+        if(!m_dirtyNodeCount)
+        {
+            return;
+        }
+
+        /*-----------------------------------------------------------------------------------------------
+        Parents come before their children, so the first flagged node of a subtree is found before any of 
+        its descendants. Its whole subtree is recomputed, with the world transform of every parent already 
+        up to date when a child reads it, and the pass continues after the end of the subtree
+        ------------------------------------------------------------------------------------------------*/
+        uint32_t nodeCount = static_cast<uint32_t>(m_parents.size());
+        uint32_t i = 0;
+        while(i < nodeCount)
+        {
+            if(!m_dirtyFlags[i])
+            {
+                ++i;
+                continue;
+            }
+
+            uint32_t subtreeEnd = i + m_subtreeSizes[i];
+            for(uint32_t node = i; node < subtreeEnd; ++node)
+            {
+                if(m_dirtyFlags[node])
+                {
+                    m_localTransforms[node] = glm::translate(m_translations[node]) * 
+                    glm::mat4_cast(m_rotations[node]) * glm::scale(m_scales[node]);
+                    m_dirtyFlags[node] = 0;
+                }
+                m_changedNodes.push_back(node);
+            }
+            PropagateWorldTransforms(m_worldTransforms.data(), m_localTransforms.data(), m_parents.data(), i, 
+            subtreeEnd - i);
+            i = subtreeEnd;
+        }
+        m_dirtyNodeCount = 0;
+    }
+
+    void TransformHierarchy::Reserve(size_t nodeCount)
+    {
+        m_parents.reserve(nodeCount);
+        m_subtreeSizes.reserve(nodeCount);
+        m_meshAssets.reserve(nodeCount);
+        m_names.reserve(nodeCount);
+        m_translations.reserve(nodeCount);
+        m_rotations.reserve(nodeCount);
+        m_scales.reserve(nodeCount);
+        m_localTransforms.reserve(nodeCount);
+        m_worldTransforms.reserve(nodeCount);
+        m_dirtyFlags.reserve(nodeCount);
+        m_handles.reserve(nodeCount);
+    }
+
+    void TransformHierarchy::Clear()
+    {
+        //Every live handle has to stop working, so the generations are kept and moved past them
+        for(const TransformHandle& handle : m_handles)
+        {
+            m_slotIndices[handle.slot] = BLITZEN_SCENE_NODE_NONE;
+            ++m_slotGenerations[handle.slot];
+            m_freeSlots.push_back(handle.slot);
+        }
+
+        m_parents.clear();
+        m_subtreeSizes.clear();
+        m_meshAssets.clear();
+        m_names.clear();
+        m_translations.clear();
+        m_rotations.clear();
+        m_scales.clear();
+        m_localTransforms.clear();
+        m_worldTransforms.clear();
+        m_dirtyFlags.clear();
+        m_dirtyNodeCount = 0;
+        m_changedNodes.clear();
+        m_handles.clear();
+    }
+}
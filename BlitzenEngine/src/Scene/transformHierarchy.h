@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include "Core/assetId.h"
+
+namespace BlitzenEngine
+{
+    //The parent of root nodes and the mesh asset of nodes that only transform their children
+    #define BLITZEN_SCENE_NODE_NONE     UINT32_MAX
+
+    /*---------------------------------------------------------------------------------------------------
+    Refers to a node of a TransformHierarchy. Nodes move inside the hierarchy's arrays when others are
+    added or removed, the handle stays the same. The generation tells a handle apart from the handles
+    that its slot was given before, so a handle to a destroyed node never finds a new one
+    ----------------------------------------------------------------------------------------------------*/
+    struct TransformHandle
+    {
+        uint32_t slot = BLITZEN_SCENE_NODE_NONE;
+        uint32_t generation = 0;
+
+        inline bool operator == (const TransformHandle& other) const
+        {return slot == other.slot && generation == other.generation;}
+        inline bool operator != (const TransformHandle& other) const {return !(*this == other);}
+    };
+
+    /*---------------------------------------------------------------------------------------------------
+    The scene's nodes stored as one array per property. Nodes are kept in depth first order, so a parent
+    always comes before its children and the subtree of a node is the range of its subtree size that
+    starts with it. Nodes whose local transform changed are flagged, and updating the world transforms
+    only recomputes the subtrees of flagged nodes, skipping over everything else in a single front to back
+    pass. Indices into the arrays are only valid until the next node is created or destroyed, handles are not
+    ----------------------------------------------------------------------------------------------------*/
+    class TransformHierarchy
+    {
+    public:
+
+        /*-----------------------------------------------------------------------------------------------
+        Adds a node as the last child of the parent, or as a root after every other node. Building the
+        hierarchy in depth first order only ever appends, any other order moves the nodes that come
+        after the new one
+        ------------------------------------------------------------------------------------------------*/
+        TransformHandle CreateNode(TransformHandle parent = TransformHandle(), AssetId name = AssetId(),
+        uint32_t meshAsset = BLITZEN_SCENE_NODE_NONE);
+
+        //Removes the node along with all of its descendants, their handles become invalid
+        void DestroyNode(TransformHandle handle);
+
+        bool IsValid(TransformHandle handle) const;
+
+        //The place of the node in the arrays, or BLITZEN_SCENE_NODE_NONE if the handle is invalid
+        uint32_t GetIndex(TransformHandle handle) const;
+        inline TransformHandle GetHandle(uint32_t index) const {return m_handles[index];}
+
+        /*-----------------------------------------------------------------------------------------------
+        Returns the first node with the given name, or an invalid handle. This scans the nodes, so it is
+        meant to resolve a handle once, which then reaches the node in constant time
+        ------------------------------------------------------------------------------------------------*/
+        TransformHandle FindNode(AssetId name) const;
+
+        //Flags the node, its local transform is composed from these the next time that world transforms are updated
+        void SetLocalTransform(TransformHandle handle, const glm::vec3& translation, const glm::quat& rotation,
+        const glm::vec3& scale);
+
+        /*-----------------------------------------------------------------------------------------------
+        Composes the local transform of every flagged node and recomputes the world transforms of its
+        whole subtree, front to back. Nodes outside of flagged subtrees are not touched, when nothing
+        was flagged this returns right away. The recomputed nodes are listed in the changed nodes
+        ------------------------------------------------------------------------------------------------*/
+        void UpdateWorldTransforms();
+
+        /*-----------------------------------------------------------------------------------------------
+        Indices of the nodes whose world transform the last update recomputed, in increasing order.
+        Systems that mirror world transforms, like the renderer's instance data, only need to copy these
+        ------------------------------------------------------------------------------------------------*/
+        inline const std::vector<uint32_t>& GetChangedNodes() const {return m_changedNodes;}
+
+        //Makes room in every array, so that importing a scene of known size does not reallocate them
+        void Reserve(size_t nodeCount);
+
+        void Clear();
+
+        inline size_t GetNodeCount() const {return m_parents.size();}
+
+        //The arrays, indexed by node, for systems that walk the hierarchy linearly
+        inline const std::vector<uint32_t>& GetParents() const {return m_parents;}
+        inline const std::vector<uint32_t>& GetSubtreeSizes() const {return m_subtreeSizes;}
+        inline const std::vector<uint32_t>& GetMeshAssets() const {return m_meshAssets;}
+        inline const std::vector<AssetId>& GetNames() const {return m_names;}
+        inline const std::vector<glm::vec3>& GetTranslations() const {return m_translations;}
+        inline const std::vector<glm::quat>& GetRotations() const {return m_rotations;}
+        inline const std::vector<glm::vec3>& GetScales() const {return m_scales;}
+        inline const std::vector<glm::mat4>& GetLocalTransforms() const {return m_localTransforms;}
+        inline const std::vector<glm::mat4>& GetWorldTransforms() const {return m_worldTransforms;}
+
+    private:
+
+        //Makes room for a node at the index, moving the nodes after it and fixing the indices that point to them
+        void InsertNode(uint32_t index);
+
+    private:
+
+        //Index of the parent of every node, BLITZEN_SCENE_NODE_NONE for roots
+        std::vector<uint32_t> m_parents;
+        //The node itself and all of its descendants
+        std::vector<uint32_t> m_subtreeSizes;
+        //Index of the renderer's mesh asset that the node draws
+        std::vector<uint32_t> m_meshAssets;
+        std::vector<AssetId> m_names;
+
+        std::vector<glm::vec3> m_translations;
+        std::vector<glm::quat> m_rotations;
+        std::vector<glm::vec3> m_scales;
+        std::vector<glm::mat4> m_localTransforms;
+        std::vector<glm::mat4> m_worldTransforms;
+
+        //Set for nodes created or moved since the last update, the count lets an update of a static scene skip the pass
+        std::vector<uint8_t> m_dirtyFlags;
+        size_t m_dirtyNodeCount = 0;
+        std::vector<uint32_t> m_changedNodes;
+
+        //The handle of every node, and for every handle slot the index of its node and its current generation
+        std::vector<TransformHandle> m_handles;
+        std::vector<uint32_t> m_slotIndices;
+        std::vector<uint32_t> m_slotGenerations;
+        std::vector<uint32_t> m_freeSlots;
+    };
+}
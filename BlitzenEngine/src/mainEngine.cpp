@@ -14,28 +14,47 @@ namespace BlitzenEngine
         m_vulkan.Init(&m_windowData);
 	
     	/*---------------------------------------------------------------------------------------
-    	Declaring two vectors, one for the vertex data and one for the index data
-    	The LoadMeshAsset function will go through all the meshes that need to be loaded
-    	It will the indices and vertices and give the necessary data to acces them to the objects
-    	Then vulkan will allocate two big buffers one for the vertices and one for the indices
+    	The mesh assets are loaded from their cooked file when it is up to date with the glb.
+    	Otherwise the glb is parsed, the vertices and indices of all its meshes are gathered
+    	and cooked for the next startup. Either way vulkan will allocate two big buffers,
+    	one for the vertices and one for the indices
     	-----------------------------------------------------------------------------------------*/
-    	std::vector<BlitzenRendering::VulkanVertex> vertices;
-    	std::vector<uint32_t> indices;
-        LoadMeshAsset("BlitzenEngine/Assets/basicmesh.glb", vertices, indices, &m_vulkan);
-    	m_vulkan.LoadMeshBuffers(vertices, indices);
+        LoadCachedMeshAsset("BlitzenEngine/Assets/basicmesh.glb", &m_vulkan);
 
         m_vulkan.InitPlaceholderData();
     }
 
-    void MainEngine::Run()
+    int MainEngine::Run(uint32_t frameCount /* =0 */)
     {
         std::cout << "Blitzen Engine 0.Alpha Booting\n";
 
-        while(!(m_windowData.bEngineShouldTerminate))
+        #ifdef BLITZEN_MATRIX_BENCHMARK
+            BenchmarkMatrixKernels(4096, 1000);
+        #endif
+
+        uint32_t drawnFrameCount = 0;
+        while(!(m_windowData.bEngineShouldTerminate) && (!frameCount || drawnFrameCount < frameCount))
         {
             glfwPollEvents();
             m_vulkan.DrawFrame();
+            ++drawnFrameCount;
         }
+
+        /*---------------------------------------------------------------------------------------
+        A run that compared no frames, because the draws never left the CPU, cannot have caught a
+        difference, so it fails as well. The two phase occlusion culling is never compared, the 
+        CPU reference has no depth pyramid and the renderer keeps it off while it validates
+        ----------------------------------------------------------------------------------------*/
+        #ifdef BLITZEN_VALIDATE_GPU_CULLING
+            std::cout << "GPU draw culling validation: " << m_vulkan.GetValidatedFrameCount() << " frames compared, " 
+            << m_vulkan.GetFailedValidationCount() << " differed from the CPU reference, two phase occlusion culling" 
+            << " is not compared\n";
+            if(!m_vulkan.GetValidatedFrameCount() || m_vulkan.GetFailedValidationCount())
+            {
+                return 1;
+            }
+        #endif
+        return 0;
     }
 
     MainEngine::~MainEngine()
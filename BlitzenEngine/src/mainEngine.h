@@ -13,6 +13,8 @@
 
 #include "AssetLoading/assetLoading.h"
 
+#include "Core/matrixKernels.h"
+
 #define INITIAL_WINDOW_WIDTH        850
 #define INITIAL_WINDOW_HEIGHT       620
 
@@ -28,8 +30,12 @@ namespace BlitzenEngine
     public:
         MainEngine();
 
-        //This function runs the engine until an even stop the game loop
-        void Run();
+        /*-------------------------------------------------------------------------------------
+        This function runs the engine until an even stop the game loop, or until it has drawn 
+        the given number of frames if it is not 0. Returns the process's exit code, which is 
+        not 0 if a check that the engine was built with has failed
+        --------------------------------------------------------------------------------------*/
+        int Run(uint32_t frameCount = 0);
 
         ~MainEngine();
 
@@ -1,7 +1,20 @@
 #include "mainEngine.h"
 
-int main()
+#include <cstring>
+#include <cstdlib>
+
+int main(int argc, char** argv)
 {
+    //With --frames the engine stops by itself after that many frames, so that it can run in CI
+    uint32_t frameCount = 0;
+    for(int i = 1; i + 1 < argc; ++i)
+    {
+        if(!strcmp(argv[i], "--frames"))
+        {
+            frameCount = static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
     BlitzenEngine::MainEngine mainEngine;
-    mainEngine.Run();
-}
\ No newline at end of file
+    return mainEngine.Run(frameCount);
+}